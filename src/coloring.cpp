@@ -0,0 +1,134 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/coloring.h>
+#include <tightb/parallel.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+constexpr std::size_t uncolored = std::numeric_limits<std::size_t>::max();
+
+// SplitMix64 finalizer; a fixed pseudo-random priority per vertex keeps the
+// coloring reproducible regardless of the number of threads.
+std::uint64_t priority(std::size_t v) {
+  std::uint64_t z = static_cast<std::uint64_t>(v) + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+bool beats(std::size_t u, std::size_t v) {
+  std::uint64_t pu = priority(u);
+  std::uint64_t pv = priority(v);
+  return pu > pv || (pu == pv && u > v);
+}
+
+// Calls visit(u) for every u != v within `distance` bonds of v, stopping early
+// when visit returns false. Vertices two bonds away may be visited repeatedly.
+template <typename F>
+void visit_within(Graph const& graph, std::size_t v, std::size_t distance,
+                  F&& visit) {
+  for (std::size_t u : graph.neighbors(v)) {
+    if (!visit(u)) return;
+    if (distance < 2) continue;
+    for (std::size_t w : graph.neighbors(u)) {
+      if (w != v && !visit(w)) return;
+    }
+  }
+}
+
+}  // namespace
+
+Coloring color_graph(Graph const& graph, std::size_t distance) {
+  ASSERT(distance == 1 || distance == 2);
+  std::size_t n = graph.size();
+
+  Coloring result;
+  result.distance = distance;
+  result.color.assign(n, uncolored);
+  std::vector<std::size_t>& color = result.color;
+
+  std::vector<std::size_t> pending(n);
+  std::iota(pending.begin(), pending.end(), 0);
+  std::vector<char> selected(n, 0);
+
+  while (!pending.empty()) {
+    // Selection only reads colors, so it never races with itself.
+    parallel_for(pending.size(), [&](std::size_t begin, std::size_t end,
+                                     std::size_t) {
+      for (std::size_t i = begin; i < end; i++) {
+        std::size_t v = pending[i];
+        bool local_max = true;
+        visit_within(graph, v, distance, [&](std::size_t u) {
+          if (color[u] == uncolored && beats(u, v)) local_max = false;
+          return local_max;
+        });
+        selected[v] = local_max;
+      }
+    });
+
+    // Selected vertices are more than `distance` bonds apart, so none of them
+    // reads a color that another one is writing.
+    parallel_for(pending.size(), [&](std::size_t begin, std::size_t end,
+                                     std::size_t) {
+      std::vector<std::size_t> used;
+      for (std::size_t i = begin; i < end; i++) {
+        std::size_t v = pending[i];
+        if (!selected[v]) continue;
+        used.clear();
+        visit_within(graph, v, distance, [&](std::size_t u) {
+          if (color[u] != uncolored) used.push_back(color[u]);
+          return true;
+        });
+        std::sort(used.begin(), used.end());
+        std::size_t c = 0;
+        for (std::size_t taken : used) {
+          if (taken == c) {
+            c++;
+          } else if (taken > c) {
+            break;
+          }
+        }
+        color[v] = c;
+      }
+    });
+
+    for (std::size_t v : pending) selected[v] = 0;
+    pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                 [&](std::size_t v) {
+                                   return color[v] != uncolored;
+                                 }),
+                  pending.end());
+  }
+
+  std::size_t colors = 0;
+  for (std::size_t c : color) colors = std::max(colors, c + 1);
+  result.offsets.assign(colors + 1, 0);
+  for (std::size_t c : color) result.offsets[c + 1]++;
+  std::partial_sum(result.offsets.begin(), result.offsets.end(),
+                   result.offsets.begin());
+  result.vertices.resize(n);
+  std::vector<std::size_t> cursor(result.offsets.begin(),
+                                  result.offsets.end() - 1);
+  for (std::size_t v = 0; v < n; v++) result.vertices[cursor[color[v]]++] = v;
+  return result;
+}
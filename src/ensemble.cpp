@@ -0,0 +1,58 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/ensemble.h>
+
+#include <cmath>
+
+void EnsembleAverage::add(double const* values) {
+  count_++;
+  double n = static_cast<double>(count_);
+  for (std::size_t i = 0; i < mean_.size(); i++) {
+    double delta = values[i] - mean_[i];
+    mean_[i] += delta / n;
+    m2_[i] += delta * (values[i] - mean_[i]);
+  }
+}
+
+void EnsembleAverage::merge(EnsembleAverage const& other) {
+  ASSERT(other.observables() == observables());
+  if (other.count_ == 0) return;
+  if (count_ == 0) {
+    *this = other;
+    return;
+  }
+  double na = static_cast<double>(count_);
+  double nb = static_cast<double>(other.count_);
+  double n = na + nb;
+  for (std::size_t i = 0; i < mean_.size(); i++) {
+    double delta = other.mean_[i] - mean_[i];
+    mean_[i] += delta * nb / n;
+    m2_[i] += other.m2_[i] + delta * delta * na * nb / n;
+  }
+  count_ += other.count_;
+}
+
+double EnsembleAverage::variance(std::size_t i) const {
+  if (count_ < 2) return 0.0;
+  return m2_[i] / static_cast<double>(count_ - 1);
+}
+
+double EnsembleAverage::standard_error(std::size_t i) const {
+  if (count_ == 0) return 0.0;
+  return std::sqrt(variance(i) / static_cast<double>(count_));
+}
@@ -14,4 +14,58 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <tightb/assert.h>
 #include <tightb/graph.h>
+
+#include <algorithm>
+
+Graph::Graph(std::size_t vertices,
+             std::vector<std::pair<std::size_t, std::size_t>> const& bonds)
+    : offsets_(vertices + 1, 0) {
+  for (auto const& [u, v] : bonds) {
+    ASSERT(u < vertices && v < vertices);
+    if (u == v) continue;
+    offsets_[u + 1]++;
+    offsets_[v + 1]++;
+  }
+  for (std::size_t v = 0; v < vertices; v++) {
+    offsets_[v + 1] += offsets_[v];
+  }
+
+  adjacency_.resize(offsets_[vertices]);
+  std::vector<std::size_t> cursor(offsets_.begin(), offsets_.end() - 1);
+  for (auto const& [u, v] : bonds) {
+    if (u == v) continue;
+    adjacency_[cursor[u]++] = v;
+    adjacency_[cursor[v]++] = u;
+  }
+
+  // Sort every row and squeeze out repeated bonds in place.
+  std::size_t out = 0;
+  std::size_t begin = 0;
+  for (std::size_t v = 0; v < vertices; v++) {
+    std::size_t end = offsets_[v + 1];
+    std::sort(adjacency_.begin() + begin, adjacency_.begin() + end);
+    auto last = std::unique(adjacency_.begin() + begin,
+                            adjacency_.begin() + end);
+    std::size_t row_start = out;
+    for (auto it = adjacency_.begin() + begin; it != last; ++it) {
+      adjacency_[out++] = *it;
+    }
+    begin = end;
+    offsets_[v] = row_start;
+  }
+  offsets_[vertices] = out;
+  adjacency_.resize(out);
+}
+
+Graph::Graph(std::vector<std::size_t> offsets,
+             std::vector<std::size_t> adjacency)
+    : offsets_(std::move(offsets)), adjacency_(std::move(adjacency)) {
+  ASSERT(!offsets_.empty() && offsets_.back() == adjacency_.size());
+}
+
+bool Graph::has_bond(std::size_t u, std::size_t v) const {
+  Neighbors row = neighbors(u);
+  return std::binary_search(row.begin(), row.end(), v);
+}
@@ -0,0 +1,105 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/hofstadter.h>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'B', 'H', 'O', 'F', 'S', 'T', '\0'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kChunk = 1 << 16;  // energies per read
+
+void put(std::ostream& out, std::uint32_t value) {
+  out.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+std::uint32_t get(std::istream& in) {
+  std::uint32_t value = 0;
+  in.read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+std::vector<Flux> farey_fluxes(long max_q) {
+  ASSERT(max_q >= 1);
+  std::vector<Flux> fluxes;
+  for (long q = 1; q <= max_q; q++) {
+    for (long p = 0; p <= q; p++) {
+      if (std::gcd(p, q) == 1) fluxes.push_back({p, q});
+    }
+  }
+  return fluxes;
+}
+
+void write_hofstadter_header(std::ostream& out) {
+  out.write(kMagic, sizeof(kMagic));
+  put(out, kVersion);
+}
+
+void write_spectrum(std::ostream& out, FluxSpectrum const& spectrum) {
+  // p is negative for a reversed field, so it goes through int32 both ways.
+  put(out, static_cast<std::uint32_t>(
+               static_cast<std::int32_t>(spectrum.flux.p)));
+  put(out, static_cast<std::uint32_t>(spectrum.flux.q));
+  put(out, spectrum.k);
+  put(out, static_cast<std::uint32_t>(spectrum.energies.size()));
+  std::vector<float> energies(spectrum.energies.begin(),
+                              spectrum.energies.end());
+  out.write(reinterpret_cast<char const*>(energies.data()),
+            static_cast<std::streamsize>(energies.size() * sizeof(float)));
+}
+
+std::vector<FluxSpectrum> read_hofstadter(std::istream& in) {
+  char magic[sizeof(kMagic)];
+  in.read(magic, sizeof(magic));
+  ASSERT(in.good() && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0,
+         "not a Hofstadter file");
+  ASSERT(get(in) == kVersion, "unsupported Hofstadter file version");
+
+  std::vector<FluxSpectrum> spectra;
+  while (true) {
+    std::uint32_t p = get(in);
+    if (!in.good()) break;
+    FluxSpectrum spectrum;
+    spectrum.flux.p = static_cast<std::int32_t>(p);
+    spectrum.flux.q = get(in);
+    spectrum.k = get(in);
+    std::uint32_t count = get(in);
+    ASSERT(in.good(), "truncated Hofstadter file");
+    ASSERT(spectrum.flux.q != 0 && count % spectrum.flux.q == 0,
+           "corrupt Hofstadter record");
+    // The count is untrusted until the energies arrive, so the buffer grows
+    // with the data actually read.
+    std::vector<float> energies;
+    while (energies.size() < count) {
+      std::size_t begin = energies.size();
+      energies.resize(begin + std::min<std::size_t>(kChunk, count - begin));
+      in.read(reinterpret_cast<char*>(energies.data() + begin),
+              static_cast<std::streamsize>((energies.size() - begin) *
+                                           sizeof(float)));
+      ASSERT(in.good(), "truncated Hofstadter file");
+    }
+    spectrum.energies.assign(energies.begin(), energies.end());
+    spectra.push_back(std::move(spectrum));
+  }
+  return spectra;
+}
@@ -0,0 +1,117 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/kpm.h>
+
+#include <cmath>
+#include <complex>
+#include <utility>
+
+std::vector<double> kpm_kernel(KpmKernel kernel, std::size_t moments,
+                               double lambda) {
+  std::vector<double> g(moments);
+  double m = static_cast<double>(moments);
+  for (std::size_t n = 0; n < moments; n++) {
+    double x = static_cast<double>(n);
+    switch (kernel) {
+      case KpmKernel::Jackson: {
+        double q = M_PI / (m + 1.0);
+        g[n] = ((m - x + 1.0) * std::cos(q * x) +
+                std::sin(q * x) / std::tan(q)) /
+               (m + 1.0);
+        break;
+      }
+      case KpmKernel::Lorentz:
+        ASSERT(lambda > 0.0);
+        g[n] = std::sinh(lambda * (1.0 - x / m)) / std::sinh(lambda);
+        break;
+    }
+  }
+  return g;
+}
+
+void detail::fft(std::vector<std::complex<double>>& a, bool inverse) {
+  std::size_t n = a.size();
+  ASSERT(n > 0 && (n & (n - 1)) == 0, "FFT length must be a power of two");
+  for (std::size_t i = 1, j = 0; i < n; i++) {
+    std::size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(a[i], a[j]);
+  }
+  double sign = inverse ? 1.0 : -1.0;
+  for (std::size_t length = 2; length <= n; length <<= 1) {
+    std::complex<double> root = std::polar(1.0, sign * 2.0 * M_PI / length);
+    for (std::size_t start = 0; start < n; start += length) {
+      std::complex<double> w = 1.0;
+      for (std::size_t k = 0; k < length / 2; k++) {
+        std::complex<double> u = a[start + k];
+        std::complex<double> v = a[start + k + length / 2] * w;
+        a[start + k] = u + v;
+        a[start + k + length / 2] = u - v;
+        w *= root;
+      }
+    }
+  }
+}
+
+std::vector<double> detail::chebyshev_sum(std::vector<double> const& c,
+                                          std::size_t points) {
+  ASSERT(points > 0);
+  std::vector<double> y(points, 0.0);
+  if ((points & (points - 1)) != 0) {
+    for (std::size_t k = 0; k < points; k++) {
+      double theta = M_PI * (k + 0.5) / points;
+      for (std::size_t n = 0; n < c.size(); n++) {
+        y[k] += c[n] * std::cos(n * theta);
+      }
+    }
+    return y;
+  }
+  // cos(n theta_k) = Re e^{i pi n / 2K} e^{2 pi i n k / 2K}: one inverse FFT
+  // of length 2K of the twisted coefficients, those past 2K folded back.
+  std::vector<std::complex<double>> a(2 * points, 0.0);
+  for (std::size_t n = 0; n < c.size(); n++) {
+    a[n % (2 * points)] += c[n] * std::polar(1.0, M_PI * n / (2.0 * points));
+  }
+  fft(a, true);
+  for (std::size_t k = 0; k < points; k++) y[k] = a[k].real();
+  return y;
+}
+
+KpmDensity kpm_density(std::vector<double> const& moments,
+                       ChebyshevScale const& scale, std::size_t points,
+                       KpmKernel kernel, double lambda) {
+  std::vector<double> g = kpm_kernel(kernel, moments.size(), lambda);
+  std::vector<double> c(moments.size());
+  for (std::size_t n = 0; n < moments.size(); n++) {
+    c[n] = (n == 0 ? 1.0 : 2.0) * g[n] * moments[n];
+  }
+  std::vector<double> y = detail::chebyshev_sum(c, points);
+
+  KpmDensity dos;
+  dos.energy.resize(points);
+  dos.density.resize(points);
+  for (std::size_t k = 0; k < points; k++) {
+    // Node k has x = cos(theta_k), decreasing in k.
+    std::size_t i = points - 1 - k;
+    double x = std::cos(M_PI * (k + 0.5) / points);
+    dos.energy[i] = scale.energy(x);
+    dos.density[i] = y[k] / (M_PI * std::sqrt(1.0 - x * x) * scale.half_width);
+  }
+  return dos;
+}
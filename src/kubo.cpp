@@ -0,0 +1,103 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/kubo.h>
+#include <tightb/parallel.h>
+
+#include <cmath>
+#include <complex>
+
+KuboConductivity kubo_bastin(std::vector<std::complex<double>> const& mu,
+                             std::size_t moments, ChebyshevScale const& scale,
+                             double volume, std::size_t points,
+                             double temperature, KpmKernel kernel,
+                             double lambda) {
+  using complex = std::complex<double>;
+  ASSERT(mu.size() == moments * moments && points > 0 && volume > 0.0);
+  std::vector<double> g = kpm_kernel(kernel, moments, lambda);
+  std::vector<complex> damped(moments * moments);
+  for (std::size_t n = 0; n < moments; n++) {
+    for (std::size_t m = 0; m < moments; m++) {
+      double w = g[n] * g[m] / ((n == 0 ? 2.0 : 1.0) * (m == 0 ? 2.0 : 1.0));
+      damped[n * moments + m] = w * mu[n * moments + m];
+    }
+  }
+
+  // term[k]: the integrand at node k times its weight in x, sin(theta) pi /
+  // points, so the integral up to E_F is a sum over the nodes below it.
+  std::vector<double> term(points);
+  parallel_for(
+      points,
+      [&](std::size_t begin, std::size_t end, std::size_t) {
+        std::vector<complex> a(moments);
+        std::vector<complex> b(moments);
+        std::vector<double> c(moments);
+        for (std::size_t k = begin; k < end; k++) {
+          double theta = M_PI * (k + 0.5) / points;
+          double x = std::cos(theta);
+          double s = std::sin(theta);
+          for (std::size_t n = 0; n < moments; n++) {
+            complex phase = std::polar(1.0, n * theta);
+            a[n] = complex(x, -(n * s)) * phase;
+            b[n] = complex(x, n * s) * std::conj(phase);
+            c[n] = phase.real();
+          }
+          // sum_nm mu_nm (a_n T_m + b_m T_n)
+          complex sum = 0.0;
+          for (std::size_t n = 0; n < moments; n++) {
+            complex const* row = damped.data() + n * moments;
+            complex right = 0.0;
+            complex left = 0.0;
+            for (std::size_t m = 0; m < moments; m++) {
+              right += row[m] * c[m];
+              left += row[m] * b[m];
+            }
+            sum += a[n] * right + c[n] * left;
+          }
+          term[k] = sum.real() / (s * s * s * s) * s * M_PI / points;
+        }
+      },
+      16);
+
+  KuboConductivity result;
+  result.energy.resize(points);
+  result.sigma.assign(points, 0.0);
+  double prefactor =
+      4.0 / (M_PI * volume * scale.half_width * scale.half_width);
+  for (std::size_t k = 0; k < points; k++) {
+    result.energy[points - 1 - k] =
+        scale.energy(std::cos(M_PI * (k + 0.5) / points));
+  }
+  if (temperature <= 0.0) {
+    // Nodes in ascending energy are k = points - 1 .. 0.
+    double sum = 0.0;
+    for (std::size_t i = 0; i < points; i++) {
+      sum += term[points - 1 - i];
+      result.sigma[i] = prefactor * sum;
+    }
+    return result;
+  }
+  for (std::size_t i = 0; i < points; i++) {
+    double sum = 0.0;
+    for (std::size_t k = 0; k < points; k++) {
+      double e = result.energy[points - 1 - k] - result.energy[i];
+      sum += term[k] / (1.0 + std::exp(e / temperature));
+    }
+    result.sigma[i] = prefactor * sum;
+  }
+  return result;
+}
@@ -14,9 +14,69 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <tightb/bloch.h>
+#include <tightb/eigen.h>
+#include <tightb/model_cache.h>
+
+#include <complex>
 #include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <std::size_t D>
+void summarize(ModelCache const& model) {
+  UnitCell<D> cell = unit_cell<D>(model);
+  HoppingTable<D> table = hopping_table<D>(model);
+  std::cout << "dimension     " << D << '\n'
+            << "cell volume   " << cell.lattice().volume() << '\n'
+            << "sites         " << cell.sites() << '\n'
+            << "orbitals      " << cell.orbitals() << '\n'
+            << "bonds         "
+            << model.cell_graph().bonds() + model.bonds() << '\n'
+            << "translations  " << table.translations() << '\n'
+            << "time reversal "
+            << (table.time_reversal_symmetric() ? "yes" : "no") << '\n';
+
+  std::size_t n = table.orbitals();
+  BlochHamiltonian<D> hamiltonian(table);
+  BlochWorkspace bloch;
+  EigenWorkspace<std::complex<double>> eigen;
+  std::vector<std::complex<double>> h(n * n);
+  std::vector<double> energies(n);
+  Vec<double, D> gamma{};
+  for (std::size_t d = 0; d < D; d++) gamma[d] = 0.0;
+  hamiltonian.build(gamma, h.data(), bloch);
+  hermitian_eigenvalues(n, h.data(), energies.data(), eigen);
+  std::cout << "energies at G";
+  for (double e : energies) std::cout << ' ' << e;
+  std::cout << std::endl;
+}
+
+}  // namespace
 
-int main() {
-  std::cout << "Hello, World!" << std::endl;
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "usage: " << argv[0] << " <model file>" << std::endl;
+    return 1;
+  }
+  // The compiled model is kept next to the source and rebuilt whenever the
+  // source changes.
+  std::string source = argv[1];
+  ModelCache model = load_cached_model(source, source + ".tbc");
+  switch (model.dimension()) {
+    case 1:
+      summarize<1>(model);
+      break;
+    case 2:
+      summarize<2>(model);
+      break;
+    case 3:
+      summarize<3>(model);
+      break;
+    default:
+      UNREACHABLE();
+  }
   return 0;
 }
@@ -0,0 +1,241 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/mapped_file.h>
+#include <tightb/model.h>
+#include <tightb/parallel.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <numeric>
+
+namespace {
+
+// Files smaller than this per thread are not worth splitting.
+constexpr std::size_t kChunkBytes = std::size_t{1} << 20;
+
+[[noreturn]] void fail(std::string_view text, char const* where,
+                       char const* message) {
+  std::size_t line =
+      1 + static_cast<std::size_t>(std::count(text.data(), where, '\n'));
+  std::fprintf(stderr, "model:%zu: %s\n", line, message);
+  ERROR("malformed model file");
+  __builtin_unreachable();
+}
+
+// Cursor over one line at a time. Comments and trailing '\r' count as the end
+// of the line.
+struct Reader {
+  std::string_view text;
+  char const* pos;
+  char const* end;
+
+  void skip_blanks() {
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) pos++;
+  }
+
+  bool at_line_end() {
+    skip_blanks();
+    return pos == end || *pos == '\n' || *pos == '#';
+  }
+
+  void next_line() {
+    while (pos < end && *pos != '\n') pos++;
+    if (pos < end) pos++;
+  }
+
+  // Skips blank and comment-only lines; false at the end of the text.
+  bool next_content() {
+    while (pos < end) {
+      if (!at_line_end()) return true;
+      next_line();
+    }
+    return false;
+  }
+
+  std::string_view word() {
+    skip_blanks();
+    char const* first = pos;
+    while (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' &&
+           *pos != '\n' && *pos != '#') {
+      pos++;
+    }
+    return {first, static_cast<std::size_t>(pos - first)};
+  }
+
+  template <typename T>
+  T number() {
+    skip_blanks();
+    T value{};
+    auto [next, error] = std::from_chars(pos, end, value);
+    if (error != std::errc()) fail(text, pos, "expected a number");
+    pos = next;
+    return value;
+  }
+
+  void finish_line() {
+    if (!at_line_end()) fail(text, pos, "unexpected trailing text");
+    next_line();
+  }
+};
+
+struct Hoppings {
+  std::vector<int> cells;
+  std::vector<std::size_t> from;
+  std::vector<std::size_t> to;
+  std::vector<double> re;
+  std::vector<double> im;
+};
+
+void parse_hoppings(Reader reader, std::size_t dimension,
+                    std::size_t orbitals, Hoppings& out) {
+  std::size_t estimate = static_cast<std::size_t>(reader.end - reader.pos) / 32;
+  out.cells.reserve(estimate * dimension);
+  out.from.reserve(estimate);
+  out.to.reserve(estimate);
+  out.re.reserve(estimate);
+  out.im.reserve(estimate);
+  while (reader.next_content()) {
+    for (std::size_t d = 0; d < dimension; d++) {
+      out.cells.push_back(reader.number<int>());
+    }
+    char const* line = reader.pos;
+    std::size_t a = reader.number<std::size_t>();
+    std::size_t b = reader.number<std::size_t>();
+    if (a >= orbitals || b >= orbitals) {
+      fail(reader.text, line, "orbital index out of range");
+    }
+    out.from.push_back(a);
+    out.to.push_back(b);
+    out.re.push_back(reader.number<double>());
+    out.im.push_back(reader.at_line_end() ? 0.0 : reader.number<double>());
+    reader.finish_line();
+  }
+}
+
+}  // namespace
+
+std::size_t Model::total_orbitals() const {
+  return std::accumulate(orbitals.begin(), orbitals.end(), std::size_t{0});
+}
+
+Model parse_model(std::string_view text) {
+  Model model;
+  Reader reader{text, text.data(), text.data() + text.size()};
+  bool body = false;
+  while (!body && reader.next_content()) {
+    char const* line = reader.pos;
+    std::string_view keyword = reader.word();
+    if (keyword == "dimension") {
+      if (model.dimension != 0) fail(text, line, "dimension given twice");
+      model.dimension = reader.number<std::size_t>();
+      if (model.dimension == 0 || model.dimension > 3) {
+        fail(text, line, "dimension must be 1, 2 or 3");
+      }
+      reader.finish_line();
+    } else if (keyword == "lattice") {
+      if (model.dimension == 0) fail(text, line, "lattice before dimension");
+      reader.finish_line();
+      model.lattice.clear();
+      for (std::size_t i = 0; i < model.dimension; i++) {
+        if (!reader.next_content()) fail(text, reader.pos, "missing vector");
+        for (std::size_t j = 0; j < model.dimension; j++) {
+          model.lattice.push_back(reader.number<double>());
+        }
+        reader.finish_line();
+      }
+    } else if (keyword == "site") {
+      if (model.dimension == 0) fail(text, line, "site before dimension");
+      for (std::size_t d = 0; d < model.dimension; d++) {
+        model.positions.push_back(reader.number<double>());
+      }
+      std::size_t orbitals =
+          reader.at_line_end() ? 1 : reader.number<std::size_t>();
+      if (orbitals == 0) fail(text, line, "a site needs an orbital");
+      model.orbitals.push_back(orbitals);
+      reader.finish_line();
+    } else if (keyword == "hoppings") {
+      if (model.lattice.empty()) fail(text, line, "hoppings before lattice");
+      if (model.orbitals.empty()) fail(text, line, "hoppings before sites");
+      reader.finish_line();
+      body = true;
+    } else {
+      fail(text, line, "unknown keyword");
+    }
+  }
+  if (model.dimension == 0) fail(text, reader.pos, "missing dimension");
+  if (model.lattice.empty()) fail(text, reader.pos, "missing lattice");
+  if (!body) return model;
+
+  // Split the hopping list at line boundaries, one chunk per thread.
+  char const* first = reader.pos;
+  std::size_t bytes = static_cast<std::size_t>(reader.end - first);
+  std::size_t chunks =
+      std::clamp<std::size_t>(bytes / kChunkBytes, 1, max_threads());
+  std::vector<char const*> bounds(chunks + 1, reader.end);
+  bounds[0] = first;
+  for (std::size_t c = 1; c < chunks; c++) {
+    char const* p = first + bytes * c / chunks;
+    while (p < reader.end && p[-1] != '\n') p++;
+    bounds[c] = std::max(p, bounds[c - 1]);
+  }
+
+  std::size_t orbitals = model.total_orbitals();
+  std::vector<Hoppings> parts(chunks);
+  parallel_for(
+      chunks,
+      [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t c = begin; c < end; c++) {
+          Reader chunk{text, bounds[c], bounds[c + 1]};
+          parse_hoppings(chunk, model.dimension, orbitals, parts[c]);
+        }
+      },
+      1);
+
+  auto append = [](auto& to, auto const& from) {
+    to.insert(to.end(), from.begin(), from.end());
+  };
+  if (chunks == 1) {
+    model.cells = std::move(parts[0].cells);
+    model.from = std::move(parts[0].from);
+    model.to = std::move(parts[0].to);
+    model.re = std::move(parts[0].re);
+    model.im = std::move(parts[0].im);
+    return model;
+  }
+  std::size_t total = 0;
+  for (auto const& part : parts) total += part.from.size();
+  model.cells.reserve(total * model.dimension);
+  model.from.reserve(total);
+  model.to.reserve(total);
+  model.re.reserve(total);
+  model.im.reserve(total);
+  for (auto const& part : parts) {
+    append(model.cells, part.cells);
+    append(model.from, part.from);
+    append(model.to, part.to);
+    append(model.re, part.re);
+    append(model.im, part.im);
+  }
+  return model;
+}
+
+Model load_model(std::string const& path) {
+  MappedFile file(path);
+  return parse_model(file.view());
+}
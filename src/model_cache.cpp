@@ -0,0 +1,311 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/model_cache.h>
+#include <tightb/parallel.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'B', 'M', 'O', 'D', 'E', 'L', '\0'};
+constexpr std::size_t kHeaderWords = 10;
+constexpr std::size_t kHashBlock = std::size_t{1} << 20;
+constexpr std::uint64_t kFnvOffset = 14695981039346656037ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+std::uint64_t fnv1a(char const* data, std::size_t size) {
+  std::uint64_t hash = kFnvOffset;
+  std::size_t words = size / 8;
+  for (std::size_t i = 0; i < words; i++) {
+    std::uint64_t word;
+    std::memcpy(&word, data + 8 * i, 8);
+    hash = (hash ^ word) * kFnvPrime;
+  }
+  for (std::size_t i = 8 * words; i < size; i++) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * kFnvPrime;
+  }
+  return hash;
+}
+
+template <typename T>
+void put(std::vector<char>& out, T const* data, std::size_t count) {
+  static_assert(sizeof(T) == 8);
+  std::size_t first = out.size();
+  out.resize(first + count * sizeof(T));
+  if (count > 0) std::memcpy(out.data() + first, data, count * sizeof(T));
+}
+
+void put(std::vector<char>& out, std::uint64_t value) { put(out, &value, 1); }
+
+// Total length in bytes that the header of `bytes` implies, or 0 if the
+// header is missing or its counts overflow.
+std::uint64_t expected_size(std::string_view bytes) {
+  if (bytes.size() < kHeaderWords * 8) return 0;
+  std::uint64_t h[kHeaderWords];
+  std::memcpy(h, bytes.data(), sizeof(h));
+  std::uint64_t dim = h[4];
+  std::uint64_t sites = h[5];
+  std::uint64_t n = h[6];
+  std::uint64_t translations = h[7];
+  bool overflow = false;
+  auto mul = [&](std::uint64_t a, std::uint64_t b) {
+    std::uint64_t r;
+    overflow |= __builtin_mul_overflow(a, b, &r);
+    return r;
+  };
+  auto add = [&](std::uint64_t a, std::uint64_t b) {
+    std::uint64_t r;
+    overflow |= __builtin_add_overflow(a, b, &r);
+    return r;
+  };
+  std::uint64_t words = kHeaderWords;
+  words = add(words, mul(dim, dim));                            // lattice
+  words = add(words, mul(sites, dim));                          // positions
+  words = add(words, sites);                                    // orbitals
+  words = add(words, mul(translations, dim));                   // cells
+  words = add(words, mul(2, mul(translations, mul(n, n))));     // re, im
+  words = add(words, add(n, 1));                                // offsets
+  words = add(words, h[8]);                                     // adjacency
+  words = add(words, mul(h[9], add(dim, 2)));                   // bonds
+  std::uint64_t size = mul(words, 8);
+  return overflow ? 0 : size;
+}
+
+}  // namespace
+
+std::uint64_t content_hash(std::string_view bytes) {
+  std::size_t blocks = (bytes.size() + kHashBlock - 1) / kHashBlock;
+  std::vector<std::uint64_t> hashes(blocks);
+  parallel_for(
+      blocks,
+      [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t b = begin; b < end; b++) {
+          std::size_t first = b * kHashBlock;
+          std::size_t size = std::min(kHashBlock, bytes.size() - first);
+          hashes[b] = fnv1a(bytes.data() + first, size);
+        }
+      },
+      4);
+  std::uint64_t size = bytes.size();
+  hashes.push_back(size);
+  return fnv1a(reinterpret_cast<char const*>(hashes.data()),
+               hashes.size() * sizeof(std::uint64_t));
+}
+
+std::vector<char> compile_model(Model const& model, std::uint64_t source_hash,
+                                std::uint64_t source_size) {
+  std::size_t dim = model.dimension;
+  std::size_t n = model.total_orbitals();
+  std::size_t block = n * n;
+
+  // Group the hopping list by translation, in order of first appearance.
+  std::map<std::vector<std::int64_t>, std::size_t> index;
+  std::vector<std::int64_t> cells;
+  std::vector<double> re;
+  std::vector<double> im;
+  std::vector<std::int64_t> cell(dim);
+  for (std::size_t h = 0; h < model.hoppings(); h++) {
+    for (std::size_t d = 0; d < dim; d++) cell[d] = model.cells[h * dim + d];
+    auto [it, inserted] = index.emplace(cell, index.size());
+    if (inserted) {
+      cells.insert(cells.end(), cell.begin(), cell.end());
+      re.resize(re.size() + block, 0.0);
+      im.resize(im.size() + block, 0.0);
+    }
+    std::size_t k = it->second * block + model.from[h] * n + model.to[h];
+    re[k] += model.re[h];
+    im[k] += model.im[h];
+  }
+  std::size_t translations = index.size();
+
+  // Bonds within the home cell feed the graph; the others are stored once,
+  // oriented so that R is lexicographically positive.
+  std::vector<std::pair<std::size_t, std::size_t>> pairs;
+  std::vector<std::vector<std::int64_t>> crossing;
+  for (std::size_t r = 0; r < translations; r++) {
+    std::int64_t const* R = cells.data() + r * dim;
+    int sign = 0;
+    for (std::size_t d = 0; d < dim && sign == 0; d++) {
+      sign = R[d] > 0 ? 1 : (R[d] < 0 ? -1 : 0);
+    }
+    for (std::size_t a = 0; a < n; a++) {
+      for (std::size_t b = 0; b < n; b++) {
+        std::size_t k = r * block + a * n + b;
+        if (re[k] == 0.0 && im[k] == 0.0) continue;
+        if (sign == 0) {
+          if (a != b) pairs.emplace_back(a, b);
+          continue;
+        }
+        std::vector<std::int64_t> bond{static_cast<std::int64_t>(a),
+                                       static_cast<std::int64_t>(b)};
+        if (sign < 0) std::swap(bond[0], bond[1]);
+        for (std::size_t d = 0; d < dim; d++) bond.push_back(sign * R[d]);
+        crossing.push_back(std::move(bond));
+      }
+    }
+  }
+  std::sort(crossing.begin(), crossing.end());
+  crossing.erase(std::unique(crossing.begin(), crossing.end()),
+                 crossing.end());
+  Graph graph(n, pairs);
+
+  std::vector<char> out(sizeof(kMagic));
+  std::memcpy(out.data(), kMagic, sizeof(kMagic));
+  put(out, ModelCache::kVersion);
+  put(out, source_hash);
+  put(out, source_size);
+  put(out, dim);
+  put(out, model.sites());
+  put(out, n);
+  put(out, translations);
+  put(out, graph.adjacency().size());
+  put(out, crossing.size());
+  put(out, model.lattice.data(), model.lattice.size());
+  put(out, model.positions.data(), model.positions.size());
+  std::vector<std::uint64_t> orbitals(model.orbitals.begin(),
+                                      model.orbitals.end());
+  put(out, orbitals.data(), orbitals.size());
+  put(out, cells.data(), cells.size());
+  put(out, re.data(), re.size());
+  put(out, im.data(), im.size());
+  std::vector<std::uint64_t> offsets(graph.offsets().begin(),
+                                     graph.offsets().end());
+  std::vector<std::uint64_t> adjacency(graph.adjacency().begin(),
+                                       graph.adjacency().end());
+  put(out, offsets.data(), offsets.size());
+  put(out, adjacency.data(), adjacency.size());
+  for (auto const& bond : crossing) put(out, bond.data(), bond.size());
+  return out;
+}
+
+ModelCache::ModelCache(MappedFile file) : file_(std::move(file)) {
+  index(file_.view());
+}
+
+ModelCache::ModelCache(std::vector<char> bytes) : bytes_(std::move(bytes)) {
+  index({bytes_.data(), bytes_.size()});
+}
+
+bool ModelCache::matches(std::string_view bytes, std::uint64_t hash,
+                         std::uint64_t size) {
+  if (bytes.size() < kHeaderWords * 8) return false;
+  if (std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) return false;
+  std::uint64_t header[kHeaderWords];
+  std::memcpy(header, bytes.data(), sizeof(header));
+  if (header[1] != kVersion || header[2] != hash || header[3] != size) {
+    return false;
+  }
+  // A truncated or corrupt body must not reach index(), which would trap.
+  if (expected_size(bytes) != bytes.size()) return false;
+  std::uint64_t dim = header[4];
+  std::uint64_t sites = header[5];
+  std::uint64_t n = header[6];
+  std::uint64_t translations = header[7];
+  std::size_t offsets = kHeaderWords + dim * dim + sites * dim + sites +
+                        translations * dim + 2 * translations * n * n;
+  std::vector<std::uint64_t> row(n + 1);
+  std::memcpy(row.data(), bytes.data() + offsets * 8, (n + 1) * 8);
+  if (row[0] != 0 || row[n] != header[8]) return false;
+  for (std::size_t i = 0; i < n; i++) {
+    if (row[i] > row[i + 1]) return false;
+  }
+  for (std::uint64_t k = 0; k < header[8]; k++) {
+    std::uint64_t v;
+    std::memcpy(&v, bytes.data() + (offsets + n + 1 + k) * 8, 8);
+    if (v >= n) return false;
+  }
+  std::size_t bonds = offsets + n + 1 + header[8];
+  for (std::uint64_t b = 0; b < header[9]; b++) {
+    std::int64_t ends[2];
+    std::memcpy(ends, bytes.data() + (bonds + b * (dim + 2)) * 8, 16);
+    for (std::int64_t v : ends) {
+      if (v < 0 || static_cast<std::uint64_t>(v) >= n) return false;
+    }
+  }
+  return true;
+}
+
+void ModelCache::index(std::string_view bytes) {
+  ASSERT(bytes.size() >= kHeaderWords * 8 &&
+             std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) == 0,
+         "not a model cache");
+  ASSERT(reinterpret_cast<std::uintptr_t>(bytes.data()) % 8 == 0);
+  header_ = reinterpret_cast<std::uint64_t const*>(bytes.data());
+  ASSERT(header_[1] == kVersion, "unsupported model cache version");
+  ASSERT(expected_size(bytes) == bytes.size(), "truncated model cache");
+
+  std::size_t dim = dimension();
+  std::size_t n = orbitals();
+  char const* p = bytes.data() + kHeaderWords * 8;
+  auto take = [&](std::size_t words) {
+    char const* section = p;
+    p += words * 8;
+    return section;
+  };
+  lattice_ = reinterpret_cast<double const*>(take(dim * dim));
+  positions_ = reinterpret_cast<double const*>(take(sites() * dim));
+  site_orbitals_ = reinterpret_cast<std::uint64_t const*>(take(sites()));
+  cells_ = reinterpret_cast<std::int64_t const*>(take(translations() * dim));
+  re_ = reinterpret_cast<double const*>(take(translations() * n * n));
+  im_ = reinterpret_cast<double const*>(take(translations() * n * n));
+  offsets_ = reinterpret_cast<std::uint64_t const*>(take(n + 1));
+  adjacency_ = reinterpret_cast<std::uint64_t const*>(take(header_[8]));
+  bonds_ = reinterpret_cast<std::int64_t const*>(take(bonds() * (2 + dim)));
+  ASSERT(p == bytes.data() + bytes.size(), "truncated model cache");
+}
+
+Graph ModelCache::cell_graph() const {
+  std::size_t n = orbitals();
+  return {std::vector<std::size_t>(offsets_, offsets_ + n + 1),
+          std::vector<std::size_t>(adjacency_, adjacency_ + header_[8])};
+}
+
+ModelCache load_cached_model(std::string const& source,
+                             std::string const& cache) {
+  MappedFile text(source);
+  std::uint64_t hash = content_hash(text.view());
+  if (::access(cache.c_str(), R_OK) == 0) {
+    MappedFile compiled(cache);
+    if (ModelCache::matches(compiled.view(), hash, text.size())) {
+      return ModelCache(std::move(compiled));
+    }
+  }
+
+  std::vector<char> bytes =
+      compile_model(parse_model(text.view()), hash, text.size());
+  // Write under a private name and rename, so readers only ever see a
+  // complete file.
+  std::string partial = cache + ".tmp" + std::to_string(::getpid());
+  std::ofstream out(partial, std::ios::binary);
+  out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  out.close();
+  bool complete = !out.fail();
+  if (!complete || std::rename(partial.c_str(), cache.c_str()) != 0) {
+    std::remove(partial.c_str());
+    std::fprintf(stderr, "%s: cannot write model cache\n", cache.c_str());
+  }
+  return ModelCache(std::move(bytes));
+}
@@ -0,0 +1,178 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/moire.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+CommensurateAngle commensurate_angle(int m, int n) {
+  ASSERT(m >= 0 && n >= 0 && m != n);
+  double norm = static_cast<double>(m * m + m * n + n * n);
+  double cos = static_cast<double>(m * m + 4 * m * n + n * n) / (2.0 * norm);
+  return {m, n, std::acos(std::min(1.0, cos)),
+          static_cast<std::size_t>(m * m + m * n + n * n)};
+}
+
+std::vector<CommensurateAngle> commensurate_angles(int max_index) {
+  std::vector<CommensurateAngle> angles;
+  for (int n = 2; n <= max_index; n++) {
+    for (int m = 1; m < n; m++) {
+      if (std::gcd(m, n) != 1 || (n - m) % 3 == 0) continue;
+      angles.push_back(commensurate_angle(m, n));
+    }
+  }
+  std::sort(angles.begin(), angles.end(),
+            [](CommensurateAngle const& a, CommensurateAngle const& b) {
+              return a.angle > b.angle;
+            });
+  return angles;
+}
+
+CommensurateAngle closest_commensurate(double degrees, int max_index) {
+  std::vector<CommensurateAngle> angles = commensurate_angles(max_index);
+  ASSERT(!angles.empty());
+  double target = degrees * M_PI / 180.0;
+  return *std::min_element(
+      angles.begin(), angles.end(),
+      [&](CommensurateAngle const& a, CommensurateAngle const& b) {
+        return std::abs(a.angle - target) < std::abs(b.angle - target);
+      });
+}
+
+namespace detail {
+
+Matrix<double, 2, 2> rotation(double angle) {
+  return {{std::cos(angle), -std::sin(angle)},
+          {std::sin(angle), std::cos(angle)}};
+}
+
+Lattice<2> moire_superlattice(Lattice<2> const& lattice,
+                              CommensurateAngle const& twist) {
+  double m = twist.m;
+  double n = twist.n;
+  Vec<double, 2> l1 = lattice.vector(0) * n + lattice.vector(1) * m;
+  Vec<double, 2> l2 = lattice.vector(0) * -m + lattice.vector(1) * (n + m);
+  return Lattice<2>({{l1[0], l1[1]}, {l2[0], l2[1]}});
+}
+
+}  // namespace detail
+
+std::pair<MoireBilayer::Cell, MoireBilayer::Cell> MoireBilayer::wrap(
+    Layer const& layer, Cell const& p) const {
+  auto const& adj = layer.adjugate;
+  auto const& v = layer.vectors;
+  long N = static_cast<long>(cells_);
+  Cell shift = {floor_div(adj[0][0] * p[0] + adj[0][1] * p[1], N),
+                floor_div(adj[1][0] * p[0] + adj[1][1] * p[1], N)};
+  Cell inside = {p[0] - v[0][0] * shift[0] - v[0][1] * shift[1],
+                 p[1] - v[1][0] * shift[0] - v[1][1] * shift[1]};
+  return {inside, shift};
+}
+
+void MoireBilayer::enumerate(Layer& layer) const {
+  // Bounding box of the supercell's corners, in the layer's basis.
+  auto const& v = layer.vectors;
+  Cell low = {0, 0};
+  Cell high = {0, 0};
+  for (long i : {0, 1}) {
+    for (long j : {0, 1}) {
+      for (std::size_t d = 0; d < 2; d++) {
+        long x = i * v[d][0] + j * v[d][1];
+        low[d] = std::min(low[d], x);
+        high[d] = std::max(high[d], x);
+      }
+    }
+  }
+  layer.points.reserve(cells_);
+  layer.index.reserve(cells_);
+  auto const& adj = layer.adjugate;
+  long N = static_cast<long>(cells_);
+  for (long x = low[0]; x <= high[0]; x++) {
+    for (long y = low[1]; y <= high[1]; y++) {
+      long f0 = adj[0][0] * x + adj[0][1] * y;
+      long f1 = adj[1][0] * x + adj[1][1] * y;
+      if (f0 < 0 || f0 >= N || f1 < 0 || f1 >= N) continue;
+      layer.index.emplace(key({x, y}), layer.points.size());
+      layer.points.push_back({x, y});
+    }
+  }
+  ASSERT(layer.points.size() == cells_);
+}
+
+std::size_t MoireBilayer::translation(Cell const& c) {
+  auto [it, inserted] = translation_index_.emplace(c, translations_.size());
+  if (inserted) {
+    translations_.push_back(
+        Vec<int, 2>{static_cast<int>(c[0]), static_cast<int>(c[1])});
+  }
+  return it->second;
+}
+
+Graph MoireBilayer::graph() const {
+  std::vector<std::size_t> offsets(size() + 1, 0);
+  std::vector<std::vector<std::size_t>> rows(size());
+  parallel_for(size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t i = begin; i < end; i++) {
+      auto& row = rows[i];
+      for (std::size_t h = first_hop_[i]; h < first_hop_[i + 1]; h++) {
+        if (hops_[h].to != i) row.push_back(hops_[h].to);
+      }
+      std::sort(row.begin(), row.end());
+      row.erase(std::unique(row.begin(), row.end()), row.end());
+    }
+  });
+  for (std::size_t i = 0; i < size(); i++) {
+    offsets[i + 1] = offsets[i] + rows[i].size();
+  }
+  std::vector<std::size_t> adjacency;
+  adjacency.reserve(offsets.back());
+  for (auto& row : rows) {
+    adjacency.insert(adjacency.end(), row.begin(), row.end());
+    std::vector<std::size_t>().swap(row);
+  }
+  return {std::move(offsets), std::move(adjacency)};
+}
+
+void MoireBilayer::hamiltonian(
+    Vec<double, 2> const& k, SparseMatrix<std::complex<double>>& h) const {
+  ASSERT(h.size() == size() && h.triangle() == Triangle::Full);
+  std::vector<std::complex<double>> phase(translations_.size());
+  for (std::size_t c = 0; c < translations_.size(); c++) {
+    double angle = k[0] * translations_[c][0] + k[1] * translations_[c][1];
+    phase[c] = std::polar(1.0, 2.0 * M_PI * angle);
+  }
+  std::vector<std::complex<double>>& values = h.values();
+  parallel_for(size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+    std::fill(values.begin() + h.offsets()[begin],
+              values.begin() + h.offsets()[end], 0.0);
+    for (std::size_t i = begin; i < end; i++) {
+      for (std::size_t x = first_hop_[i]; x < first_hop_[i + 1]; x++) {
+        values[h.find(i, hops_[x].to)] += hops_[x].t * phase[hops_[x].cell];
+      }
+    }
+  });
+}
+
+SparseMatrix<std::complex<double>> MoireBilayer::hamiltonian(
+    Vec<double, 2> const& k) const {
+  SparseMatrix<std::complex<double>> h(graph());
+  hamiltonian(k, h);
+  return h;
+}
+
@@ -0,0 +1,162 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/mutation.h>
+
+#include <algorithm>
+
+MutableGraph::MutableGraph(Graph const& graph, std::size_t slack)
+    : slack_(slack) {
+  std::size_t n = graph.size();
+  begin_.resize(n);
+  count_.resize(n);
+  capacity_.resize(n);
+  alive_.assign(n, 1);
+  adjacency_.reserve(2 * graph.bonds() + n * slack);
+  for (std::size_t v = 0; v < n; v++) {
+    auto row = graph.neighbors(v);
+    begin_[v] = adjacency_.size();
+    count_[v] = row.size();
+    capacity_[v] = row.size() + slack;
+    adjacency_.insert(adjacency_.end(), row.begin(), row.end());
+    adjacency_.resize(adjacency_.size() + slack, npos);
+  }
+}
+
+void MutableGraph::apply(GraphEdits const& edits) {
+  for (auto const& [u, v] : edits.removed_bonds) {
+    ASSERT(u < size() && v < size());
+    erase_bond(u, v);
+  }
+
+  for (std::size_t v : edits.removed_sites) {
+    ASSERT(v < size());
+    if (!alive_[v]) continue;
+    while (count_[v] > 0) erase_bond(v, adjacency_[begin_[v]]);
+    alive_[v] = 0;
+    dead_++;
+  }
+
+  for (std::size_t v : edits.inserted_sites) {
+    ASSERT(v <= size());
+    if (v == size()) {
+      begin_.push_back(adjacency_.size());
+      count_.push_back(0);
+      capacity_.push_back(slack_);
+      alive_.push_back(1);
+      adjacency_.resize(adjacency_.size() + slack_, npos);
+    } else if (!alive_[v]) {
+      alive_[v] = 1;
+      dead_--;
+    }
+  }
+
+  for (auto const& [u, v] : edits.inserted_bonds) {
+    ASSERT(u < size() && v < size() && alive_[u] && alive_[v]);
+    if (u == v || has_bond(u, v)) continue;
+    insert_bond(u, v);
+    insert_bond(v, u);
+  }
+}
+
+bool MutableGraph::has_bond(std::size_t u, std::size_t v) const {
+  auto row = neighbors(u);
+  return std::find(row.begin(), row.end(), v) != row.end();
+}
+
+double MutableGraph::garbage() const {
+  if (adjacency_.empty()) return 0.0;
+  std::size_t held = wasted_;
+  for (std::size_t v = 0; v < size(); v++) {
+    if (!alive_[v]) held += capacity_[v];
+  }
+  return static_cast<double>(held) / static_cast<double>(adjacency_.size());
+}
+
+Graph MutableGraph::graph() const {
+  std::vector<std::size_t> offsets(size() + 1, 0);
+  std::vector<std::size_t> adjacency;
+  adjacency.reserve(adjacency_.size());
+  for (std::size_t v = 0; v < size(); v++) {
+    auto row = neighbors(v);
+    adjacency.insert(adjacency.end(), row.begin(), row.end());
+    std::sort(adjacency.begin() + offsets[v], adjacency.end());
+    offsets[v + 1] = adjacency.size();
+  }
+  return {std::move(offsets), std::move(adjacency)};
+}
+
+std::vector<std::size_t> MutableGraph::compact() {
+  std::vector<std::size_t> renumber(size(), npos);
+  std::size_t survivors = 0;
+  for (std::size_t v = 0; v < size(); v++) {
+    if (alive_[v]) renumber[v] = survivors++;
+  }
+
+  std::vector<std::size_t> begin(survivors);
+  std::vector<std::size_t> count(survivors);
+  std::vector<std::size_t> capacity(survivors);
+  std::vector<std::size_t> adjacency;
+  adjacency.reserve(adjacency_.size());
+  for (std::size_t v = 0; v < size(); v++) {
+    if (!alive_[v]) continue;
+    std::size_t w = renumber[v];
+    begin[w] = adjacency.size();
+    count[w] = count_[v];
+    capacity[w] = count_[v] + slack_;
+    for (std::size_t u : neighbors(v)) adjacency.push_back(renumber[u]);
+    adjacency.resize(adjacency.size() + slack_, npos);
+  }
+
+  begin_ = std::move(begin);
+  count_ = std::move(count);
+  capacity_ = std::move(capacity);
+  adjacency_ = std::move(adjacency);
+  alive_.assign(survivors, 1);
+  dead_ = 0;
+  wasted_ = 0;
+  return renumber;
+}
+
+void MutableGraph::insert_bond(std::size_t u, std::size_t v) {
+  if (count_[u] == capacity_[u]) {
+    // Move the row to the end with room to grow; its old slots are garbage
+    // until the next compaction.
+    std::size_t capacity = 2 * capacity_[u] + slack_ + 1;
+    std::size_t begin = adjacency_.size();
+    adjacency_.resize(begin + capacity, npos);
+    std::copy_n(adjacency_.begin() + begin_[u], count_[u],
+                adjacency_.begin() + begin);
+    wasted_ += capacity_[u];
+    begin_[u] = begin;
+    capacity_[u] = capacity;
+  }
+  adjacency_[begin_[u] + count_[u]++] = v;
+}
+
+void MutableGraph::erase_bond(std::size_t u, std::size_t v) {
+  for (std::size_t w : {u, v}) {
+    std::size_t other = w == u ? v : u;
+    std::size_t* row = adjacency_.data() + begin_[w];
+    std::size_t* last = row + count_[w];
+    std::size_t* it = std::find(row, last, other);
+    if (it == last) continue;
+    *it = *(last - 1);
+    *(last - 1) = npos;
+    count_[w]--;
+  }
+}
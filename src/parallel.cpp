@@ -0,0 +1,44 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> thread_limit{
+    std::max<std::size_t>(1, std::thread::hardware_concurrency())};
+
+}  // namespace
+
+std::size_t max_threads() { return thread_limit.load(); }
+
+void set_max_threads(std::size_t threads) {
+  thread_limit.store(std::max<std::size_t>(1, threads));
+}
+
+void parallel_run(std::size_t threads,
+                  std::function<void(std::size_t)> const& task) {
+  std::vector<std::thread> workers;
+  workers.reserve(threads > 0 ? threads - 1 : 0);
+  for (std::size_t t = 1; t < threads; t++) workers.emplace_back(task, t);
+  if (threads > 0) task(0);
+  for (auto& worker : workers) worker.join();
+}
@@ -0,0 +1,429 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/partition.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <random>
+
+namespace {
+
+constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+// Graphs at or below this size are bisected directly.
+constexpr std::size_t kCoarsestSize = 64;
+
+// Number of region-growing attempts on the coarsest graph.
+constexpr int kInitialTrials = 4;
+
+constexpr int kRefinementPasses = 8;
+
+struct WeightedGraph {
+  std::vector<std::size_t> offsets{0};
+  std::vector<std::size_t> adjacency;
+  std::vector<long> edge_weights;
+  std::vector<long> vertex_weights;
+
+  [[nodiscard]] std::size_t size() const { return vertex_weights.size(); }
+
+  [[nodiscard]] long total_weight() const {
+    return std::accumulate(vertex_weights.begin(), vertex_weights.end(), 0L);
+  }
+};
+
+WeightedGraph from_graph(Graph const& graph) {
+  WeightedGraph g;
+  g.offsets = graph.offsets();
+  g.adjacency = graph.adjacency();
+  g.edge_weights.assign(g.adjacency.size(), 1);
+  g.vertex_weights.assign(graph.size(), 1);
+  return g;
+}
+
+// Collapses a heavy-edge matching of `g`. `cmap` receives the coarse vertex of
+// every fine vertex.
+WeightedGraph coarsen(WeightedGraph const& g, std::vector<std::size_t>& cmap,
+                      std::mt19937& rng) {
+  std::size_t n = g.size();
+  std::vector<std::size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), rng);
+
+  std::vector<std::size_t> match(n, npos);
+  for (std::size_t v : order) {
+    if (match[v] != npos) continue;
+    std::size_t best = v;
+    long best_weight = -1;
+    for (std::size_t e = g.offsets[v]; e < g.offsets[v + 1]; e++) {
+      std::size_t u = g.adjacency[e];
+      if (match[u] == npos && u != v && g.edge_weights[e] > best_weight) {
+        best = u;
+        best_weight = g.edge_weights[e];
+      }
+    }
+    match[v] = best;
+    match[best] = v;
+  }
+
+  cmap.assign(n, npos);
+  std::vector<std::size_t> representatives;
+  for (std::size_t v = 0; v < n; v++) {
+    if (cmap[v] != npos) continue;
+    cmap[v] = cmap[match[v]] = representatives.size();
+    representatives.push_back(v);
+  }
+
+  WeightedGraph coarse;
+  std::size_t nc = representatives.size();
+  coarse.vertex_weights.resize(nc);
+  coarse.offsets.reserve(nc + 1);
+  std::vector<std::size_t> slot(nc, npos);
+  for (std::size_t c = 0; c < nc; c++) {
+    std::size_t first = representatives[c];
+    std::size_t members[2] = {first, match[first]};
+    int count = members[1] == first ? 1 : 2;
+    std::size_t row_begin = coarse.adjacency.size();
+    long weight = 0;
+    for (int m = 0; m < count; m++) {
+      std::size_t v = members[m];
+      weight += g.vertex_weights[v];
+      for (std::size_t e = g.offsets[v]; e < g.offsets[v + 1]; e++) {
+        std::size_t cu = cmap[g.adjacency[e]];
+        if (cu == c) continue;
+        if (slot[cu] == npos) {
+          slot[cu] = coarse.adjacency.size();
+          coarse.adjacency.push_back(cu);
+          coarse.edge_weights.push_back(g.edge_weights[e]);
+        } else {
+          coarse.edge_weights[slot[cu]] += g.edge_weights[e];
+        }
+      }
+    }
+    for (std::size_t e = row_begin; e < coarse.adjacency.size(); e++) {
+      slot[coarse.adjacency[e]] = npos;
+    }
+    coarse.vertex_weights[c] = weight;
+    coarse.offsets.push_back(coarse.adjacency.size());
+  }
+  return coarse;
+}
+
+struct Balance {
+  long target;     // desired weight of side 0
+  long tolerance;  // allowed deviation from the target
+
+  [[nodiscard]] long excess(long weight0) const {
+    return std::max(0L, std::abs(weight0 - target) - tolerance);
+  }
+};
+
+long cut_of(WeightedGraph const& g, std::vector<int> const& side) {
+  long cut = 0;
+  for (std::size_t v = 0; v < g.size(); v++) {
+    for (std::size_t e = g.offsets[v]; e < g.offsets[v + 1]; e++) {
+      if (side[v] != side[g.adjacency[e]]) cut += g.edge_weights[e];
+    }
+  }
+  return cut / 2;
+}
+
+long weight_of_side0(WeightedGraph const& g, std::vector<int> const& side) {
+  long w = 0;
+  for (std::size_t v = 0; v < g.size(); v++) {
+    if (side[v] == 0) w += g.vertex_weights[v];
+  }
+  return w;
+}
+
+// Fiduccia-Mattheyses refinement. Each pass moves every vertex at most once,
+// always taking the highest-gain move that does not worsen the balance, and
+// then rolls back to the best prefix of moves.
+void refine(WeightedGraph const& g, std::vector<int>& side,
+            Balance const& balance) {
+  using Entry = std::pair<long, std::size_t>;
+  std::size_t n = g.size();
+  std::size_t stall_limit = std::max<std::size_t>(64, n / 20);
+  std::vector<long> gain(n);
+  std::vector<char> locked(n);
+  std::vector<std::size_t> moves;
+
+  for (int pass = 0; pass < kRefinementPasses; pass++) {
+    long cut = 0;
+    for (std::size_t v = 0; v < n; v++) {
+      long external = 0;
+      long internal = 0;
+      for (std::size_t e = g.offsets[v]; e < g.offsets[v + 1]; e++) {
+        if (side[g.adjacency[e]] == side[v]) {
+          internal += g.edge_weights[e];
+        } else {
+          external += g.edge_weights[e];
+        }
+      }
+      gain[v] = external - internal;
+      cut += external;
+    }
+    cut /= 2;
+
+    std::priority_queue<Entry> heaps[2];
+    for (std::size_t v = 0; v < n; v++) heaps[side[v]].emplace(gain[v], v);
+    std::fill(locked.begin(), locked.end(), 0);
+    moves.clear();
+
+    long weight0 = weight_of_side0(g, side);
+    long best_cut = cut;
+    long best_excess = balance.excess(weight0);
+    std::size_t best_moves = 0;
+
+    while (moves.size() - best_moves < stall_limit) {
+      long current_excess = balance.excess(weight0);
+      std::size_t chosen = npos;
+      for (int s = 0; s < 2; s++) {
+        auto& heap = heaps[s];
+        while (!heap.empty()) {
+          auto [g_top, v] = heap.top();
+          if (!locked[v] && side[v] == s && gain[v] == g_top) break;
+          heap.pop();
+        }
+        if (heap.empty()) continue;
+        std::size_t v = heap.top().second;
+        long moved = s == 0 ? -g.vertex_weights[v] : g.vertex_weights[v];
+        if (balance.excess(weight0 + moved) > current_excess) continue;
+        if (chosen == npos || gain[v] > gain[chosen]) chosen = v;
+      }
+      if (chosen == npos) break;
+
+      std::size_t v = chosen;
+      int from = side[v];
+      heaps[from].pop();
+      side[v] = 1 - from;
+      locked[v] = 1;
+      cut -= gain[v];
+      weight0 += from == 0 ? -g.vertex_weights[v] : g.vertex_weights[v];
+      gain[v] = -gain[v];
+      for (std::size_t e = g.offsets[v]; e < g.offsets[v + 1]; e++) {
+        std::size_t u = g.adjacency[e];
+        gain[u] += side[u] == side[v] ? -2 * g.edge_weights[e]
+                                      : 2 * g.edge_weights[e];
+        if (!locked[u]) heaps[side[u]].emplace(gain[u], u);
+      }
+      moves.push_back(v);
+
+      long excess = balance.excess(weight0);
+      if (excess < best_excess || (excess == best_excess && cut < best_cut)) {
+        best_excess = excess;
+        best_cut = cut;
+        best_moves = moves.size();
+      }
+    }
+
+    for (std::size_t i = moves.size(); i > best_moves; i--) {
+      std::size_t v = moves[i - 1];
+      side[v] = 1 - side[v];
+    }
+    if (best_moves == 0) break;
+  }
+}
+
+// Greedy region growing: breadth-first search from `seed` until side 0
+// reaches its target weight.
+std::vector<int> grow(WeightedGraph const& g, std::size_t seed, long target) {
+  std::vector<int> side(g.size(), 1);
+  std::queue<std::size_t> frontier;
+  long weight0 = 0;
+  std::size_t next_unvisited = 0;
+  frontier.push(seed);
+  side[seed] = 0;
+  while (weight0 < target) {
+    if (frontier.empty()) {
+      // The graph is disconnected; restart from another component.
+      while (next_unvisited < g.size() && side[next_unvisited] == 0) {
+        next_unvisited++;
+      }
+      if (next_unvisited == g.size()) break;
+      side[next_unvisited] = 0;
+      frontier.push(next_unvisited);
+    }
+    std::size_t v = frontier.front();
+    frontier.pop();
+    weight0 += g.vertex_weights[v];
+    for (std::size_t e = g.offsets[v]; e < g.offsets[v + 1]; e++) {
+      std::size_t u = g.adjacency[e];
+      if (side[u] == 1) {
+        side[u] = 0;
+        frontier.push(u);
+      }
+    }
+  }
+  // Vertices discovered but never popped go back to side 1.
+  while (!frontier.empty()) {
+    side[frontier.front()] = 1;
+    frontier.pop();
+  }
+  return side;
+}
+
+Balance balance_for(WeightedGraph const& g, double fraction,
+                    double imbalance) {
+  long total = g.total_weight();
+  long target = static_cast<long>(fraction * static_cast<double>(total));
+  long heaviest =
+      *std::max_element(g.vertex_weights.begin(), g.vertex_weights.end());
+  long slack = static_cast<long>(
+      imbalance * static_cast<double>(std::min(target, total - target)));
+  return {target, std::max(slack, heaviest / 2)};
+}
+
+// Splits `g` so that side 0 holds `fraction` of the vertex weight.
+std::vector<int> bisect(WeightedGraph const& g, double fraction,
+                        double imbalance, std::mt19937& rng) {
+  std::vector<WeightedGraph> levels;
+  std::vector<std::vector<std::size_t>> maps;
+  WeightedGraph const* current = &g;
+  while (current->size() > kCoarsestSize) {
+    std::vector<std::size_t> cmap;
+    WeightedGraph coarse = coarsen(*current, cmap, rng);
+    if (coarse.size() * 10 > current->size() * 9) break;
+    levels.push_back(std::move(coarse));
+    maps.push_back(std::move(cmap));
+    current = &levels.back();
+  }
+
+  WeightedGraph const& coarsest = levels.empty() ? g : levels.back();
+  Balance balance = balance_for(coarsest, fraction, imbalance);
+  std::uniform_int_distribution<std::size_t> pick(0, coarsest.size() - 1);
+  std::vector<int> side;
+  long best_cut = 0;
+  long best_excess = 0;
+  for (int trial = 0; trial < kInitialTrials; trial++) {
+    std::vector<int> candidate = grow(coarsest, pick(rng), balance.target);
+    refine(coarsest, candidate, balance);
+    long cut = cut_of(coarsest, candidate);
+    long excess = balance.excess(weight_of_side0(coarsest, candidate));
+    if (side.empty() || excess < best_excess ||
+        (excess == best_excess && cut < best_cut)) {
+      side = std::move(candidate);
+      best_cut = cut;
+      best_excess = excess;
+    }
+  }
+
+  for (std::size_t l = levels.size(); l > 0; l--) {
+    WeightedGraph const& fine = l == 1 ? g : levels[l - 2];
+    std::vector<std::size_t> const& cmap = maps[l - 1];
+    std::vector<int> projected(fine.size());
+    for (std::size_t v = 0; v < fine.size(); v++) projected[v] = side[cmap[v]];
+    side = std::move(projected);
+    refine(fine, side, balance_for(fine, fraction, imbalance));
+  }
+  return side;
+}
+
+// Induced subgraph on the vertices with side[v] == which. `ids` receives the
+// vertex of `g` behind every subgraph vertex.
+WeightedGraph extract(WeightedGraph const& g, std::vector<int> const& side,
+                      int which, std::vector<std::size_t>& ids) {
+  std::vector<std::size_t> local(g.size(), npos);
+  ids.clear();
+  for (std::size_t v = 0; v < g.size(); v++) {
+    if (side[v] != which) continue;
+    local[v] = ids.size();
+    ids.push_back(v);
+  }
+
+  WeightedGraph sub;
+  sub.vertex_weights.reserve(ids.size());
+  for (std::size_t v : ids) {
+    for (std::size_t e = g.offsets[v]; e < g.offsets[v + 1]; e++) {
+      std::size_t u = g.adjacency[e];
+      if (local[u] == npos) continue;
+      sub.adjacency.push_back(local[u]);
+      sub.edge_weights.push_back(g.edge_weights[e]);
+    }
+    sub.offsets.push_back(sub.adjacency.size());
+    sub.vertex_weights.push_back(g.vertex_weights[v]);
+  }
+  return sub;
+}
+
+void recurse(WeightedGraph const& g, std::vector<std::size_t> const& global,
+             std::size_t parts, std::size_t first_part, double imbalance,
+             std::mt19937& rng, std::vector<std::size_t>& out) {
+  if (parts == 1 || g.size() <= 1) {
+    for (std::size_t v : global) out[v] = first_part;
+    return;
+  }
+
+  std::size_t left = parts / 2;
+  double fraction = static_cast<double>(left) / static_cast<double>(parts);
+  std::vector<int> side = bisect(g, fraction, imbalance, rng);
+
+  for (int which = 0; which < 2; which++) {
+    std::vector<std::size_t> ids;
+    WeightedGraph sub = extract(g, side, which, ids);
+    for (std::size_t& id : ids) id = global[id];
+    if (which == 0) {
+      recurse(sub, ids, left, first_part, imbalance, rng, out);
+    } else {
+      recurse(sub, ids, parts - left, first_part + left, imbalance, rng, out);
+    }
+  }
+}
+
+}  // namespace
+
+Partition partition(Graph const& graph, std::size_t parts, double imbalance) {
+  ASSERT(parts > 0);
+  std::size_t n = graph.size();
+
+  Partition result;
+  result.part.assign(n, 0);
+  result.boundary.resize(parts);
+  result.ghosts.resize(parts);
+  if (n == 0) return result;
+
+  // A fixed seed keeps partitions reproducible from run to run.
+  std::mt19937 rng(5489u);
+  std::vector<std::size_t> global(n);
+  std::iota(global.begin(), global.end(), 0);
+  // Imbalance compounds down the recursion, so each bisection gets a share of
+  // the budget.
+  int depth = 0;
+  while ((std::size_t{1} << depth) < parts) depth++;
+  double level_imbalance = imbalance / std::max(depth, 1);
+  recurse(from_graph(graph), global, parts, 0, level_imbalance, rng,
+          result.part);
+
+  for (std::size_t v = 0; v < n; v++) {
+    std::size_t p = result.part[v];
+    bool on_boundary = false;
+    for (std::size_t u : graph.neighbors(v)) {
+      if (result.part[u] == p) continue;
+      on_boundary = true;
+      result.ghosts[p].push_back(u);
+      if (u > v) result.edge_cut++;
+    }
+    if (on_boundary) result.boundary[p].push_back(v);
+  }
+  for (auto& ghosts : result.ghosts) {
+    std::sort(ghosts.begin(), ghosts.end());
+    ghosts.erase(std::unique(ghosts.begin(), ghosts.end()), ghosts.end());
+  }
+  return result;
+}
@@ -0,0 +1,106 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/parallel.h>
+#include <tightb/spin.h>
+
+#include <utility>
+
+SpinMatrix::SpinMatrix(Graph const& graph) : h0_(graph) {}
+
+std::vector<std::complex<double>>& SpinMatrix::values(Pauli a) {
+  auto& values = spin_[index(a)];
+  if (values.empty()) values.assign(h0_.nonzeros(), 0.0);
+  return values;
+}
+
+std::complex<double>& SpinMatrix::at(Pauli a, std::size_t i, std::size_t j) {
+  std::size_t k = h0_.find(i, j);
+  ASSERT(k != SparseMatrix<std::complex<double>>::npos);
+  return values(a)[k];
+}
+
+Matrix<std::complex<double>, 2, 2> SpinMatrix::block(std::size_t i,
+                                                     std::size_t j) const {
+  std::size_t k = h0_.find(i, j);
+  ASSERT(k != SparseMatrix<std::complex<double>>::npos);
+  auto value = [&](std::size_t a) {
+    return spin_[a].empty() ? std::complex<double>() : spin_[a][k];
+  };
+  return spin_block(h0_.values()[k], value(0), value(1), value(2));
+}
+
+void SpinMatrix::multiply(std::complex<double> const* x,
+                          std::complex<double>* y) const {
+  using complex = std::complex<double>;
+  auto const& offsets = h0_.offsets();
+  auto const& columns = h0_.columns();
+  complex const* h0 = h0_.values().data();
+  complex const* hx = spin_[0].empty() ? nullptr : spin_[0].data();
+  complex const* hy = spin_[1].empty() ? nullptr : spin_[1].data();
+  complex const* hz = spin_[2].empty() ? nullptr : spin_[2].data();
+  complex const zero;
+
+  parallel_for(size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t i = begin; i < end; i++) {
+      complex up;
+      complex down;
+      for (std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+        std::size_t j = columns[k];
+        Matrix<complex, 2, 2> b =
+            spin_block(h0[k], hx != nullptr ? hx[k] : zero,
+                       hy != nullptr ? hy[k] : zero,
+                       hz != nullptr ? hz[k] : zero);
+        complex x0 = x[2 * j];
+        complex x1 = x[2 * j + 1];
+        up += b.at(0, 0) * x0 + b.at(0, 1) * x1;
+        down += b.at(1, 0) * x0 + b.at(1, 1) * x1;
+      }
+      y[2 * i] = up;
+      y[2 * i + 1] = down;
+    }
+  });
+}
+
+SparseMatrix<std::complex<double>> SpinMatrix::expand() const {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t i = 0; i < size(); i++) {
+    bonds.emplace_back(2 * i, 2 * i + 1);
+    for (std::size_t k = h0_.offsets()[i]; k < h0_.offsets()[i + 1]; k++) {
+      std::size_t j = h0_.columns()[k];
+      if (j <= i) continue;
+      for (std::size_t s = 0; s < 2; s++) {
+        for (std::size_t t = 0; t < 2; t++) {
+          bonds.emplace_back(2 * i + s, 2 * j + t);
+        }
+      }
+    }
+  }
+  SparseMatrix<std::complex<double>> full(Graph(2 * size(), bonds));
+  for (std::size_t i = 0; i < size(); i++) {
+    for (std::size_t k = h0_.offsets()[i]; k < h0_.offsets()[i + 1]; k++) {
+      std::size_t j = h0_.columns()[k];
+      Matrix<std::complex<double>, 2, 2> b = block(i, j);
+      for (std::size_t s = 0; s < 2; s++) {
+        for (std::size_t t = 0; t < 2; t++) {
+          full.at(2 * i + s, 2 * j + t) = b.at(s, t);
+        }
+      }
+    }
+  }
+  return full;
+}
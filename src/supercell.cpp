@@ -0,0 +1,105 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <tightb/assert.h>
+#include <tightb/supercell.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'B', 'G', 'R', 'A', 'P', 'H', '\0'};
+constexpr std::uint64_t kVersion = 1;
+constexpr std::size_t kChunk = 1 << 16;  // neighbors per read
+
+void put(std::ostream& out, std::uint64_t value) {
+  out.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+std::uint64_t get(std::istream& in) {
+  std::uint64_t value = 0;
+  in.read(reinterpret_cast<char*>(&value), sizeof(value));
+  ASSERT(in.good(), "truncated graph file");
+  return value;
+}
+
+}  // namespace
+
+// Layout: magic, version and number of sites, followed by chunks of
+// [rows, bonds, degree of every row, neighbors of every row], all as native
+// 64-bit integers.
+void write_graph_header(std::ostream& out, std::size_t sites) {
+  out.write(kMagic, sizeof(kMagic));
+  put(out, kVersion);
+  put(out, sites);
+}
+
+void write_chunk(std::ostream& out, GraphChunk const& chunk) {
+  std::size_t rows = chunk.offsets.size() - 1;
+  put(out, rows);
+  put(out, chunk.adjacency.size());
+  for (std::size_t r = 0; r < rows; r++) {
+    put(out, chunk.offsets[r + 1] - chunk.offsets[r]);
+  }
+  static_assert(sizeof(std::size_t) == sizeof(std::uint64_t));
+  out.write(reinterpret_cast<char const*>(chunk.adjacency.data()),
+            static_cast<std::streamsize>(chunk.adjacency.size() *
+                                         sizeof(std::size_t)));
+}
+
+Graph read_graph(std::istream& in) {
+  char magic[sizeof(kMagic)];
+  in.read(magic, sizeof(magic));
+  ASSERT(in.good() && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0,
+         "not a graph file");
+  ASSERT(get(in) == kVersion, "unsupported graph file version");
+  std::size_t sites = get(in);
+
+  // Every count is untrusted until the data it describes arrives, so the
+  // arrays grow with what is actually read.
+  std::vector<std::size_t> offsets{0};
+  std::vector<std::size_t> adjacency;
+  while (offsets.size() <= sites) {
+    std::size_t rows = get(in);
+    std::size_t bonds = get(in);
+    ASSERT(rows <= sites + 1 - offsets.size() &&
+               bonds <= adjacency.max_size() - adjacency.size(),
+           "corrupt graph chunk");
+    std::size_t sum = 0;
+    for (std::size_t r = 0; r < rows; r++) {
+      std::size_t degree = get(in);
+      ASSERT(degree <= bonds - sum, "corrupt graph chunk");
+      sum += degree;
+      offsets.push_back(offsets.back() + degree);
+    }
+    ASSERT(sum == bonds, "corrupt graph chunk");
+    std::size_t end = adjacency.size() + bonds;
+    while (adjacency.size() < end) {
+      std::size_t begin = adjacency.size();
+      adjacency.resize(begin + std::min(kChunk, end - begin));
+      in.read(reinterpret_cast<char*>(adjacency.data() + begin),
+              static_cast<std::streamsize>((adjacency.size() - begin) *
+                                           sizeof(std::size_t)));
+      ASSERT(in.good(), "truncated graph file");
+      for (std::size_t k = begin; k < adjacency.size(); k++) {
+        ASSERT(adjacency[k] < sites, "graph neighbor out of range");
+      }
+    }
+  }
+  return {std::move(offsets), std::move(adjacency)};
+}
@@ -0,0 +1,213 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_BANDS_H
+#define TIGHTB_BANDS_H
+
+#include <tightb/assert.h>
+#include <tightb/bloch.h>
+#include <tightb/eigen.h>
+#include <tightb/lattice.h>
+#include <tightb/parallel.h>
+#include <tightb/vector.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Piecewise linear path through named high-symmetry points, e.g. G-K-M-G.
+// Points are spread over the segments in proportion to their Cartesian length
+// so the spacing is uniform along the whole path, and each segment is stored
+// as start + i step so it can be evaluated with BlochHamiltonian::walk().
+template <std::size_t D>
+class KPath {
+ public:
+  struct Segment {
+    Vec<double, D> start;  // reduced coordinates
+    Vec<double, D> step;
+    std::size_t first;     // index of the first point of the segment
+    std::size_t count;
+  };
+
+  // `route` names the corners in order, `points` gives their reduced
+  // coordinates. The path has `count` points including both ends.
+  KPath(Lattice<D> const& lattice,
+        std::map<std::string, Vec<double, D>> const& points,
+        std::vector<std::string> const& route, std::size_t count);
+
+  [[nodiscard]] std::size_t size() const { return distance_.size(); }
+
+  [[nodiscard]] std::vector<Segment> const& segments() const {
+    return segments_;
+  }
+
+  // Reduced coordinates of point i.
+  [[nodiscard]] Vec<double, D> point(std::size_t i) const;
+
+  // Cartesian arc length from the start of the path to point i, the natural
+  // abscissa of a band plot.
+  [[nodiscard]] double distance(std::size_t i) const { return distance_[i]; }
+
+  // Point index and name of every corner of the route.
+  [[nodiscard]] std::vector<std::pair<std::size_t, std::string>> const&
+  labels() const {
+    return labels_;
+  }
+
+ private:
+  std::vector<Segment> segments_;
+  std::vector<double> distance_;
+  std::vector<std::pair<std::size_t, std::string>> labels_;
+};
+
+template <std::size_t D>
+KPath<D>::KPath(Lattice<D> const& lattice,
+                std::map<std::string, Vec<double, D>> const& points,
+                std::vector<std::string> const& route, std::size_t count) {
+  ASSERT(route.size() >= 2, "a path needs at least two points");
+  std::vector<Vec<double, D>> corners;
+  for (auto const& name : route) {
+    auto it = points.find(name);
+    ASSERT(it != points.end(), "unknown high-symmetry point");
+    corners.push_back(it->second);
+  }
+  std::size_t pieces = corners.size() - 1;
+  ASSERT(count >= pieces + 1);
+
+  std::vector<double> length(pieces);
+  double total = 0.0;
+  for (std::size_t s = 0; s < pieces; s++) {
+    Vec<double, D> dk = lattice.k_to_cartesian(corners[s + 1] - corners[s]);
+    double sum = 0.0;
+    for (std::size_t d = 0; d < D; d++) sum += dk[d] * dk[d];
+    length[s] = std::sqrt(sum);
+    total += length[s];
+  }
+
+  // The final corner is a point of its own; the others start a segment.
+  std::size_t interior = count - 1;
+  std::size_t first = 0;
+  double covered = 0.0;
+  for (std::size_t s = 0; s < pieces; s++) {
+    covered += length[s];
+    std::size_t end =
+        s + 1 == pieces || total == 0.0
+            ? interior * (s + 1) / pieces
+            : static_cast<std::size_t>(
+                  std::lround(static_cast<double>(interior) * covered / total));
+    end = std::clamp(end, first + 1, interior - (pieces - s - 1));
+    std::size_t n = end - first;
+    Vec<double, D> step =
+        (corners[s + 1] - corners[s]) * (1.0 / static_cast<double>(n));
+    segments_.push_back({corners[s], step, first, n});
+    labels_.emplace_back(first, route[s]);
+    for (std::size_t i = 0; i < n; i++) {
+      distance_.push_back(
+          (covered - length[s]) +
+          length[s] * static_cast<double>(i) / static_cast<double>(n));
+    }
+    first = end;
+  }
+  // Closing point, evaluated as one more step of the last segment.
+  segments_.back().count++;
+  labels_.emplace_back(first, route.back());
+  distance_.push_back(total);
+}
+
+template <std::size_t D>
+Vec<double, D> KPath<D>::point(std::size_t i) const {
+  ASSERT(i < size());
+  auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), i,
+      [](std::size_t j, Segment const& s) { return j < s.first; });
+  Segment const& s = *(it - 1);
+  return s.start + s.step * static_cast<double>(i - s.first);
+}
+
+// Eigenvalues along a path, energies[k * bands + n] for band n at point k.
+struct Bands {
+  std::size_t points = 0;
+  std::size_t bands = 0;
+  std::vector<double> energies;
+
+  [[nodiscard]] double at(std::size_t k, std::size_t n) const {
+    return energies[k * bands + n];
+  }
+
+  [[nodiscard]] double const* operator[](std::size_t k) const {
+    return energies.data() + k * bands;
+  }
+};
+
+// Diagonalizes H(k) at every point of `path`. The points are split into one
+// contiguous block per thread; each thread walks its part of every segment it
+// overlaps and writes the eigenvalues straight into the result. Workspaces are
+// set up per thread before the loop, so evaluating a point allocates nothing.
+template <std::size_t D>
+Bands band_structure(BlochHamiltonian<D> const& hamiltonian,
+                     KPath<D> const& path, std::size_t resync = 64) {
+  std::size_t n = hamiltonian.orbitals();
+  Bands bands;
+  bands.points = path.size();
+  bands.bands = n;
+  bands.energies.resize(path.size() * n);
+
+  struct Workspace {
+    BlochWorkspace bloch;
+    EigenWorkspace<std::complex<double>> eigen;
+    std::vector<std::complex<double>> h;
+  };
+  std::vector<Workspace> workspaces(max_threads());
+  for (auto& w : workspaces) {
+    w.h.resize(n * n);
+    w.eigen.reserve(n);
+  }
+
+  // A diagonalization is O(n^3), so even a handful of points pays for a
+  // thread.
+  std::size_t grain = std::max<std::size_t>(1, 4096 / (n * n * n + 1));
+  parallel_for(
+      path.size(),
+      [&](std::size_t begin, std::size_t end, std::size_t thread) {
+        Workspace& w = workspaces[thread];
+        for (auto const& segment : path.segments()) {
+          std::size_t lo = std::max(begin, segment.first);
+          std::size_t hi = std::min(end, segment.first + segment.count);
+          if (lo >= hi) continue;
+          Vec<double, D> start =
+              segment.start +
+              segment.step * static_cast<double>(lo - segment.first);
+          hamiltonian.walk(
+              start, segment.step, hi - lo, w.bloch,
+              [&](std::size_t i, std::complex<double> const* h) {
+                std::copy(h, h + n * n, w.h.begin());
+                hermitian_eigenvalues(n, w.h.data(),
+                                      bands.energies.data() + (lo + i) * n,
+                                      w.eigen);
+              },
+              resync);
+        }
+      },
+      grain);
+  return bands;
+}
+
+#endif  // TIGHTB_BANDS_H
@@ -0,0 +1,300 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_BLOCH_H
+#define TIGHTB_BLOCH_H
+
+#include <tightb/assert.h>
+#include <tightb/hopping.h>
+#include <tightb/matrix.h>
+#include <tightb/orbitals.h>
+#include <tightb/vector.h>
+
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Scratch space of BlochHamiltonian. Buffers only grow, so a workspace reused
+// across k-points makes the evaluation allocation free.
+struct BlochWorkspace {
+  std::vector<double> cos;  // Re e^{ik.R} per translation
+  std::vector<double> sin;  // Im e^{ik.R} per translation
+  std::vector<double> re;   // Re H(k), row-major
+  std::vector<double> im;   // Im H(k), row-major
+  std::vector<double> step_cos;
+  std::vector<double> step_sin;
+  std::vector<std::complex<double>> h;
+};
+
+// Evaluates H(k) = sum_R t(R) e^{2 pi i k.R}, with k in reduced coordinates
+// (units of the reciprocal vectors). Each distinct translation costs a single
+// sincos per k-point, evaluated over the whole list of translations at once,
+// and its block is then streamed into the result with fused multiply-adds,
+// instantiated for the orbital count when it is at most kMaxFixedOrbitals.
+// The table is referenced, not copied, and must outlive the builder.
+template <std::size_t D>
+class BlochHamiltonian {
+ public:
+  explicit BlochHamiltonian(HoppingTable<D> const& table) : table_(table) {}
+
+  [[nodiscard]] HoppingTable<D> const& table() const { return table_; }
+
+  [[nodiscard]] std::size_t orbitals() const { return table_.orbitals(); }
+
+  // Fills w.cos and w.sin with e^{2 pi i k.R} for every translation.
+  void phases(Vec<double, D> const& k, BlochWorkspace& w) const;
+
+  // Fills w.re and w.im with sum_R t(R) times the phases held in w.
+  void accumulate(BlochWorkspace& w) const;
+
+  // Writes sum_R i (weights.R) t(R) e^{2 pi i k.R} into dh, with the phases
+  // held in w. With weights_i = a_i[c] this is dH/dk_c in Cartesian units.
+  void derivative(Vec<double, D> const& weights, BlochWorkspace const& w,
+                  std::complex<double>* dh) const;
+
+  // Writes H(k), row-major, into h.
+  void build(Vec<double, D> const& k, std::complex<double>* h,
+             BlochWorkspace& w) const;
+
+  template <std::size_t N>
+  [[nodiscard]] Matrix<std::complex<double>, N, N> build(
+      Vec<double, D> const& k) const;
+
+  // Calls f(i, h) with h = H(start + i step), row-major, for i < count.
+  // Consecutive phases differ by the constant factor e^{2 pi i step.R}, so
+  // each point costs one complex multiplication per translation instead of a
+  // sincos. The phases are recomputed exactly every `resync` points to keep
+  // the rounding drift bounded.
+  template <typename F>
+  void walk(Vec<double, D> const& start, Vec<double, D> const& step,
+            std::size_t count, BlochWorkspace& w, F&& f,
+            std::size_t resync = 64) const;
+
+  // Calls f(i, h) for every point k = (n + shift) / mesh of a uniform mesh,
+  // with i the row-major index of n. Each line along the last direction is a
+  // walk().
+  template <typename F>
+  void mesh(std::array<std::size_t, D> const& mesh, Vec<double, D> const& shift,
+            BlochWorkspace& w, F&& f, std::size_t resync = 64) const;
+
+  // Same, for lines [first_line, last_line) only, so a mesh can be split
+  // between threads. Line l covers the points [l * mesh[D-1], (l + 1) *
+  // mesh[D-1]).
+  template <typename F>
+  void mesh(std::array<std::size_t, D> const& mesh, Vec<double, D> const& shift,
+            std::size_t first_line, std::size_t last_line, BlochWorkspace& w,
+            F&& f, std::size_t resync = 64) const;
+
+ private:
+  void rotate(BlochWorkspace& w) const;
+
+  HoppingTable<D> const& table_;
+};
+
+template <std::size_t D>
+void BlochHamiltonian<D>::phases(Vec<double, D> const& k,
+                                 BlochWorkspace& w) const {
+  std::size_t count = table_.translations();
+  w.cos.resize(count);
+  w.sin.resize(count);
+  double* c = w.cos.data();
+  double* s = w.sin.data();
+  for (std::size_t r = 0; r < count; r++) c[r] = 0.0;
+  for (std::size_t d = 0; d < D; d++) {
+    double kd = 2.0 * M_PI * k[d];
+    double const* R = table_.components(d).data();
+    for (std::size_t r = 0; r < count; r++) c[r] += kd * R[r];
+  }
+  for (std::size_t r = 0; r < count; r++) {
+    double angle = c[r];
+    c[r] = std::cos(angle);
+    s[r] = std::sin(angle);
+  }
+}
+
+namespace detail {
+
+// re + i im = sum_r (tr + i ti)_r (cos + i sin)_r over blocks of n x n
+// entries stored back to back. N = 0 reads n at run time; otherwise n = N
+// and the block loop has a constant trip count.
+template <std::size_t N>
+void accumulate_blocks(std::size_t n, std::size_t translations,
+                       double const* cos, double const* sin, double const* tr,
+                       double const* ti, double* re, double* im) {
+  std::size_t const size = N == 0 ? n * n : N * N;
+  for (std::size_t r = 0; r < translations; r++) {
+    double c = cos[r];
+    double s = sin[r];
+    double const* br = tr + r * size;
+    double const* bi = ti + r * size;
+    for (std::size_t k = 0; k < size; k++) {
+      re[k] += c * br[k] - s * bi[k];
+      im[k] += c * bi[k] + s * br[k];
+    }
+  }
+}
+
+}  // namespace detail
+
+template <std::size_t D>
+void BlochHamiltonian<D>::accumulate(BlochWorkspace& w) const {
+  std::size_t n = orbitals();
+  w.re.assign(n * n, 0.0);
+  w.im.assign(n * n, 0.0);
+  if (table_.translations() == 0) return;
+  dispatch_orbitals(n, [&](auto fixed) {
+    detail::accumulate_blocks<decltype(fixed)::value>(
+        n, table_.translations(), w.cos.data(), w.sin.data(), table_.real(0),
+        table_.imag(0), w.re.data(), w.im.data());
+  });
+}
+
+template <std::size_t D>
+void BlochHamiltonian<D>::derivative(Vec<double, D> const& weights,
+                                     BlochWorkspace const& w,
+                                     std::complex<double>* dh) const {
+  std::size_t size = orbitals() * orbitals();
+  for (std::size_t k = 0; k < size; k++) dh[k] = 0.0;
+  for (std::size_t r = 0; r < table_.translations(); r++) {
+    double x = 0.0;
+    for (std::size_t d = 0; d < D; d++) {
+      x += weights[d] * table_.components(d)[r];
+    }
+    if (x == 0.0) continue;
+    double c = x * w.cos[r];
+    double s = x * w.sin[r];
+    double const* tr = table_.real(r);
+    double const* ti = table_.imag(r);
+    for (std::size_t k = 0; k < size; k++) {
+      // i x (tr + i ti) (c + i s)
+      dh[k] += std::complex<double>(-(c * ti[k] + s * tr[k]),
+                                    c * tr[k] - s * ti[k]);
+    }
+  }
+}
+
+template <std::size_t D>
+void BlochHamiltonian<D>::build(Vec<double, D> const& k,
+                                std::complex<double>* h,
+                                BlochWorkspace& w) const {
+  phases(k, w);
+  accumulate(w);
+  for (std::size_t i = 0; i < w.re.size(); i++) h[i] = {w.re[i], w.im[i]};
+}
+
+template <std::size_t D>
+template <std::size_t N>
+Matrix<std::complex<double>, N, N> BlochHamiltonian<D>::build(
+    Vec<double, D> const& k) const {
+  ASSERT(N == orbitals());
+  BlochWorkspace w;
+  phases(k, w);
+  accumulate(w);
+  Matrix<std::complex<double>, N, N> h{};
+  for (std::size_t a = 0; a < N; a++) {
+    for (std::size_t b = 0; b < N; b++) {
+      h.at(a, b) = {w.re[a * N + b], w.im[a * N + b]};
+    }
+  }
+  return h;
+}
+
+template <std::size_t D>
+void BlochHamiltonian<D>::rotate(BlochWorkspace& w) const {
+  double* c = w.cos.data();
+  double* s = w.sin.data();
+  double const* dc = w.step_cos.data();
+  double const* ds = w.step_sin.data();
+  for (std::size_t r = 0; r < table_.translations(); r++) {
+    double re = c[r] * dc[r] - s[r] * ds[r];
+    double im = c[r] * ds[r] + s[r] * dc[r];
+    c[r] = re;
+    s[r] = im;
+  }
+}
+
+template <std::size_t D>
+template <typename F>
+void BlochHamiltonian<D>::walk(Vec<double, D> const& start,
+                               Vec<double, D> const& step, std::size_t count,
+                               BlochWorkspace& w, F&& f,
+                               std::size_t resync) const {
+  ASSERT(resync > 0);
+  if (count == 0) return;
+  // The per-step factors are phases() of `step` itself.
+  phases(step, w);
+  w.step_cos.swap(w.cos);
+  w.step_sin.swap(w.sin);
+  w.h.resize(orbitals() * orbitals());
+
+  for (std::size_t i = 0; i < count; i++) {
+    if (i % resync == 0) {
+      phases(start + step * static_cast<double>(i), w);
+    } else {
+      rotate(w);
+    }
+    accumulate(w);
+    for (std::size_t j = 0; j < w.h.size(); j++) w.h[j] = {w.re[j], w.im[j]};
+    f(i, static_cast<std::complex<double> const*>(w.h.data()));
+  }
+}
+
+template <std::size_t D>
+template <typename F>
+void BlochHamiltonian<D>::mesh(std::array<std::size_t, D> const& mesh,
+                               Vec<double, D> const& shift, BlochWorkspace& w,
+                               F&& f, std::size_t resync) const {
+  std::size_t lines = 1;
+  for (std::size_t d = 0; d + 1 < D; d++) lines *= mesh[d];
+  this->mesh(mesh, shift, 0, lines, w, std::forward<F>(f), resync);
+}
+
+template <std::size_t D>
+template <typename F>
+void BlochHamiltonian<D>::mesh(std::array<std::size_t, D> const& mesh,
+                               Vec<double, D> const& shift,
+                               std::size_t first_line, std::size_t last_line,
+                               BlochWorkspace& w, F&& f,
+                               std::size_t resync) const {
+  std::size_t length = mesh[D - 1];
+
+  Vec<double, D> step{};
+  for (std::size_t d = 0; d < D; d++) step[d] = 0.0;
+  step[D - 1] = 1.0 / static_cast<double>(length);
+
+  for (std::size_t line = first_line; line < last_line; line++) {
+    Vec<double, D> start{};
+    std::size_t rest = line;
+    for (std::size_t d = D - 1; d > 0; d--) {
+      std::size_t n = rest % mesh[d - 1];
+      rest /= mesh[d - 1];
+      start[d - 1] = (static_cast<double>(n) + shift[d - 1]) /
+                     static_cast<double>(mesh[d - 1]);
+    }
+    start[D - 1] = shift[D - 1] / static_cast<double>(length);
+    walk(
+        start, step, length, w,
+        [&](std::size_t i, std::complex<double> const* h) {
+          f(line * length + i, h);
+        },
+        resync);
+  }
+}
+
+#endif  // TIGHTB_BLOCH_H
@@ -0,0 +1,171 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_BLOCK_SPARSE_H
+#define TIGHTB_BLOCK_SPARSE_H
+
+#include <tightb/assert.h>
+#include <tightb/graph.h>
+#include <tightb/orbitals.h>
+#include <tightb/parallel.h>
+#include <tightb/sparse.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace detail {
+
+// y_i = sum_j A_ij x_j over rows [begin, end) of a block CSR matrix with b x b
+// blocks; N = 0 reads b at run time.
+template <std::size_t N, typename T>
+void block_multiply(std::size_t b, std::size_t begin, std::size_t end,
+                    std::size_t const* offsets, std::size_t const* columns,
+                    T const* values, T const* x, T* y) {
+  std::size_t const n = N == 0 ? b : N;
+  for (std::size_t i = begin; i < end; i++) {
+    T* yi = y + i * n;
+    for (std::size_t r = 0; r < n; r++) yi[r] = T{};
+    for (std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+      T const* block = values + k * n * n;
+      T const* xj = x + columns[k] * n;
+      for (std::size_t r = 0; r < n; r++) {
+        T sum{};
+        for (std::size_t c = 0; c < n; c++) sum += block[r * n + c] * xj[c];
+        yi[r] += sum;
+      }
+    }
+  }
+}
+
+template <std::size_t N, typename T>
+void block_add(std::size_t b, T const* from, T* to) {
+  std::size_t const size = N == 0 ? b * b : N * N;
+  for (std::size_t k = 0; k < size; k++) to[k] += from[k];
+}
+
+}  // namespace detail
+
+// Sparse matrix of b x b blocks, one per bond of the graph plus the diagonal,
+// for real-space models with b orbitals per site. Storing blocks keeps one
+// column index per site pair instead of per orbital pair, and the kernels
+// are instantiated for b up to kMaxFixedOrbitals so the block loops unroll.
+// Vectors are site-major: element i * b + a is orbital a of site i.
+template <typename T>
+class BlockSparseMatrix {
+ public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  BlockSparseMatrix(Graph const& graph, std::size_t block);
+
+  // Number of sites.
+  [[nodiscard]] std::size_t size() const { return offsets_.size() - 1; }
+
+  [[nodiscard]] std::size_t block_size() const { return block_; }
+
+  // Number of rows, sites times orbitals.
+  [[nodiscard]] std::size_t dimension() const { return size() * block_; }
+
+  [[nodiscard]] std::size_t blocks() const { return columns_.size(); }
+
+  // Index of block (i, j), or npos if it is not in the pattern.
+  [[nodiscard]] std::size_t find(std::size_t i, std::size_t j) const;
+
+  // Block (i, j), row-major.
+  [[nodiscard]] T const* block(std::size_t i, std::size_t j) const;
+
+  T* block(std::size_t i, std::size_t j);
+
+  // Adds a row-major b x b block to (i, j).
+  void add_block(std::size_t i, std::size_t j, T const* values);
+
+  void multiply(T const* x, T* y) const;
+
+  [[nodiscard]] std::vector<std::size_t> const& offsets() const {
+    return offsets_;
+  }
+
+  [[nodiscard]] std::vector<std::size_t> const& columns() const {
+    return columns_;
+  }
+
+  [[nodiscard]] std::vector<T> const& values() const { return values_; }
+
+  std::vector<T>& values() { return values_; }
+
+ private:
+  std::size_t block_;
+  std::vector<std::size_t> offsets_;
+  std::vector<std::size_t> columns_;
+  std::vector<T> values_;
+};
+
+template <typename T>
+BlockSparseMatrix<T>::BlockSparseMatrix(Graph const& graph, std::size_t block)
+    : block_(block) {
+  ASSERT(block > 0);
+  SparseMatrix<std::uint8_t> pattern(graph);
+  offsets_ = pattern.offsets();
+  columns_ = pattern.columns();
+  values_.assign(columns_.size() * block * block, T{});
+}
+
+template <typename T>
+std::size_t BlockSparseMatrix<T>::find(std::size_t i, std::size_t j) const {
+  auto begin = columns_.begin() + offsets_[i];
+  auto end = columns_.begin() + offsets_[i + 1];
+  auto it = std::lower_bound(begin, end, j);
+  if (it == end || *it != j) return npos;
+  return it - columns_.begin();
+}
+
+template <typename T>
+T const* BlockSparseMatrix<T>::block(std::size_t i, std::size_t j) const {
+  std::size_t k = find(i, j);
+  ASSERT(k != npos);
+  return values_.data() + k * block_ * block_;
+}
+
+template <typename T>
+T* BlockSparseMatrix<T>::block(std::size_t i, std::size_t j) {
+  std::size_t k = find(i, j);
+  ASSERT(k != npos);
+  return values_.data() + k * block_ * block_;
+}
+
+template <typename T>
+void BlockSparseMatrix<T>::add_block(std::size_t i, std::size_t j,
+                                     T const* values) {
+  T* to = block(i, j);
+  dispatch_orbitals(block_, [&](auto fixed) {
+    detail::block_add<decltype(fixed)::value>(block_, values, to);
+  });
+}
+
+template <typename T>
+void BlockSparseMatrix<T>::multiply(T const* x, T* y) const {
+  dispatch_orbitals(block_, [&](auto fixed) {
+    parallel_for(size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+      detail::block_multiply<decltype(fixed)::value>(
+          block_, begin, end, offsets_.data(), columns_.data(),
+          values_.data(), x, y);
+    });
+  });
+}
+
+#endif  // TIGHTB_BLOCK_SPARSE_H
@@ -0,0 +1,50 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_COLORING_H
+#define TIGHTB_COLORING_H
+
+#include <tightb/graph.h>
+
+#include <cstddef>
+#include <vector>
+
+struct Coloring {
+  // Color of every vertex.
+  std::vector<std::size_t> color;
+
+  // Vertices grouped by color: vertices[offsets[c] .. offsets[c + 1]) have
+  // color c, in increasing order.
+  std::vector<std::size_t> offsets{0};
+  std::vector<std::size_t> vertices;
+
+  // Vertices of the same color are more than `distance` bonds apart.
+  std::size_t distance = 1;
+
+  [[nodiscard]] std::size_t colors() const { return offsets.size() - 1; }
+};
+
+// Colors the graph with the Jones-Plassmann algorithm. Every round, each
+// uncolored vertex whose random priority beats all uncolored vertices within
+// `distance` bonds takes the smallest color free in that neighborhood; those
+// vertices are independent, so a round runs in parallel without locks.
+//
+// A distance-1 coloring gives independent sets (e.g. for Gauss-Seidel sweeps).
+// A distance-2 coloring additionally guarantees that two vertices of the same
+// color share no neighbor, which is what symmetric scatter kernels need.
+Coloring color_graph(Graph const& graph, std::size_t distance = 1);
+
+#endif  // TIGHTB_COLORING_H
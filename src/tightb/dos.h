@@ -0,0 +1,286 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_DOS_H
+#define TIGHTB_DOS_H
+
+#include <tightb/assert.h>
+#include <tightb/lattice.h>
+#include <tightb/parallel.h>
+#include <tightb/vector.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+// Density of states on a uniform energy grid: bin b covers [min + b step,
+// min + (b + 1) step). Values are states per unit energy per cell, summed
+// over bands (no spin factor); projected[b * projectors + p] resolves them by
+// projector.
+struct Dos {
+  double min = 0.0;
+  double step = 0.0;
+  std::size_t projectors = 0;
+  std::vector<double> total;
+  std::vector<double> projected;
+
+  [[nodiscard]] std::size_t bins() const { return total.size(); }
+
+  [[nodiscard]] double energy(std::size_t b) const {
+    return min + (static_cast<double>(b) + 0.5) * step;
+  }
+};
+
+namespace detail {
+
+// Integration weights of the corners of a D-simplex whose energy is linear
+// between the corner values e (sorted ascending): w[i] is the integral of the
+// barycentric coordinate of corner i over the part of the simplex below E, as
+// a fraction of its volume, so sum(w) is the fraction of the simplex below E.
+// In 3D these are the weights of Bloechl, Jepsen and Andersen (PRB 49, 16223)
+// and `corrected` adds their curvature correction D(E) / 40 sum_j (e_j - e_i),
+// which sums to zero over the corners but fixes projected weights to the
+// order of the quadratic band curvature.
+template <std::size_t D>
+void simplex_weights(std::array<double, D + 1> const& e, double E,
+                     bool corrected, std::array<double, D + 1>& w) {
+  constexpr double share = 1.0 / (D + 1);
+  if (E <= e[0]) {
+    w.fill(0.0);
+    return;
+  }
+  if (E >= e[D]) {
+    w.fill(share);
+    return;
+  }
+  if constexpr (D == 1) {
+    double a = (E - e[0]) / (e[1] - e[0]);
+    w = {a * (2.0 - a) / 2.0, a * a / 2.0};
+  } else if constexpr (D == 2) {
+    if (E < e[1]) {
+      double a1 = (E - e[0]) / (e[1] - e[0]);
+      double a2 = (E - e[0]) / (e[2] - e[0]);
+      double area = a1 * a2;
+      w = {area * (3.0 - a1 - a2) / 3.0, area * a1 / 3.0, area * a2 / 3.0};
+    } else {
+      double b0 = (e[2] - E) / (e[2] - e[0]);
+      double b1 = (e[2] - E) / (e[2] - e[1]);
+      double area = b0 * b1;
+      w = {share - area * b0 / 3.0, share - area * b1 / 3.0,
+           share - area * (3.0 - b0 - b1) / 3.0};
+    }
+  } else {
+    static_assert(D == 3, "simplices of one to three dimensions");
+    double e10 = e[1] - e[0];
+    double e20 = e[2] - e[0];
+    double e30 = e[3] - e[0];
+    double e21 = e[2] - e[1];
+    double e31 = e[3] - e[1];
+    double e32 = e[3] - e[2];
+    double dos = 0.0;
+    if (E < e[1]) {
+      double x = E - e[0];
+      double c = x * x * x / (4.0 * e10 * e20 * e30);
+      w = {c * (4.0 - x * (1.0 / e10 + 1.0 / e20 + 1.0 / e30)), c * x / e10,
+           c * x / e20, c * x / e30};
+      dos = 3.0 * x * x / (e10 * e20 * e30);
+    } else if (E < e[2]) {
+      double x0 = E - e[0];
+      double x1 = E - e[1];
+      double y2 = e[2] - E;
+      double y3 = e[3] - E;
+      double c1 = x0 * x0 / (4.0 * e30 * e20);
+      double c2 = x0 * x1 * y2 / (4.0 * e30 * e21 * e20);
+      double c3 = x1 * x1 * y3 / (4.0 * e31 * e21 * e30);
+      w = {c1 + (c1 + c2) * y2 / e20 + (c1 + c2 + c3) * y3 / e30,
+           c1 + c2 + c3 + (c2 + c3) * y2 / e21 + c3 * y3 / e31,
+           (c1 + c2) * x0 / e20 + (c2 + c3) * x1 / e21,
+           (c1 + c2 + c3) * x0 / e30 + c3 * x1 / e31};
+      dos = (3.0 * e10 + 6.0 * x1 - 3.0 * (e20 + e31) * x1 * x1 / (e21 * e31)) /
+            (e20 * e30);
+    } else {
+      double y = e[3] - E;
+      double c = y * y * y / (4.0 * e30 * e31 * e32);
+      w = {share - c * y / e30, share - c * y / e31, share - c * y / e32,
+           share - c * (4.0 - y * (1.0 / e30 + 1.0 / e31 + 1.0 / e32))};
+      dos = 3.0 * y * y / (e30 * e31 * e32);
+    }
+    if (corrected) {
+      double sum = e[0] + e[1] + e[2] + e[3];
+      for (std::size_t i = 0; i < 4; i++) {
+        w[i] += dos / 40.0 * (sum - 4.0 * e[i]);
+      }
+    }
+  }
+}
+
+}  // namespace detail
+
+// Linear tetrahedron (triangle, segment) DOS from band energies on the mesh
+// k = (n + shift) / mesh, energies[i * bands + b] in the row-major order of
+// BlochHamiltonian::mesh() (as from BandInterpolator::evaluate_mesh()). Each
+// mesh cell is cut into D! simplices around its main diagonal that is
+// shortest in Cartesian k, over which the bands are interpolated linearly and
+// integrated exactly into the bins, so no smearing is needed and the result
+// converges with far coarser meshes. If `projections` is given, with
+// projections[(i * bands + b) * projectors + p] the weight of projector p in
+// state (i, b) (e.g. |<p|b k_i>|^2), the projected DOS is integrated with the
+// corner weights, Bloechl-corrected in 3D. Cells are shared out between
+// threads, each filling its own histogram; the histograms are summed at the
+// end.
+template <std::size_t D>
+Dos tetrahedron_dos(Lattice<D> const& lattice,
+                    std::array<std::size_t, D> const& mesh, std::size_t bands,
+                    double const* energies, double min, double max,
+                    std::size_t bins, double const* projections = nullptr,
+                    std::size_t projectors = 0, bool corrected = true) {
+  static_assert(D >= 1 && D <= 3);
+  ASSERT(max > min && bins > 0);
+  if (projections == nullptr) projectors = 0;
+  std::size_t cells = 1;
+  for (std::size_t d = 0; d < D; d++) cells *= mesh[d];
+
+  // Flipping the axes in `flip` maps the main diagonal 0 -> (1, ..., 1) of a
+  // cell to each of the others in turn; keep the shortest.
+  unsigned flip = 0;
+  double shortest = -1.0;
+  for (unsigned f = 0; f < (1u << D); f += 2) {
+    Vec<double, D> k{};
+    for (std::size_t d = 0; d < D; d++) {
+      k[d] = ((f >> d) & 1u ? -1.0 : 1.0) / static_cast<double>(mesh[d]);
+    }
+    Vec<double, D> c = lattice.k_to_cartesian(k);
+    if (shortest < 0.0 || c.dot(c) < shortest - 1e-12) {
+      shortest = c.dot(c);
+      flip = f;
+    }
+  }
+
+  // Corners of the D! simplices as offsets in {0, 1}^D, one bit per axis.
+  std::vector<std::array<unsigned, D + 1>> simplices;
+  std::array<std::size_t, D> order;
+  std::iota(order.begin(), order.end(), 0);
+  do {
+    std::array<unsigned, D + 1> corners;
+    corners[0] = 0;
+    for (std::size_t i = 0; i < D; i++) {
+      corners[i + 1] = corners[i] | (1u << order[i]);
+    }
+    for (auto& c : corners) c ^= flip;
+    simplices.push_back(corners);
+  } while (std::next_permutation(order.begin(), order.end()));
+  double volume = 1.0 / static_cast<double>(simplices.size() * cells);
+  double step = (max - min) / static_cast<double>(bins);
+
+  std::size_t stride = 1 + projectors;
+  std::vector<std::vector<double>> histograms(max_threads());
+  parallel_for(
+      cells,
+      [&](std::size_t begin, std::size_t end, std::size_t thread) {
+        std::vector<double>& histogram = histograms[thread];
+        histogram.assign(bins * stride, 0.0);
+        std::vector<double> previous(stride);
+        std::vector<double> current(stride);
+        for (std::size_t cell = begin; cell < end; cell++) {
+          std::array<std::size_t, D> n;
+          std::size_t rest = cell;
+          for (std::size_t d = D; d-- > 0;) {
+            n[d] = rest % mesh[d];
+            rest /= mesh[d];
+          }
+          std::array<std::size_t, (1u << D)> index;
+          for (unsigned o = 0; o < (1u << D); o++) {
+            std::size_t i = 0;
+            for (std::size_t d = 0; d < D; d++) {
+              i = i * mesh[d] + (n[d] + ((o >> d) & 1u)) % mesh[d];
+            }
+            index[o] = i;
+          }
+
+          for (auto const& corners : simplices) {
+            for (std::size_t b = 0; b < bands; b++) {
+              std::array<std::size_t, D + 1> k;
+              for (std::size_t c = 0; c <= D; c++) k[c] = index[corners[c]];
+              std::sort(k.begin(), k.end(), [&](std::size_t x, std::size_t y) {
+                return energies[x * bands + b] < energies[y * bands + b];
+              });
+              std::array<double, D + 1> e;
+              for (std::size_t c = 0; c <= D; c++) {
+                e[c] = energies[k[c] * bands + b];
+              }
+              if (e[D] < min || e[0] >= max) continue;
+
+              // Only the bin edges inside [e0, eD] see partial weights. The
+              // upper edge is taken past the bin holding eD, so that a flat
+              // simplex sitting on a bin edge still lands in that bin.
+              auto edge = [&](double x) { return (x - min) / step; };
+              std::size_t first = static_cast<std::size_t>(
+                  std::max(0.0, std::floor(edge(e[0]))));
+              std::size_t last = static_cast<std::size_t>(
+                  std::min<double>(bins, std::floor(edge(e[D])) + 1.0));
+              std::array<double, D + 1> w;
+              auto integrate = [&](std::size_t x, std::vector<double>& out) {
+                detail::simplex_weights<D>(
+                    e, min + static_cast<double>(x) * step, corrected, w);
+                out[0] = 0.0;
+                for (double v : w) out[0] += v;
+                for (std::size_t p = 0; p < projectors; p++) {
+                  double sum = 0.0;
+                  for (std::size_t c = 0; c <= D; c++) {
+                    sum +=
+                        w[c] * projections[(k[c] * bands + b) * projectors + p];
+                  }
+                  out[1 + p] = sum;
+                }
+              };
+              integrate(first, previous);
+              for (std::size_t x = first + 1; x <= last; x++) {
+                integrate(x, current);
+                for (std::size_t s = 0; s < stride; s++) {
+                  histogram[(x - 1) * stride + s] += current[s] - previous[s];
+                }
+                std::swap(previous, current);
+              }
+            }
+          }
+        }
+      },
+      64);
+
+  Dos dos;
+  dos.min = min;
+  dos.step = step;
+  dos.projectors = projectors;
+  dos.total.assign(bins, 0.0);
+  dos.projected.assign(bins * projectors, 0.0);
+  double scale = volume / step;
+  for (auto const& histogram : histograms) {
+    if (histogram.empty()) continue;
+    for (std::size_t x = 0; x < bins; x++) {
+      dos.total[x] += scale * histogram[x * stride];
+      for (std::size_t p = 0; p < projectors; p++) {
+        dos.projected[x * projectors + p] +=
+            scale * histogram[x * stride + 1 + p];
+      }
+    }
+  }
+  return dos;
+}
+
+#endif  // TIGHTB_DOS_H
@@ -0,0 +1,452 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_EIGEN_H
+#define TIGHTB_EIGEN_H
+
+#include <tightb/assert.h>
+#include <tightb/scalar.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Scratch space of the dense eigensolvers. Buffers only grow, so reusing a
+// workspace across calls makes them allocation free.
+template <typename T>
+struct EigenWorkspace {
+  std::vector<double> subdiagonal;
+  std::vector<T> offdiagonal;  // subdiagonal before it is made real
+  std::vector<T> z;            // eigenvectors being accumulated
+  std::vector<T> v;            // current Householder vector
+  std::vector<T> p;
+  std::vector<double> real;    // real copy of a complex matrix with no
+                               // imaginary part, for the real solver
+
+  // Sizes every buffer for n x n problems up front.
+  void reserve(std::size_t n) {
+    subdiagonal.reserve(n);
+    offdiagonal.reserve(n);
+    z.reserve(n * n);
+    v.reserve(n);
+    p.reserve(n);
+    real.reserve(2 * n * n + 3 * n);
+  }
+};
+
+// Scratch space of band_eigenvalues(), reused the same way.
+template <typename T>
+struct BandWorkspace {
+  std::vector<T> lower;  // lower band being reduced to tridiagonal form
+  std::vector<double> subdiagonal;
+};
+
+namespace detail {
+
+inline double magnitude(double x) { return std::abs(x); }
+
+inline double magnitude(std::complex<double> x) { return std::abs(x); }
+
+inline double squared(double x) { return x * x; }
+
+inline double squared(std::complex<double> x) { return std::norm(x); }
+
+inline double real_part(double x) { return x; }
+
+inline double real_part(std::complex<double> x) { return x.real(); }
+
+// Reduces the Hermitian matrix `a` (row-major, n x n) to a real symmetric
+// tridiagonal matrix with diagonal d and subdiagonal e by Householder
+// reflections, A = Q T Q^H. If `q` is not null it receives Q times the
+// diagonal phases that make the subdiagonal real, with the columns of that
+// product stored as rows. `a` is destroyed.
+// v, p and sub are scratch arrays of n elements.
+template <typename T>
+void tridiagonalize(std::size_t n, T* a, double* d, double* e, T* q, T* v,
+                    T* p, T* sub) {
+  if (q != nullptr) {
+    for (std::size_t i = 0; i < n * n; i++) q[i] = T{};
+    for (std::size_t i = 0; i < n; i++) q[i * n + i] = T{1};
+  }
+
+  // The subdiagonal produced by the reflections; made real below.
+  for (std::size_t i = 0; i < n; i++) sub[i] = T{};
+
+  for (std::size_t k = 0; k + 2 < n; k++) {
+    std::size_t m = k + 1;
+    double tail = 0.0;
+    for (std::size_t i = m + 1; i < n; i++) tail += squared(a[i * n + k]);
+    T x0 = a[m * n + k];
+    if (tail == 0.0) {
+      sub[k] = x0;
+      continue;
+    }
+    double norm = std::sqrt(tail + squared(x0));
+    double x0_abs = magnitude(x0);
+    T phase = x0_abs == 0.0 ? T{1} : x0 / x0_abs;
+    T alpha = -phase * norm;
+
+    // v = (x - alpha e_1) / |x - alpha e_1|
+    v[m] = x0 - alpha;
+    for (std::size_t i = m + 1; i < n; i++) v[i] = a[i * n + k];
+    double vnorm = std::sqrt(squared(v[m]) + tail);
+    for (std::size_t i = m; i < n; i++) v[i] /= vnorm;
+
+    // p = A v on the trailing block, then w = p - (v^H p) v.
+    for (std::size_t i = m; i < n; i++) {
+      T sum{};
+      for (std::size_t j = m; j < n; j++) sum += a[i * n + j] * v[j];
+      p[i] = sum;
+    }
+    T vp{};
+    for (std::size_t i = m; i < n; i++) vp += conjugate(v[i]) * p[i];
+    for (std::size_t i = m; i < n; i++) p[i] -= vp * v[i];
+
+    // A <- A - 2 (v w^H + w v^H)
+    for (std::size_t i = m; i < n; i++) {
+      for (std::size_t j = m; j < n; j++) {
+        a[i * n + j] -=
+            2.0 * (v[i] * conjugate(p[j]) + p[i] * conjugate(v[j]));
+      }
+    }
+    sub[k] = alpha;
+
+    // Q <- Q H, with the columns of Q kept as rows.
+    if (q != nullptr) {
+      for (std::size_t c = 0; c < n; c++) {
+        T qv{};
+        for (std::size_t i = m; i < n; i++) qv += q[i * n + c] * v[i];
+        for (std::size_t i = m; i < n; i++) {
+          q[i * n + c] -= 2.0 * qv * conjugate(v[i]);
+        }
+      }
+    }
+  }
+  if (n >= 2) sub[n - 2] = a[(n - 1) * n + (n - 2)];
+
+  // Diagonal phases phi with phi_{k+1} = phi_k sub_k / |sub_k| turn the
+  // subdiagonal into |sub_k|.
+  T phi{1};
+  for (std::size_t k = 0; k < n; k++) {
+    d[k] = real_part(a[k * n + k]);
+    if (q != nullptr && k > 0) {
+      for (std::size_t c = 0; c < n; c++) q[k * n + c] *= phi;
+    }
+    if (k + 1 < n) {
+      double s = magnitude(sub[k]);
+      e[k] = s;
+      if (s != 0.0) phi *= sub[k] / s;
+    }
+  }
+  if (n > 0) e[n - 1] = 0.0;
+}
+
+// Implicit QL iterations with Wilkinson shifts on the symmetric tridiagonal
+// matrix (d, e). The rotations are applied to the rows of z, if given.
+template <typename T>
+void tridiagonal_ql(std::size_t n, double* d, double* e, T* z) {
+  for (std::size_t l = 0; l < n; l++) {
+    int iterations = 0;
+    std::size_t m;
+    do {
+      for (m = l; m + 1 < n; m++) {
+        double dd = std::abs(d[m]) + std::abs(d[m + 1]);
+        if (std::abs(e[m]) <= std::numeric_limits<double>::epsilon() * dd) {
+          break;
+        }
+      }
+      if (m == l) break;
+      ASSERT(iterations++ < 64, "QL iteration did not converge");
+
+      double g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+      double r = std::hypot(g, 1.0);
+      g = d[m] - d[l] + e[l] / (g + std::copysign(r, g));
+      double s = 1.0;
+      double c = 1.0;
+      double p = 0.0;
+      bool deflated = false;
+      for (std::size_t i = m; i-- > l;) {
+        double f = s * e[i];
+        double b = c * e[i];
+        r = std::hypot(f, g);
+        e[i + 1] = r;
+        if (r == 0.0) {
+          d[i + 1] -= p;
+          e[m] = 0.0;
+          deflated = true;
+          break;
+        }
+        s = f / r;
+        c = g / r;
+        g = d[i + 1] - p;
+        r = (d[i] - g) * s + 2.0 * c * b;
+        p = s * r;
+        d[i + 1] = g + p;
+        g = c * r - b;
+        if (z != nullptr) {
+          T* zi = z + i * n;
+          T* zj = z + (i + 1) * n;
+          for (std::size_t k = 0; k < n; k++) {
+            T t = zj[k];
+            zj[k] = s * zi[k] + c * t;
+            zi[k] = c * zi[k] - s * t;
+          }
+        }
+      }
+      if (deflated) continue;
+      d[l] -= p;
+      e[l] = g;
+      e[m] = 0.0;
+    } while (m != l);
+  }
+}
+
+// Sorts eigenvalues ascending, permuting the rows of z along.
+template <typename T>
+void sort_eigenpairs(std::size_t n, double* w, T* z) {
+  for (std::size_t i = 0; i + 1 < n; i++) {
+    std::size_t min = i;
+    for (std::size_t j = i + 1; j < n; j++) {
+      if (w[j] < w[min]) min = j;
+    }
+    if (min == i) continue;
+    std::swap(w[i], w[min]);
+    if (z != nullptr) {
+      for (std::size_t k = 0; k < n; k++) {
+        std::swap(z[i * n + k], z[min * n + k]);
+      }
+    }
+  }
+}
+
+// Whether the complex matrix `a` is real to rounding, so that the real
+// symmetric solver gives the same result for a quarter of the flops. Phases
+// e^{ik.R} at time-reversal invariant momenta leave imaginary parts of the
+// order of machine epsilon relative to the real ones, which are dropped. The
+// tolerance is purely relative, so models in small units keep genuine
+// imaginary parts; with no real part at all, any imaginary part counts.
+inline bool effectively_real(std::size_t n, std::complex<double> const* a) {
+  double largest = 0.0;
+  double imaginary = 0.0;
+  for (std::size_t i = 0; i < n * n; i++) {
+    largest = std::max(largest, std::abs(a[i].real()));
+    imaginary = std::max(imaginary, std::abs(a[i].imag()));
+  }
+  if (largest == 0.0) return imaginary == 0.0;
+  return imaginary <= 64.0 * std::numeric_limits<double>::epsilon() * largest;
+}
+
+// Runs the solver on the real part of `a`, using ws.real for storage.
+// Eigenvectors, if requested, are written back to `a`.
+template <typename T>
+void solve_real(std::size_t n, T* a, double* w, EigenWorkspace<T>& ws,
+                bool vectors) {
+  ws.subdiagonal.resize(n);
+  ws.real.resize(n * n + 3 * n + (vectors ? n * n : 0));
+  double* r = ws.real.data();
+  double* v = r + n * n;
+  double* p = v + n;
+  double* sub = p + n;
+  double* z = vectors ? sub + n : nullptr;
+  for (std::size_t i = 0; i < n * n; i++) r[i] = real_part(a[i]);
+  tridiagonalize<double>(n, r, w, ws.subdiagonal.data(), z, v, p, sub);
+  tridiagonal_ql<double>(n, w, ws.subdiagonal.data(), z);
+  sort_eigenpairs<double>(n, w, z);
+  if (vectors) {
+    for (std::size_t i = 0; i < n * n; i++) a[i] = z[i];
+  }
+}
+
+}  // namespace detail
+
+// Eigenvalues, in ascending order, of the Hermitian (or real symmetric)
+// matrix `a`, row-major n x n. `a` is destroyed. A complex matrix without
+// imaginary part goes through the real solver.
+template <typename T>
+void hermitian_eigenvalues(std::size_t n, T* a, double* w,
+                           EigenWorkspace<T>& ws) {
+  if constexpr (is_complex_v<T>) {
+    if (detail::effectively_real(n, a)) {
+      detail::solve_real(n, a, w, ws, false);
+      return;
+    }
+  }
+  ws.subdiagonal.resize(n);
+  ws.v.resize(n);
+  ws.p.resize(n);
+  ws.offdiagonal.resize(n);
+  detail::tridiagonalize<T>(n, a, w, ws.subdiagonal.data(), nullptr,
+                            ws.v.data(), ws.p.data(), ws.offdiagonal.data());
+  detail::tridiagonal_ql<T>(n, w, ws.subdiagonal.data(), nullptr);
+  detail::sort_eigenpairs<T>(n, w, nullptr);
+}
+
+// Eigenvalues in ascending order and the matching eigenvectors, which replace
+// `a` with eigenvector i stored as row i: a[i * n + k] = <k|i>.
+template <typename T>
+void hermitian_eigensystem(std::size_t n, T* a, double* w,
+                           EigenWorkspace<T>& ws) {
+  if constexpr (is_complex_v<T>) {
+    if (detail::effectively_real(n, a)) {
+      detail::solve_real(n, a, w, ws, true);
+      return;
+    }
+  }
+  ws.subdiagonal.resize(n);
+  ws.v.resize(n);
+  ws.p.resize(n);
+  ws.offdiagonal.resize(n);
+  ws.z.resize(n * n);
+  T* z = ws.z.data();
+  detail::tridiagonalize<T>(n, a, w, ws.subdiagonal.data(), z, ws.v.data(),
+                            ws.p.data(), ws.offdiagonal.data());
+  detail::tridiagonal_ql<T>(n, w, ws.subdiagonal.data(), z);
+  detail::sort_eigenpairs<T>(n, w, z);
+  for (std::size_t i = 0; i < n * n; i++) a[i] = z[i];
+}
+
+namespace detail {
+
+// Hermitian band matrix with the lower triangle stored by columns, one spare
+// diagonal beyond the bandwidth holding the bulge of a band reduction.
+template <typename T>
+class LowerBand {
+ public:
+  LowerBand(std::size_t n, std::size_t b, std::vector<T>& storage)
+      : n_(n), width_(b + 2), data_(storage) {
+    data_.assign(n * width_, T{});
+  }
+
+  // (r, c) with c <= r <= c + b + 1.
+  T& at(std::size_t r, std::size_t c) { return data_[c * width_ + (r - c)]; }
+
+  // Applies G = [c s; -conj(s) c] to rows and columns p and p + 1, A <- G A
+  // G^H, touching only entries within `reach` of the diagonal.
+  void rotate(std::size_t p, double c, T s, std::size_t reach) {
+    std::size_t q = p + 1;
+    std::size_t first = q > reach ? q - reach : 0;
+    for (std::size_t x = first; x < p; x++) {
+      T a = at(p, x);
+      T b = at(q, x);
+      at(p, x) = c * a + s * b;
+      at(q, x) = -conjugate(s) * a + c * b;
+    }
+    std::size_t last = std::min(n_ - 1, p + reach);
+    for (std::size_t y = q + 1; y <= last; y++) {
+      T a = at(y, p);
+      T b = at(y, q);
+      at(y, p) = c * a + conjugate(s) * b;
+      at(y, q) = -s * a + c * b;
+    }
+    double a = real_part(at(p, p));
+    double d = real_part(at(q, q));
+    T e = at(q, p);
+    double cross = 2.0 * c * real_part(s * e);
+    double s2 = squared(s);
+    at(p, p) = c * c * a + cross + s2 * d;
+    at(q, q) = s2 * a - cross + c * c * d;
+    at(q, p) = c * c * e - conjugate(s) * conjugate(s) * conjugate(e) +
+               c * conjugate(s) * (d - a);
+  }
+
+ private:
+  std::size_t n_;
+  std::size_t width_;
+  std::vector<T>& data_;
+};
+
+// Rotation [c s; -conj(s) c] that zeroes g in the second row of (f, g).
+template <typename T>
+void givens(T f, T g, double& c, T& s) {
+  double fa = magnitude(f);
+  double r = std::hypot(fa, magnitude(g));
+  if (r == 0.0) {
+    c = 1.0;
+    s = T{};
+  } else if (fa == 0.0) {
+    c = 0.0;
+    s = T{1};
+  } else {
+    c = fa / r;
+    s = (f / fa) * conjugate(g) / r;
+  }
+}
+
+}  // namespace detail
+
+// Eigenvalues, in ascending order, of the n x n Hermitian band matrix with b
+// superdiagonals whose row i holds A_{i,i}, ..., A_{i,i+b} at band[i * (b + 1)]
+// onwards (entries past the last column are ignored). The band is reduced to
+// tridiagonal form by Givens rotations, peeling one diagonal at a time and
+// chasing the bulge each rotation creates down the band (Schwarz's
+// algorithm), then handed to the tridiagonal QL solver. That is O(n^2 b)
+// operations in O(n b) memory, against O(n^3) and O(n^2) for the dense
+// solver. `ws` holds both the band and the subdiagonal, so reusing it across
+// calls allocates nothing.
+template <typename T>
+void band_eigenvalues(std::size_t n, std::size_t b, T const* band, double* w,
+                      BandWorkspace<T>& ws) {
+  if (n == 0) return;
+  // Rows are laid out with the caller's stride; only the reduction uses the
+  // bandwidth clamped to the matrix.
+  std::size_t width = b + 1;
+  b = std::min(b, n - 1);
+  detail::LowerBand<T> a(n, b, ws.lower);
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t j = 0; j <= b && i + j < n; j++) {
+      a.at(i + j, i) = conjugate(band[i * width + j]);
+    }
+  }
+
+  for (std::size_t k = b; k >= 2; k--) {
+    // Zero the k-th subdiagonal, column by column. Rotating rows r - 1 and r
+    // fills (r + k, r - 1), one past the band, which the next rotation
+    // pushes k rows further down until it falls off the end.
+    for (std::size_t j = 0; j + k < n; j++) {
+      std::size_t row = j + k;
+      std::size_t col = j;
+      while (true) {
+        T g = a.at(row, col);
+        if (g != T{}) {
+          double c;
+          T s;
+          detail::givens(a.at(row - 1, col), g, c, s);
+          a.rotate(row - 1, c, s, k + 1);
+          a.at(row, col) = T{};
+        }
+        if (row + k >= n) break;
+        col = row - 1;
+        row += k;
+        if (a.at(row, col) == T{}) break;
+      }
+    }
+  }
+
+  ws.subdiagonal.assign(n, 0.0);
+  double* e = ws.subdiagonal.data();
+  for (std::size_t i = 0; i < n; i++) {
+    w[i] = detail::real_part(a.at(i, i));
+    if (i + 1 < n) e[i] = detail::magnitude(a.at(i + 1, i));
+  }
+  detail::tridiagonal_ql<double>(n, w, e, nullptr);
+  detail::sort_eigenpairs<double>(n, w, nullptr);
+}
+
+#endif  // TIGHTB_EIGEN_H
@@ -0,0 +1,134 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_ENSEMBLE_H
+#define TIGHTB_ENSEMBLE_H
+
+#include <tightb/assert.h>
+#include <tightb/parallel.h>
+#include <tightb/random.h>
+#include <tightb/sparse.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Running mean and variance of a fixed number of observables (Welford's
+// update), mergeable with the pairwise formula of Chan, Golub and LeVeque so
+// partial ensembles can be reduced in any grouping without a second pass.
+class EnsembleAverage {
+ public:
+  explicit EnsembleAverage(std::size_t observables = 0)
+      : mean_(observables, 0.0), m2_(observables, 0.0) {}
+
+  [[nodiscard]] std::size_t observables() const { return mean_.size(); }
+
+  [[nodiscard]] std::size_t count() const { return count_; }
+
+  void add(double const* values);
+
+  void merge(EnsembleAverage const& other);
+
+  [[nodiscard]] std::vector<double> const& mean() const { return mean_; }
+
+  // Sample variance of observable i (n - 1 in the denominator).
+  [[nodiscard]] double variance(std::size_t i) const;
+
+  // Standard error of the mean of observable i.
+  [[nodiscard]] double standard_error(std::size_t i) const;
+
+ private:
+  std::size_t count_ = 0;
+  std::vector<double> mean_;
+  std::vector<double> m2_;
+};
+
+// Anderson-type disorder: on-site energies shifted by a uniform deviate in
+// [-onsite/2, onsite/2] and hoppings by one in [-bond/2, bond/2].
+struct Disorder {
+  double onsite = 0.0;
+  double bond = 0.0;
+};
+
+// Writes base plus the disorder of realization r into h, which must share the
+// pattern of base (a copy of it, say). The deviate of each stored entry is
+// Philox keyed by `seed`, on stream r, at the position of the entry (the
+// upper-triangle entry for a bond, so h stays Hermitian). Any realization can
+// thus be rebuilt bit for bit on its own.
+template <typename T>
+void apply_disorder(SparseMatrix<T> const& base, Disorder const& disorder,
+                    std::uint64_t seed, std::uint64_t r, SparseMatrix<T>& h) {
+  ASSERT(h.size() == base.size() && h.nonzeros() == base.nonzeros());
+  Philox philox(seed);
+  auto const& offsets = base.offsets();
+  auto const& columns = base.columns();
+  auto const& values = base.values();
+  std::vector<T>& out = h.values();
+  for (std::size_t i = 0; i < base.size(); i++) {
+    for (std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+      std::size_t j = columns[k];
+      if (j == i) {
+        out[k] = values[k] + T(disorder.onsite *
+                               (philox.uniform(r, k) - 0.5));
+      } else if (disorder.bond == 0.0) {
+        out[k] = values[k];
+      } else {
+        std::size_t slot = j > i ? k : base.find(j, i);
+        out[k] = values[k] + T(disorder.bond * (philox.uniform(r, slot) - 0.5));
+      }
+    }
+  }
+}
+
+// Averages observable(r, h, values) over the realizations r in [first, first +
+// count) of disorder on `base`; the observable writes `observables` numbers
+// to `values`. Realizations run in parallel, in blocks of `block` whose
+// averages are merged in order, so the result does not depend on the number
+// of threads either.
+template <typename T, typename F>
+EnsembleAverage run_ensemble(SparseMatrix<T> const& base,
+                             Disorder const& disorder, std::uint64_t seed,
+                             std::uint64_t first, std::size_t count,
+                             std::size_t observables, F&& observable,
+                             std::size_t block = 16) {
+  ASSERT(block > 0);
+  std::size_t blocks = (count + block - 1) / block;
+  std::vector<EnsembleAverage> partial(blocks, EnsembleAverage(observables));
+  parallel_for(
+      blocks,
+      [&](std::size_t begin, std::size_t end, std::size_t) {
+        SparseMatrix<T> h = base;
+        std::vector<double> values(observables);
+        for (std::size_t b = begin; b < end; b++) {
+          std::size_t last = std::min(count, (b + 1) * block);
+          for (std::size_t i = b * block; i < last; i++) {
+            std::uint64_t r = first + i;
+            apply_disorder(base, disorder, seed, r, h);
+            observable(r, static_cast<SparseMatrix<T> const&>(h),
+                       values.data());
+            partial[b].add(values.data());
+          }
+        }
+      },
+      1);
+
+  EnsembleAverage total(observables);
+  for (auto const& p : partial) total.merge(p);
+  return total;
+}
+
+#endif  // TIGHTB_ENSEMBLE_H
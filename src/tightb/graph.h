@@ -17,8 +17,72 @@
 #ifndef TIGHTB_GRAPH_H
 #define TIGHTB_GRAPH_H
 
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Undirected graph of sites and bonds stored in compressed sparse row (CSR)
+// form. Every bond (u, v) appears twice, once in the row of each endpoint, and
+// the neighbors of a vertex are sorted in increasing order.
 class Graph {
  public:
+  class Neighbors {
+   public:
+    using value_type = std::size_t;
+    using const_iterator = std::size_t const*;
+
+    Neighbors(std::size_t const* begin, std::size_t const* end)
+        : begin_(begin), end_(end) {}
+
+    [[nodiscard]] std::size_t const* begin() const { return begin_; }
+
+    [[nodiscard]] std::size_t const* end() const { return end_; }
+
+    [[nodiscard]] std::size_t size() const { return end_ - begin_; }
+
+   private:
+    std::size_t const* begin_;
+    std::size_t const* end_;
+  };
+
+  Graph() = default;
+
+  // Builds the graph from a list of bonds. Self loops and repeated bonds are
+  // dropped.
+  Graph(std::size_t vertices,
+        std::vector<std::pair<std::size_t, std::size_t>> const& bonds);
+
+  // Adopts already built CSR arrays. Rows must be sorted and symmetric.
+  Graph(std::vector<std::size_t> offsets, std::vector<std::size_t> adjacency);
+
+  [[nodiscard]] std::size_t size() const {
+    return offsets_.empty() ? 0 : offsets_.size() - 1;
+  }
+
+  [[nodiscard]] std::size_t bonds() const { return adjacency_.size() / 2; }
+
+  [[nodiscard]] std::size_t degree(std::size_t v) const {
+    return offsets_[v + 1] - offsets_[v];
+  }
+
+  [[nodiscard]] Neighbors neighbors(std::size_t v) const {
+    return {adjacency_.data() + offsets_[v],
+            adjacency_.data() + offsets_[v + 1]};
+  }
+
+  [[nodiscard]] bool has_bond(std::size_t u, std::size_t v) const;
+
+  [[nodiscard]] std::vector<std::size_t> const& offsets() const {
+    return offsets_;
+  }
+
+  [[nodiscard]] std::vector<std::size_t> const& adjacency() const {
+    return adjacency_;
+  }
+
+ private:
+  std::vector<std::size_t> offsets_;
+  std::vector<std::size_t> adjacency_;
 };
 
 #endif  // TIGHTB_GRAPH_H
@@ -0,0 +1,192 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_HOFSTADTER_H
+#define TIGHTB_HOFSTADTER_H
+
+#include <tightb/assert.h>
+#include <tightb/eigen.h>
+#include <tightb/hopping.h>
+#include <tightb/lattice.h>
+#include <tightb/parallel.h>
+#include <tightb/peierls.h>
+#include <tightb/vector.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Flux p/q per plaquette, in lowest terms.
+struct Flux {
+  long p;
+  long q;
+};
+
+// Every flux p/q in [0, 1] with q <= max_q, ordered by q and then p: the
+// Farey sequence of order max_q.
+std::vector<Flux> farey_fluxes(long max_q);
+
+// Spectrum of one flux at the k-point with index `k` of the sweep.
+struct FluxSpectrum {
+  Flux flux;
+  std::uint32_t k;
+  std::vector<double> energies;
+};
+
+// Binary butterfly file: magic, version, then one record per spectrum of
+// [p, q, k, count] as 32-bit integers (p signed, the rest unsigned) followed
+// by the energies as 32-bit floats, which is ample for plotting and halves the
+// file.
+void write_hofstadter_header(std::ostream& out);
+
+void write_spectrum(std::ostream& out, FluxSpectrum const& spectrum);
+
+std::vector<FluxSpectrum> read_hofstadter(std::istream& in);
+
+namespace detail {
+
+// Position of copy c of the magnetic cell in the folded order 0, 1, q - 1, 2,
+// q - 2, ...: neighbors on the ring of q copies end up at most two places
+// apart, so the periodic block-tridiagonal Harper matrix becomes a plain band
+// matrix.
+inline std::size_t folded(std::size_t c, std::size_t q) {
+  return c == 0 ? 0 : (2 * c <= q ? 2 * c - 1 : 2 * (q - c));
+}
+
+}  // namespace detail
+
+// Spectra of a 2D model over many rational fluxes, for Hofstadter
+// butterflies. For each flux the magnetic Hamiltonian H(k) (see
+// MagneticCell; q copies of the cell along a1) is assembled straight into
+// band storage with the copies in folded order, then diagonalized by
+// band_eigenvalues(), which costs O(q^2) per flux for a model with hoppings to
+// neighboring cells along a1 against O(q^3) for a dense solver. Fluxes are
+// handed out largest q first from a shared counter, so the expensive ones
+// start early and the cheap ones fill the gaps at the end.
+template <std::size_t D>
+class HofstadterSweep {
+ public:
+  HofstadterSweep(UnitCell<D> const& cell, HoppingTable<D> const& table,
+                  std::vector<Vec<double, D>> ks)
+      : table_(table),
+        positions_(detail::orbital_positions(cell)),
+        ks_(std::move(ks)) {
+    ASSERT(cell.orbitals() == table.orbitals());
+  }
+
+  [[nodiscard]] std::vector<Vec<double, D>> const& k_points() const {
+    return ks_;
+  }
+
+  // Eigenvalues of H(ks[k]) at flux p/q into `energies` (q * orbitals).
+  void spectrum(Flux const& flux, std::size_t k, std::vector<double>& energies,
+                std::vector<std::complex<double>>& band,
+                BandWorkspace<std::complex<double>>& work) const;
+
+  // Calls sink(FluxSpectrum const&) for every flux and k-point, from one
+  // thread at a time, in order of completion.
+  template <typename F>
+  void run(std::vector<Flux> fluxes, F&& sink) const;
+
+  // Streams every spectrum into the binary butterfly format.
+  void write(std::ostream& out, std::vector<Flux> const& fluxes) const;
+
+ private:
+  HoppingTable<D> const& table_;
+  std::vector<Vec<double, D>> positions_;
+  std::vector<Vec<double, D>> ks_;
+};
+
+template <std::size_t D>
+void HofstadterSweep<D>::spectrum(
+    Flux const& flux, std::size_t k, std::vector<double>& energies,
+    std::vector<std::complex<double>>& band,
+    BandWorkspace<std::complex<double>>& work) const {
+  ASSERT(flux.q > 0, "flux with a non-positive denominator");
+  std::size_t n = table_.orbitals();
+  std::size_t q = static_cast<std::size_t>(flux.q);
+  std::size_t size = q * n;
+  auto index = [&](std::size_t c, std::size_t a) {
+    return detail::folded(c, q) * n + a;
+  };
+
+  // First pass for the bandwidth, second to fill the upper band.
+  std::size_t b = 0;
+  detail::magnetic_hops(positions_, table_, flux.p, flux.q,
+                        [&](std::size_t c, std::size_t a, std::size_t copy,
+                            std::size_t o, Vec<int, D> const&,
+                            std::complex<double>) {
+                          std::size_t i = index(c, a);
+                          std::size_t j = index(copy, o);
+                          b = std::max(b, i > j ? i - j : j - i);
+                        });
+  std::size_t width = b + 1;
+  band.assign(size * width, 0.0);
+  Vec<double, D> const& kpoint = ks_[k];
+  detail::magnetic_hops(
+      positions_, table_, flux.p, flux.q,
+      [&](std::size_t c, std::size_t a, std::size_t copy, std::size_t o,
+          Vec<int, D> const& cell, std::complex<double> t) {
+        std::size_t i = index(c, a);
+        std::size_t j = index(copy, o);
+        if (j < i) return;  // the lower triangle follows by hermiticity
+        double angle = 0.0;
+        for (std::size_t d = 0; d < D; d++) angle += kpoint[d] * cell[d];
+        band[i * width + (j - i)] += t * std::polar(1.0, 2.0 * M_PI * angle);
+      });
+  energies.resize(size);
+  band_eigenvalues(size, b, band.data(), energies.data(), work);
+}
+
+template <std::size_t D>
+template <typename F>
+void HofstadterSweep<D>::run(std::vector<Flux> fluxes, F&& sink) const {
+  std::stable_sort(fluxes.begin(), fluxes.end(),
+                   [](Flux const& x, Flux const& y) { return x.q > y.q; });
+  std::size_t tasks = fluxes.size() * ks_.size();
+  std::atomic<std::size_t> next{0};
+  std::mutex mutex;
+  parallel_run(std::max<std::size_t>(1, std::min(max_threads(), tasks)),
+               [&](std::size_t) {
+                 std::vector<std::complex<double>> band;
+                 BandWorkspace<std::complex<double>> work;
+                 FluxSpectrum result;
+                 for (std::size_t task = next++; task < tasks; task = next++) {
+                   result.flux = fluxes[task / ks_.size()];
+                   result.k = static_cast<std::uint32_t>(task % ks_.size());
+                   spectrum(result.flux, result.k, result.energies, band, work);
+                   std::lock_guard<std::mutex> lock(mutex);
+                   sink(static_cast<FluxSpectrum const&>(result));
+                 }
+               });
+}
+
+template <std::size_t D>
+void HofstadterSweep<D>::write(std::ostream& out,
+                               std::vector<Flux> const& fluxes) const {
+  write_hofstadter_header(out);
+  run(fluxes,
+      [&](FluxSpectrum const& spectrum) { write_spectrum(out, spectrum); });
+}
+
+#endif  // TIGHTB_HOFSTADTER_H
@@ -0,0 +1,162 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_HOPPING_H
+#define TIGHTB_HOPPING_H
+
+#include <tightb/assert.h>
+#include <tightb/vector.h>
+
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// Hoppings of a periodic model grouped by lattice translation R. Block r holds
+// t_ab(R_r) = <a, 0|H|b, R_r> for every pair of orbitals, row-major, with the
+// real and imaginary parts in separate arrays so kernels can stream them with
+// plain (vectorizable) arithmetic.
+template <std::size_t D>
+class HoppingTable {
+ public:
+  explicit HoppingTable(std::size_t orbitals) : orbitals_(orbitals) {}
+
+  [[nodiscard]] std::size_t orbitals() const { return orbitals_; }
+
+  [[nodiscard]] std::size_t translations() const { return cells_.size(); }
+
+  [[nodiscard]] Vec<int, D> const& translation(std::size_t r) const {
+    return cells_[r];
+  }
+
+  // Index of the block for `cell`, or translations() if there is none.
+  [[nodiscard]] std::size_t find(Vec<int, D> const& cell) const;
+
+  // Adds t to <a, 0|H|b, cell>, creating the block if needed.
+  void add(Vec<int, D> const& cell, std::size_t a, std::size_t b,
+           std::complex<double> t);
+
+  // Adds a whole orbitals x orbitals block, row-major, to <., 0|H|., cell>.
+  void add_block(Vec<int, D> const& cell, double const* re, double const* im);
+
+  // Adds t to <a, 0|H|b, cell> and its conjugate to <b, 0|H|a, -cell>, so the
+  // table stays Hermitian. An on-site term (cell = 0, a = b) is added once.
+  void add_hermitian(Vec<int, D> const& cell, std::size_t a, std::size_t b,
+                     std::complex<double> t);
+
+  [[nodiscard]] std::complex<double> at(std::size_t r, std::size_t a,
+                                        std::size_t b) const {
+    std::size_t k = (r * orbitals_ + a) * orbitals_ + b;
+    return {re_[k], im_[k]};
+  }
+
+  [[nodiscard]] double const* real(std::size_t r) const {
+    return re_.data() + r * orbitals_ * orbitals_;
+  }
+
+  [[nodiscard]] double const* imag(std::size_t r) const {
+    return im_.data() + r * orbitals_ * orbitals_;
+  }
+
+  // Whether every hopping is real, to `tolerance`. For a spinless model this
+  // is time-reversal symmetry: H(-k) = H(k)^*, so E(-k) = E(k) and the
+  // eigenvectors at -k are the conjugates of those at k.
+  [[nodiscard]] bool time_reversal_symmetric(double tolerance = 1e-12) const {
+    for (double x : im_) {
+      if (std::abs(x) > tolerance) return false;
+    }
+    return true;
+  }
+
+  // Components of the translations, one contiguous array per direction.
+  [[nodiscard]] std::vector<double> const& components(std::size_t d) const {
+    return components_[d];
+  }
+
+ private:
+  static std::array<int, D> key(Vec<int, D> const& cell);
+
+  std::size_t block(Vec<int, D> const& cell);
+
+  std::size_t orbitals_;
+  std::vector<Vec<int, D>> cells_;
+  std::array<std::vector<double>, D> components_;
+  std::map<std::array<int, D>, std::size_t> index_;
+  std::vector<double> re_;
+  std::vector<double> im_;
+};
+
+template <std::size_t D>
+std::array<int, D> HoppingTable<D>::key(Vec<int, D> const& cell) {
+  std::array<int, D> k;
+  for (std::size_t d = 0; d < D; d++) k[d] = cell[d];
+  return k;
+}
+
+template <std::size_t D>
+std::size_t HoppingTable<D>::find(Vec<int, D> const& cell) const {
+  auto it = index_.find(key(cell));
+  return it == index_.end() ? translations() : it->second;
+}
+
+template <std::size_t D>
+std::size_t HoppingTable<D>::block(Vec<int, D> const& cell) {
+  auto [it, inserted] = index_.emplace(key(cell), cells_.size());
+  if (inserted) {
+    cells_.push_back(cell);
+    for (std::size_t d = 0; d < D; d++) components_[d].push_back(cell[d]);
+    re_.resize(re_.size() + orbitals_ * orbitals_, 0.0);
+    im_.resize(im_.size() + orbitals_ * orbitals_, 0.0);
+  }
+  return it->second;
+}
+
+template <std::size_t D>
+void HoppingTable<D>::add(Vec<int, D> const& cell, std::size_t a,
+                          std::size_t b, std::complex<double> t) {
+  ASSERT(a < orbitals_ && b < orbitals_);
+  std::size_t k = (block(cell) * orbitals_ + a) * orbitals_ + b;
+  re_[k] += t.real();
+  im_[k] += t.imag();
+}
+
+template <std::size_t D>
+void HoppingTable<D>::add_block(Vec<int, D> const& cell, double const* re,
+                                double const* im) {
+  std::size_t size = orbitals_ * orbitals_;
+  std::size_t first = block(cell) * size;
+  for (std::size_t k = 0; k < size; k++) {
+    re_[first + k] += re[k];
+    im_[first + k] += im[k];
+  }
+}
+
+template <std::size_t D>
+void HoppingTable<D>::add_hermitian(Vec<int, D> const& cell, std::size_t a,
+                                    std::size_t b, std::complex<double> t) {
+  bool home = true;
+  for (std::size_t d = 0; d < D; d++) home = home && cell[d] == 0;
+  if (home && a == b) {
+    add(cell, a, a, t.real());
+    return;
+  }
+  add(cell, a, b, t);
+  add(cell * -1, b, a, std::conj(t));
+}
+
+#endif  // TIGHTB_HOPPING_H
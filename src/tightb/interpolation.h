@@ -0,0 +1,312 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_INTERPOLATION_H
+#define TIGHTB_INTERPOLATION_H
+
+#include <tightb/assert.h>
+#include <tightb/bloch.h>
+#include <tightb/eigen.h>
+#include <tightb/hopping.h>
+#include <tightb/lattice.h>
+#include <tightb/parallel.h>
+#include <tightb/vector.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Real-space hoppings t(R) = 1/N sum_k H(k) e^{-2 pi i k.R} from H(k) sampled
+// on the Gamma-centered mesh k = n / mesh, given row-major in the order of
+// BlochHamiltonian::mesh() with `orbitals`^2 entries per point. The transform
+// is done one direction at a time, so it costs N sum_d mesh[d] instead of N^2
+// block operations.
+//
+// R is taken from the centered range -mesh/2 < R_d <= mesh/2. On an even mesh
+// the last shell R_d = mesh/2 is aliased with -mesh/2 and is split evenly
+// between the two, which keeps the table Hermitian. Blocks whose entries are
+// all below `cutoff` in magnitude are dropped. The interpolation reproduces
+// the samples exactly and is exact everywhere if the model has no hoppings
+// beyond the centered range.
+template <std::size_t D>
+HoppingTable<D> fourier_interpolate(
+    std::array<std::size_t, D> const& mesh, std::size_t orbitals,
+    std::vector<std::complex<double>> const& hk, double cutoff = 1e-12) {
+  using complex = std::complex<double>;
+  std::size_t block = orbitals * orbitals;
+  std::size_t points = 1;
+  for (std::size_t d = 0; d < D; d++) {
+    ASSERT(mesh[d] > 0);
+    points *= mesh[d];
+  }
+  ASSERT(hk.size() == points * block);
+
+  std::vector<complex> data = hk;
+  std::vector<complex> line;
+  std::vector<complex> twiddle;
+  for (std::size_t d = 0; d < D; d++) {
+    std::size_t m = mesh[d];
+    std::size_t outer = 1;
+    std::size_t inner = 1;
+    for (std::size_t e = 0; e < d; e++) outer *= mesh[e];
+    for (std::size_t e = d + 1; e < D; e++) inner *= mesh[e];
+    twiddle.resize(m);
+    for (std::size_t t = 0; t < m; t++) {
+      double angle = -2.0 * M_PI * static_cast<double>(t) / m;
+      twiddle[t] = {std::cos(angle), std::sin(angle)};
+    }
+    line.resize(m * block);
+
+    std::size_t stride = inner * block;
+    for (std::size_t o = 0; o < outer; o++) {
+      for (std::size_t i = 0; i < inner; i++) {
+        complex* base = data.data() + (o * m * inner + i) * block;
+        std::fill(line.begin(), line.end(), complex{});
+        for (std::size_t r = 0; r < m; r++) {
+          complex* out = line.data() + r * block;
+          for (std::size_t j = 0; j < m; j++) {
+            complex f = twiddle[(j * r) % m];
+            complex const* in = base + j * stride;
+            for (std::size_t a = 0; a < block; a++) out[a] += f * in[a];
+          }
+        }
+        for (std::size_t r = 0; r < m; r++) {
+          std::copy(line.begin() + r * block, line.begin() + (r + 1) * block,
+                    base + r * stride);
+        }
+      }
+    }
+  }
+
+  HoppingTable<D> table(orbitals);
+  for (std::size_t p = 0; p < points; p++) {
+    complex const* t = data.data() + p * block;
+    double largest = 0.0;
+    for (std::size_t a = 0; a < block; a++) {
+      largest = std::max(largest, std::abs(t[a]));
+    }
+    if (largest / static_cast<double>(points) <= cutoff) continue;
+
+    Vec<int, D> cell{};
+    std::array<bool, D> aliased{};
+    std::size_t rest = p;
+    for (std::size_t d = D; d > 0; d--) {
+      std::size_t m = mesh[d - 1];
+      std::size_t r = rest % m;
+      rest /= m;
+      int value = static_cast<int>(r);
+      if (2 * r > m) value -= static_cast<int>(m);
+      cell[d - 1] = value;
+      aliased[d - 1] = 2 * r == m;
+    }
+    std::size_t shells = 0;
+    for (std::size_t d = 0; d < D; d++) shells += aliased[d];
+    double weight = 1.0 / (static_cast<double>(points) *
+                           static_cast<double>(std::size_t{1} << shells));
+
+    // Every combination of +-mesh/2 over the aliased directions.
+    for (std::size_t mask = 0; mask < (std::size_t{1} << shells); mask++) {
+      Vec<int, D> image = cell;
+      std::size_t bit = 0;
+      for (std::size_t d = 0; d < D; d++) {
+        if (!aliased[d]) continue;
+        if (mask >> bit++ & 1) image[d] = -image[d];
+      }
+      for (std::size_t a = 0; a < orbitals; a++) {
+        for (std::size_t b = 0; b < orbitals; b++) {
+          table.add(image, a, b, weight * t[a * orbitals + b]);
+        }
+      }
+    }
+  }
+  return table;
+}
+
+// Band energies and velocities from an interpolated (or any) hopping table,
+// evaluated in parallel over batches of k-points. Each thread owns its
+// workspaces, set up before the loop, so the per-point work allocates
+// nothing.
+template <std::size_t D>
+class BandInterpolator {
+ public:
+  BandInterpolator(Lattice<D> const& lattice, HoppingTable<D> table)
+      : lattice_(lattice), table_(std::move(table)) {}
+
+  [[nodiscard]] HoppingTable<D> const& table() const { return table_; }
+
+  [[nodiscard]] std::size_t orbitals() const { return table_.orbitals(); }
+
+  // Energies of the `count` points k (reduced coordinates), energies[i * n +
+  // b] for band b. If `velocities` is not null it receives the Cartesian band
+  // velocities dE/dk, velocities[(i * n + b) * D + c], from the
+  // Hellmann-Feynman theorem <b|dH/dk_c|b>. Inside a degenerate subspace
+  // these are the diagonal elements in whatever basis the solver returned.
+  void evaluate(std::size_t count, Vec<double, D> const* k, double* energies,
+                double* velocities = nullptr) const;
+
+  // Energies on the uniform mesh k = (n + shift) / mesh, in the row-major
+  // order of BlochHamiltonian::mesh(). Lines along the last direction are
+  // shared out between threads and walked with incremental phases. For a
+  // time-reversal symmetric table only half of the lines are evaluated.
+  void evaluate_mesh(std::array<std::size_t, D> const& mesh,
+                     Vec<double, D> const& shift, double* energies) const;
+
+ private:
+  struct Workspace {
+    BlochWorkspace bloch;
+    EigenWorkspace<std::complex<double>> eigen;
+    std::vector<std::complex<double>> h;
+    std::vector<std::complex<double>> dh;
+  };
+
+  [[nodiscard]] std::vector<Workspace> workspaces() const;
+
+  [[nodiscard]] std::size_t grain(std::size_t per_item) const {
+    std::size_t n = orbitals();
+    return std::max<std::size_t>(1, 4096 / (n * n * n * per_item + 1));
+  }
+
+  Lattice<D> lattice_;
+  HoppingTable<D> table_;
+};
+
+template <std::size_t D>
+auto BandInterpolator<D>::workspaces() const -> std::vector<Workspace> {
+  std::size_t n = orbitals();
+  std::vector<Workspace> workspaces(max_threads());
+  for (auto& w : workspaces) {
+    w.h.resize(n * n);
+    w.dh.resize(n * n);
+    w.eigen.reserve(n);
+  }
+  return workspaces;
+}
+
+template <std::size_t D>
+void BandInterpolator<D>::evaluate(std::size_t count, Vec<double, D> const* k,
+                                   double* energies,
+                                   double* velocities) const {
+  std::size_t n = orbitals();
+  BlochHamiltonian<D> hamiltonian(table_);
+  std::vector<Workspace> workspaces = this->workspaces();
+
+  parallel_for(
+      count,
+      [&](std::size_t begin, std::size_t end, std::size_t thread) {
+        Workspace& w = workspaces[thread];
+        for (std::size_t i = begin; i < end; i++) {
+          hamiltonian.build(k[i], w.h.data(), w.bloch);
+          double* e = energies + i * n;
+          if (velocities == nullptr) {
+            hermitian_eigenvalues(n, w.h.data(), e, w.eigen);
+            continue;
+          }
+          hermitian_eigensystem(n, w.h.data(), e, w.eigen);
+          for (std::size_t c = 0; c < D; c++) {
+            Vec<double, D> weights{};
+            for (std::size_t j = 0; j < D; j++) {
+              weights[j] = lattice_.vectors().at(j, c);
+            }
+            hamiltonian.derivative(weights, w.bloch, w.dh.data());
+            for (std::size_t b = 0; b < n; b++) {
+              std::complex<double> const* z = w.h.data() + b * n;
+              double v = 0.0;
+              for (std::size_t x = 0; x < n; x++) {
+                std::complex<double> row{};
+                for (std::size_t y = 0; y < n; y++) {
+                  row += w.dh[x * n + y] * z[y];
+                }
+                v += (std::conj(z[x]) * row).real();
+              }
+              velocities[(i * n + b) * D + c] = v;
+            }
+          }
+        }
+      },
+      grain(1));
+}
+
+template <std::size_t D>
+void BandInterpolator<D>::evaluate_mesh(std::array<std::size_t, D> const& mesh,
+                                        Vec<double, D> const& shift,
+                                        double* energies) const {
+  std::size_t n = orbitals();
+  std::size_t length = mesh[D - 1];
+  std::size_t lines = 1;
+  for (std::size_t d = 0; d + 1 < D; d++) lines *= mesh[d];
+
+  // With time reversal E(-k) = E(k). -k is on the mesh when 2 shift is an
+  // integer, and then n -> -n - 2 shift (mod mesh) pairs whole lines, so only
+  // one line of each pair is walked and the other is filled by mirroring.
+  std::array<long, D> twice{};
+  bool paired = table_.time_reversal_symmetric();
+  for (std::size_t d = 0; d < D; d++) {
+    double x = 2.0 * shift[d];
+    twice[d] = std::lround(x);
+    paired = paired && std::abs(x - static_cast<double>(twice[d])) < 1e-12;
+  }
+  auto mirror = [&](std::size_t index, std::size_t d) {
+    long m = static_cast<long>(mesh[d]);
+    long c = -static_cast<long>(index) - twice[d];
+    return static_cast<std::size_t>(((c % m) + m) % m);
+  };
+  auto partner = [&](std::size_t line) {
+    std::size_t result = 0;
+    std::size_t scale = 1;
+    for (std::size_t d = D - 1; d > 0; d--) {
+      result += mirror(line % mesh[d - 1], d - 1) * scale;
+      scale *= mesh[d - 1];
+      line /= mesh[d - 1];
+    }
+    return result;
+  };
+  std::vector<std::size_t> walked;
+  for (std::size_t line = 0; line < lines; line++) {
+    if (!paired || line <= partner(line)) walked.push_back(line);
+  }
+
+  BlochHamiltonian<D> hamiltonian(table_);
+  std::vector<Workspace> workspaces = this->workspaces();
+  parallel_for(
+      walked.size(),
+      [&](std::size_t begin, std::size_t end, std::size_t thread) {
+        Workspace& w = workspaces[thread];
+        for (std::size_t l = begin; l < end; l++) {
+          std::size_t line = walked[l];
+          hamiltonian.mesh(mesh, shift, line, line + 1, w.bloch,
+                           [&](std::size_t i, std::complex<double> const* h) {
+                             std::copy(h, h + n * n, w.h.begin());
+                             hermitian_eigenvalues(n, w.h.data(),
+                                                   energies + i * n, w.eigen);
+                           });
+          if (!paired) continue;
+          std::size_t other = partner(line);
+          if (other == line) continue;
+          for (std::size_t j = 0; j < length; j++) {
+            double const* from = energies + (line * length + j) * n;
+            std::copy(from, from + n,
+                      energies + (other * length + mirror(j, D - 1)) * n);
+          }
+        }
+      },
+      grain(length));
+}
+
+#endif  // TIGHTB_INTERPOLATION_H
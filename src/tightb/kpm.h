@@ -0,0 +1,345 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_KPM_H
+#define TIGHTB_KPM_H
+
+#include <tightb/assert.h>
+#include <tightb/eigen.h>
+#include <tightb/orbitals.h>
+#include <tightb/parallel.h>
+#include <tightb/random.h>
+#include <tightb/scalar.h>
+#include <tightb/sparse.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Kernel polynomial method (Weisse, Wellein, Alvermann and Fehske, RMP 78,
+// 275): spectral quantities of matrices far too large to diagonalize, from
+// Chebyshev moments mu_n = Tr T_n(H~) / N of the Hamiltonian rescaled into
+// (-1, 1), with the trace estimated stochastically.
+
+// Interval meant to hold the whole spectrum: guaranteed for
+// gershgorin_bounds(), an estimate for lanczos_bounds().
+struct SpectralBounds {
+  double min = 0.0;
+  double max = 0.0;
+};
+
+// E = center + half_width x maps the bounds, widened by the fraction
+// `padding`, onto x in [-1, 1]. The padding keeps the rescaled spectrum off
+// the endpoints, where the Chebyshev expansion of a DOS converges badly.
+struct ChebyshevScale {
+  double center = 0.0;
+  double half_width = 1.0;
+
+  ChebyshevScale() = default;
+
+  explicit ChebyshevScale(SpectralBounds const& bounds, double padding = 0.01)
+      : center(0.5 * (bounds.max + bounds.min)),
+        half_width(0.5 * (bounds.max - bounds.min) / (1.0 - padding)) {
+    ASSERT(bounds.max > bounds.min && padding >= 0.0 && padding < 1.0);
+  }
+
+  [[nodiscard]] double energy(double x) const {
+    return center + half_width * x;
+  }
+};
+
+// Gershgorin discs of a matrix with full storage: cheap, one pass over the
+// values, and never too narrow, though often somewhat too wide.
+template <typename T>
+SpectralBounds gershgorin_bounds(SparseMatrix<T> const& h) {
+  ASSERT(h.triangle() == Triangle::Full && h.size() > 0);
+  auto const& offsets = h.offsets();
+  auto const& columns = h.columns();
+  auto const& values = h.values();
+  std::vector<SpectralBounds> partial(max_threads(), {HUGE_VAL, -HUGE_VAL});
+  parallel_for(h.size(), [&](std::size_t begin, std::size_t end,
+                             std::size_t thread) {
+    SpectralBounds& b = partial[thread];
+    for (std::size_t i = begin; i < end; i++) {
+      double center = 0.0;
+      double radius = 0.0;
+      for (std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+        if (columns[k] == i) {
+          center = std::real(values[k]);
+        } else {
+          radius += std::abs(values[k]);
+        }
+      }
+      b.min = std::min(b.min, center - radius);
+      b.max = std::max(b.max, center + radius);
+    }
+  });
+  SpectralBounds bounds{HUGE_VAL, -HUGE_VAL};
+  for (auto const& b : partial) {
+    bounds.min = std::min(bounds.min, b.min);
+    bounds.max = std::max(bounds.max, b.max);
+  }
+  return bounds;
+}
+
+// Extreme Ritz values after `steps` Lanczos iterations from a random start,
+// each widened by the norm of its residual. Much tighter than Gershgorin for
+// a comparable number of SpMVs; the extreme Ritz values converge first.
+//
+// This is a heuristic. The residual only guarantees that some eigenvalue lies
+// within it of each Ritz value, not that the extreme ones do, so before
+// convergence the true spectrum may reach past these bounds. The Chebyshev
+// recursion grows exponentially on any eigenvalue outside [-1, 1], so give
+// ChebyshevScale a few percent of padding on top, or use gershgorin_bounds()
+// when too few steps are affordable.
+template <typename T>
+SpectralBounds lanczos_bounds(SparseMatrix<T> const& h, std::size_t steps = 64,
+                              std::uint64_t seed = 0) {
+  std::size_t n = h.size();
+  ASSERT(n > 0 && steps > 0);
+  steps = std::min(steps, n);
+  std::vector<T> previous(n, T{});
+  std::vector<T> current(n);
+  std::vector<T> next(n);
+  Philox philox(seed);
+  double norm = 0.0;
+  for (std::size_t i = 0; i < n; i++) {
+    current[i] = philox.uniform(0, i) - 0.5;
+    norm += std::norm(current[i]);
+  }
+  for (T& x : current) x /= std::sqrt(norm);
+
+  std::vector<double> alpha;
+  std::vector<double> beta;
+  for (std::size_t j = 0; j < steps; j++) {
+    h.multiply(current.data(), next.data());
+    double a = 0.0;
+    for (std::size_t i = 0; i < n; i++) {
+      a += std::real(conjugate(current[i]) * next[i]);
+    }
+    double b = 0.0;
+    double last = beta.empty() ? 0.0 : beta.back();
+    for (std::size_t i = 0; i < n; i++) {
+      next[i] -= a * current[i] + last * previous[i];
+      b += std::norm(next[i]);
+    }
+    alpha.push_back(a);
+    beta.push_back(std::sqrt(b));
+    if (beta.back() <= 1e-12 * (std::abs(a) + last)) break;
+    for (std::size_t i = 0; i < n; i++) next[i] /= beta.back();
+    previous.swap(current);
+    current.swap(next);
+  }
+
+  std::size_t m = alpha.size();
+  std::vector<double> t(m * m, 0.0);
+  for (std::size_t j = 0; j < m; j++) {
+    t[j * m + j] = alpha[j];
+    if (j + 1 < m) t[j * m + j + 1] = t[(j + 1) * m + j] = beta[j];
+  }
+  std::vector<double> theta(m);
+  EigenWorkspace<double> ws;
+  hermitian_eigensystem(m, t.data(), theta.data(), ws);
+  // The residual of Ritz pair i is beta_m times the last component of its
+  // eigenvector of the tridiagonal matrix.
+  double low = beta.back() * std::abs(t[m - 1]);
+  double high = beta.back() * std::abs(t[(m - 1) * m + m - 1]);
+  return {theta.front() - low, theta.back() + high};
+}
+
+// Damping factors g_n for n < moments that suppress the Gibbs oscillations
+// of a truncated expansion. Jackson is the choice for densities of states
+// (resolution ~ pi / moments, positive everywhere); Lorentz, with lambda
+// around 3 to 5, mimics a finite broadening and is the one to use for Green's
+// functions.
+enum class KpmKernel {
+  Jackson,
+  Lorentz,
+};
+
+std::vector<double> kpm_kernel(KpmKernel kernel, std::size_t moments,
+                               double lambda = 4.0);
+
+namespace detail {
+
+// In-place radix-2 FFT, a.size() a power of two: a_k <- sum_n a_n
+// e^{-+2 pi i n k / size}, the sign + for `inverse`. Not normalized.
+void fft(std::vector<std::complex<double>>& a, bool inverse);
+
+// y_k = sum_n c_n cos(n theta_k) at the Chebyshev nodes theta_k = pi (k +
+// 1/2) / points, k < points, for any number of coefficients. This is a DCT of
+// type III, evaluated with one complex FFT of length 2 points when that is a
+// power of two and by direct summation otherwise.
+std::vector<double> chebyshev_sum(std::vector<double> const& c,
+                                  std::size_t points);
+
+// Entries [begin, end) of random-phase vector `vector`, written to x[i *
+// stride]: entry i is e^{2 pi i u} (+-1 for a real T) with u taken from word
+// i % 4 of the Philox block keyed by `seed`, stream `vector`, position i / 4.
+// The vectors thus do not depend on how they are batched or threaded.
+template <typename T>
+void random_phases(Philox const& philox, std::uint64_t vector,
+                   std::size_t begin, std::size_t end, T* x,
+                   std::size_t stride) {
+  Philox::Block block{};
+  for (std::size_t i = begin; i < end; i++) {
+    if (i == begin || i % 4 == 0) block = philox(vector, i / 4);
+    std::uint32_t word = block[i % 4];
+    if constexpr (is_complex_v<T>) {
+      x[i * stride] = std::polar(1.0, 2.0 * M_PI * 0x1.0p-32 * word);
+    } else {
+      x[i * stride] = word >> 31 ? -1.0 : 1.0;
+    }
+  }
+}
+
+// One step of the Chebyshev recursion on a block of `width` vectors stored
+// interleaved, x[i * width + r]: y <- alpha H x - beta x - y (no "- y" unless
+// `recur`), an SpMM that reads every stored entry of H once for the whole
+// block. Returns in dots[r] = <y_r|y_r> and dots[width + r] = Re <y_r|x_r>,
+// which the doubling relations turn into two moments each, unless dots is
+// null. N > 0 is the width as a compile-time constant, N = 0 the generic
+// path. The vectors may be complex for a real H.
+template <std::size_t N, typename T, typename V = T>
+void chebyshev_step(SparseMatrix<T> const& h, std::size_t width, double alpha,
+                    double beta, bool recur, V const* x, V* y, double* dots) {
+  std::size_t const w = N == 0 ? width : N;
+  auto const& offsets = h.offsets();
+  auto const& columns = h.columns();
+  auto const& values = h.values();
+  std::vector<std::vector<double>> partial(max_threads());
+  parallel_for(h.size(), [&](std::size_t begin, std::size_t end,
+                             std::size_t thread) {
+    std::vector<double>& d = partial[thread];
+    d.assign(2 * w, 0.0);
+    std::conditional_t<N == 0, std::vector<V>, std::array<V, N>> sum{};
+    if constexpr (N == 0) sum.resize(w);
+    for (std::size_t i = begin; i < end; i++) {
+      for (std::size_t r = 0; r < w; r++) sum[r] = V{};
+      for (std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+        T v = values[k];
+        V const* xk = x + columns[k] * w;
+        for (std::size_t r = 0; r < w; r++) sum[r] += v * xk[r];
+      }
+      V const* xi = x + i * w;
+      V* yi = y + i * w;
+      for (std::size_t r = 0; r < w; r++) {
+        V next = alpha * sum[r] - beta * xi[r];
+        if (recur) next -= yi[r];
+        yi[r] = next;
+        if (dots == nullptr) continue;
+        d[r] += std::norm(next);
+        d[w + r] += std::real(conjugate(next) * xi[r]);
+      }
+    }
+  });
+  if (dots == nullptr) return;
+  std::fill(dots, dots + 2 * w, 0.0);
+  for (auto const& d : partial) {
+    for (std::size_t r = 0; r < d.size(); r++) dots[r] += d[r];
+  }
+}
+
+}  // namespace detail
+
+// Chebyshev moments mu_n = Tr T_n((H - center) / half_width) / N, n <
+// moments, estimated from `vectors` random-phase vectors. The vectors go
+// through the recursion `block` at a time as one interleaved block, so each
+// pass over H serves the whole block, and the doubling relations mu_2n = 2
+// <T_n|T_n> - mu_0 and mu_2n+1 = 2 <T_n+1|T_n> - mu_1 give two moments per
+// step, so moments / 2 SpMMs per block. Rows are split between threads inside
+// each step. The working set is 2 N block scalars. H must have full storage;
+// run real symmetric models through real_part() for the real path.
+template <typename T>
+std::vector<double> kpm_moments(SparseMatrix<T> const& h,
+                                ChebyshevScale const& scale,
+                                std::size_t moments, std::size_t vectors,
+                                std::uint64_t seed, std::size_t block = 4) {
+  ASSERT(h.triangle() == Triangle::Full);
+  ASSERT(moments >= 2 && vectors > 0 && block > 0);
+  std::size_t n = h.size();
+  std::vector<double> mu(moments, 0.0);
+  std::vector<T> a(n * block);
+  std::vector<T> b(n * block);
+  std::vector<double> dots(2 * block);
+  Philox philox(seed);
+
+  for (std::size_t first = 0; first < vectors; first += block) {
+    std::size_t width = std::min(block, vectors - first);
+    // a = T_0 |r>, b = T_1 |r>
+    parallel_for(n, [&](std::size_t begin, std::size_t end, std::size_t) {
+      for (std::size_t r = 0; r < width; r++) {
+        detail::random_phases(philox, first + r, begin, end, a.data() + r,
+                              width);
+      }
+    });
+    double mu0 = static_cast<double>(n * width);
+    auto step = [&](double alpha, double beta, bool recur, T const* x, T* y) {
+      dispatch_orbitals(width, [&](auto fixed) {
+        detail::chebyshev_step<decltype(fixed)::value>(
+            h, width, alpha, beta, recur, x, y, dots.data());
+      });
+      double square = 0.0;
+      double cross = 0.0;
+      for (std::size_t r = 0; r < width; r++) {
+        square += dots[r];
+        cross += dots[width + r];
+      }
+      return std::array<double, 2>{square, cross};
+    };
+    auto [square, cross] = step(1.0 / scale.half_width,
+                                scale.center / scale.half_width, false,
+                                a.data(), b.data());
+    double mu1 = cross;
+    mu[0] += mu0;
+    mu[1] += mu1;
+    if (moments > 2) mu[2] += 2.0 * square - mu0;
+
+    // T_m+1 = 2 H~ T_m - T_m-1 overwrites T_m-1.
+    T* older = a.data();
+    T* newer = b.data();
+    for (std::size_t m = 1; 2 * m + 1 < moments; m++) {
+      auto [sq, cr] = step(2.0 / scale.half_width,
+                           2.0 * scale.center / scale.half_width, true, newer,
+                           older);
+      std::swap(older, newer);
+      mu[2 * m + 1] += 2.0 * cr - mu1;
+      if (2 * m + 2 < moments) mu[2 * m + 2] += 2.0 * sq - mu0;
+    }
+  }
+  for (double& m : mu) m /= static_cast<double>(n * vectors);
+  return mu;
+}
+
+// Density of states per orbital (integrating to one) reconstructed from
+// moments at the `points` Chebyshev nodes E_k = center + half_width cos(pi (k
+// + 1/2) / points), returned in ascending order of energy. The kernel is
+// applied here, so pass raw moments.
+struct KpmDensity {
+  std::vector<double> energy;
+  std::vector<double> density;
+};
+
+KpmDensity kpm_density(std::vector<double> const& moments,
+                       ChebyshevScale const& scale, std::size_t points,
+                       KpmKernel kernel = KpmKernel::Jackson,
+                       double lambda = 4.0);
+
+#endif  // TIGHTB_KPM_H
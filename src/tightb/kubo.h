@@ -0,0 +1,209 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_KUBO_H
+#define TIGHTB_KUBO_H
+
+#include <tightb/assert.h>
+#include <tightb/kpm.h>
+#include <tightb/parallel.h>
+#include <tightb/random.h>
+#include <tightb/sparse.h>
+#include <tightb/vector.h>
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Velocity operator v_c = i [H, x_c] (hbar = 1) on the pattern of h: v_ij = i
+// d_c H_ij, with d = bond(i, j) the Cartesian vector from site i to site j.
+// Passing the minimum image as the bond keeps v right across periodic
+// boundaries, where position differences are not.
+template <typename T, typename F>
+SparseMatrix<std::complex<double>> velocity_operator(SparseMatrix<T> const& h,
+                                                     std::size_t direction,
+                                                     F&& bond) {
+  ASSERT(h.triangle() == Triangle::Full);
+  SparseMatrix<std::complex<double>> v(
+      h, [](T const& x) { return std::complex<double>(x); });
+  auto const& offsets = h.offsets();
+  auto const& columns = h.columns();
+  std::vector<std::complex<double>>& values = v.values();
+  parallel_for(h.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t i = begin; i < end; i++) {
+      for (std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+        std::size_t j = columns[k];
+        double d = j == i ? 0.0 : bond(i, j)[direction];
+        values[k] *= std::complex<double>(0.0, d);
+      }
+    }
+  });
+  return v;
+}
+
+// Same with bond(i, j) = positions[j] - positions[i], for open samples.
+template <typename T, std::size_t D>
+SparseMatrix<std::complex<double>> velocity_operator(
+    SparseMatrix<T> const& h, std::vector<Vec<double, D>> const& positions,
+    std::size_t direction) {
+  ASSERT(positions.size() == h.size() && direction < D);
+  return velocity_operator(h, direction, [&](std::size_t i, std::size_t j) {
+    return positions[j] - positions[i];
+  });
+}
+
+// Two-dimensional Chebyshev moments of the Kubo-Bastin formula,
+// mu[n * moments + m] = Tr[v_a T_n(H~) v_b T_m(H~)] / N, estimated from
+// `vectors` random-phase vectors (the same ones as kpm_moments()).
+//
+// With <L_n| = <r| v_a T_n and |R_m> = v_b T_m |r>, mu_nm = <L_n|R_m>, so the
+// left vectors are kept `tile` at a time and the right recursion is rerun
+// once per tile, fusing the product with v_b into the dot products against
+// the tile. That needs (tile + 5) N complex scalars in all instead of the
+// moments * N of storing every vector, for moments^2 / tile SpMVs per vector
+// in place of 3 moments, plus the moments^2 N dot products the result costs
+// anyway. The vectors are processed one after another; the SpMVs and the
+// products with the tile are split by rows across threads, so the footprint
+// does not grow with the thread count and every core works even for a single
+// vector.
+template <typename T>
+std::vector<std::complex<double>> kubo_moments(
+    SparseMatrix<T> const& h, SparseMatrix<std::complex<double>> const& va,
+    SparseMatrix<std::complex<double>> const& vb, ChebyshevScale const& scale,
+    std::size_t moments, std::size_t vectors, std::uint64_t seed,
+    std::size_t tile = 32) {
+  using complex = std::complex<double>;
+  ASSERT(h.triangle() == Triangle::Full);
+  ASSERT(va.size() == h.size() && vb.size() == h.size());
+  ASSERT(moments >= 2 && vectors > 0 && tile > 0);
+  std::size_t n = h.size();
+  tile = std::min(tile, moments);
+  double alpha = 1.0 / scale.half_width;
+  double beta = scale.center / scale.half_width;
+  Philox philox(seed);
+
+  std::vector<complex> mu(moments * moments, 0.0);
+  std::vector<complex> r(n);
+  std::vector<complex> left_old(n);
+  std::vector<complex> left(n);
+  std::vector<complex> right_old(n);
+  std::vector<complex> right(n);
+  std::vector<complex> block(n * tile);
+  std::vector<complex> dots(tile);
+  std::vector<std::vector<complex>> partial(max_threads());
+  auto const& offsets = vb.offsets();
+  auto const& columns = vb.columns();
+  auto const& values = vb.values();
+
+  // x <- T_index(H~) applied to the start vector, from x = T_index-1 and
+  // old = T_index-2; the result ends up in x.
+  auto advance = [&](std::size_t index, std::vector<complex>& x,
+                     std::vector<complex>& old) {
+    if (index == 0) return;
+    if (index == 1) {
+      detail::chebyshev_step<1>(h, 1, alpha, beta, false, x.data(), old.data(),
+                                nullptr);
+    } else {
+      detail::chebyshev_step<1>(h, 1, 2 * alpha, 2 * beta, true, x.data(),
+                                old.data(), nullptr);
+    }
+    x.swap(old);
+  };
+
+  for (std::size_t vector = 0; vector < vectors; vector++) {
+    parallel_for(n, [&](std::size_t begin, std::size_t end, std::size_t) {
+      detail::random_phases(philox, vector, begin, end, r.data(), 1);
+    });
+    // left = T_0 v_a |r>; the recursion carries on across tiles.
+    detail::chebyshev_step<1>(va, 1, 1.0, 0.0, false, r.data(), left.data(),
+                              nullptr);
+    for (std::size_t first = 0; first < moments; first += tile) {
+      std::size_t width = std::min(tile, moments - first);
+      for (std::size_t t = 0; t < width; t++) {
+        advance(first + t, left, left_old);
+        parallel_for(n, [&](std::size_t begin, std::size_t end, std::size_t) {
+          for (std::size_t i = begin; i < end; i++) {
+            block[i * width + t] = std::conj(left[i]);
+          }
+        });
+      }
+
+      std::copy(r.begin(), r.end(), right.begin());
+      for (std::size_t m = 0; m < moments; m++) {
+        advance(m, right, right_old);
+        // dots[t] = <L_first+t| v_b |T_m r>, one row of v_b at a time.
+        parallel_for(n, [&](std::size_t begin, std::size_t end,
+                            std::size_t thread) {
+          std::vector<complex>& d = partial[thread];
+          d.assign(width, 0.0);
+          complex* sum = d.data();
+          complex const* x = right.data();
+          complex const* tiles = block.data();
+          std::size_t const count = width;
+          for (std::size_t i = begin; i < end; i++) {
+            complex w = 0.0;
+            for (std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+              w += values[k] * x[columns[k]];
+            }
+            complex const* row = tiles + i * count;
+            for (std::size_t t = 0; t < count; t++) sum[t] += row[t] * w;
+          }
+        });
+        std::fill(dots.begin(), dots.begin() + width, complex(0.0));
+        for (auto& d : partial) {
+          for (std::size_t t = 0; t < d.size(); t++) dots[t] += d[t];
+          d.clear();
+        }
+        for (std::size_t t = 0; t < width; t++) {
+          mu[(first + t) * moments + m] += dots[t];
+        }
+      }
+    }
+  }
+  for (complex& x : mu) x /= static_cast<double>(n * vectors);
+  return mu;
+}
+
+// Conductivity sigma_ab(E_F) in units of e^2 / hbar from the moments of
+// kubo_moments(), by the Kubo-Bastin formula in the Chebyshev form of Garcia,
+// Covaci and Rappoport (PRL 114, 116602):
+//
+//   sigma_ab = 4 / (pi V hw^2) int dx f(x) / (1 - x^2)^2
+//              sum_nm Re[Gamma_nm(x) g_n g_m mu_nm] / ((1 + d_n0)(1 + d_m0))
+//
+// with hw the half width of the scale, V the volume (area, length) per
+// orbital and Gamma_nm(x) = (x - i n sqrt(1 - x^2)) e^{i n acos x} T_m(x) +
+// (x + i m sqrt(1 - x^2)) e^{-i m acos x} T_n(x). Covers longitudinal
+// (a = b) and Hall (a != b) responses, Fermi sea terms included. The
+// integrand is sampled on the `points` Chebyshev nodes, which stay clear of
+// the endpoints; the Fermi energies are the node energies, ascending, and
+// `temperature` (in energy units) smooths f. O(points moments^2), parallel
+// over the nodes.
+struct KuboConductivity {
+  std::vector<double> energy;
+  std::vector<double> sigma;
+};
+
+KuboConductivity kubo_bastin(std::vector<std::complex<double>> const& mu,
+                             std::size_t moments, ChebyshevScale const& scale,
+                             double volume, std::size_t points,
+                             double temperature = 0.0,
+                             KpmKernel kernel = KpmKernel::Jackson,
+                             double lambda = 4.0);
+
+#endif  // TIGHTB_KUBO_H
@@ -0,0 +1,163 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_LATTICE_H
+#define TIGHTB_LATTICE_H
+
+#include <tightb/assert.h>
+#include <tightb/matrix.h>
+#include <tightb/vector.h>
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Bravais lattice in D dimensions. The dimension is a template parameter so
+// every loop over components has a compile-time trip count.
+template <std::size_t D>
+class Lattice {
+ public:
+  // Row i of `vectors` is the primitive vector a_i.
+  explicit Lattice(Matrix<double, D, D> const& vectors);
+
+  [[nodiscard]] Matrix<double, D, D> const& vectors() const {
+    return vectors_;
+  }
+
+  // Row i is the reciprocal vector b_i, with a_i . b_j = 2 pi delta_ij.
+  // Computed once, at construction.
+  [[nodiscard]] Matrix<double, D, D> const& reciprocal() const {
+    return reciprocal_;
+  }
+
+  [[nodiscard]] Vec<double, D> vector(std::size_t i) const;
+
+  [[nodiscard]] Vec<double, D> reciprocal_vector(std::size_t i) const;
+
+  // Volume (area, length) of the primitive cell.
+  [[nodiscard]] double volume() const { return volume_; }
+
+  // sum_i f_i a_i.
+  [[nodiscard]] Vec<double, D> to_cartesian(Vec<double, D> const& f) const;
+
+  [[nodiscard]] Vec<double, D> to_fractional(Vec<double, D> const& r) const;
+
+  // sum_i k_i b_i, for k given in units of the reciprocal vectors.
+  [[nodiscard]] Vec<double, D> k_to_cartesian(Vec<double, D> const& k) const;
+
+ private:
+  Matrix<double, D, D> vectors_;
+  Matrix<double, D, D> reciprocal_;
+  Matrix<double, D, D> fractional_;
+  double volume_;
+};
+
+template <std::size_t D>
+Lattice<D>::Lattice(Matrix<double, D, D> const& vectors) : vectors_(vectors) {
+  double det = 0.0;
+  Matrix<double, D, D> inv = inverse(vectors, &det);
+  volume_ = std::abs(det);
+  fractional_ = inv.transpose();
+  reciprocal_ = 2.0 * M_PI * fractional_;
+}
+
+template <std::size_t D>
+Vec<double, D> Lattice<D>::vector(std::size_t i) const {
+  Vec<double, D> v{};
+  for (std::size_t d = 0; d < D; d++) v[d] = vectors_.at(i, d);
+  return v;
+}
+
+template <std::size_t D>
+Vec<double, D> Lattice<D>::reciprocal_vector(std::size_t i) const {
+  Vec<double, D> v{};
+  for (std::size_t d = 0; d < D; d++) v[d] = reciprocal_.at(i, d);
+  return v;
+}
+
+template <std::size_t D>
+Vec<double, D> Lattice<D>::to_cartesian(Vec<double, D> const& f) const {
+  return vectors_.transpose() * f;
+}
+
+template <std::size_t D>
+Vec<double, D> Lattice<D>::to_fractional(Vec<double, D> const& r) const {
+  return fractional_ * r;
+}
+
+template <std::size_t D>
+Vec<double, D> Lattice<D>::k_to_cartesian(Vec<double, D> const& k) const {
+  return reciprocal_.transpose() * k;
+}
+
+// Lattice plus a basis of sites, each carrying a number of orbitals. Orbitals
+// are numbered site by site, so site i owns orbitals
+// [orbital_offset(i), orbital_offset(i) + orbitals(i)).
+template <std::size_t D>
+class UnitCell {
+ public:
+  explicit UnitCell(Lattice<D> const& lattice) : lattice_(lattice) {}
+
+  // Adds a site at fractional coordinates `position` and returns its index.
+  std::size_t add_site(Vec<double, D> const& position,
+                       std::size_t orbitals = 1);
+
+  [[nodiscard]] Lattice<D> const& lattice() const { return lattice_; }
+
+  [[nodiscard]] std::size_t sites() const { return positions_.size(); }
+
+  [[nodiscard]] Vec<double, D> const& position(std::size_t i) const {
+    return positions_[i];
+  }
+
+  // Cartesian position of site i in the cell displaced by `cell`.
+  [[nodiscard]] Vec<double, D> cartesian(std::size_t i,
+                                         Vec<int, D> const& cell) const;
+
+  [[nodiscard]] std::size_t orbitals(std::size_t i) const {
+    return offsets_[i + 1] - offsets_[i];
+  }
+
+  [[nodiscard]] std::size_t orbital_offset(std::size_t i) const {
+    return offsets_[i];
+  }
+
+  [[nodiscard]] std::size_t orbitals() const { return offsets_.back(); }
+
+ private:
+  Lattice<D> lattice_;
+  std::vector<Vec<double, D>> positions_;
+  std::vector<std::size_t> offsets_{0};
+};
+
+template <std::size_t D>
+std::size_t UnitCell<D>::add_site(Vec<double, D> const& position,
+                                  std::size_t orbitals) {
+  ASSERT(orbitals > 0);
+  positions_.push_back(position);
+  offsets_.push_back(offsets_.back() + orbitals);
+  return positions_.size() - 1;
+}
+
+template <std::size_t D>
+Vec<double, D> UnitCell<D>::cartesian(std::size_t i,
+                                      Vec<int, D> const& cell) const {
+  Vec<double, D> f = positions_[i];
+  for (std::size_t d = 0; d < D; d++) f[d] += cell[d];
+  return lattice_.to_cartesian(f);
+}
+
+#endif  // TIGHTB_LATTICE_H
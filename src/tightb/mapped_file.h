@@ -0,0 +1,56 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_MAPPED_FILE_H
+#define TIGHTB_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. Pages are loaded by the kernel on
+// first access, so parsing straight from the mapping needs no copy and no
+// read buffer.
+class MappedFile {
+ public:
+  MappedFile() = default;
+
+  explicit MappedFile(std::string const& path);
+
+  MappedFile(MappedFile&& other) noexcept;
+
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  MappedFile(MappedFile const&) = delete;
+
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  ~MappedFile();
+
+  [[nodiscard]] char const* data() const { return data_; }
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+  [[nodiscard]] std::string_view view() const { return {data_, size_}; }
+
+ private:
+  void release();
+
+  char const* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+#endif  // TIGHTB_MAPPED_FILE_H
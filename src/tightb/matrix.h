@@ -18,8 +18,11 @@
 #define TIGHTB_MATRIX_H
 
 #include <tightb/assert.h>
+#include <tightb/vector.h>
 
 #include <array>
+#include <cmath>
+#include <utility>
 
 template <typename T, std::size_t H, std::size_t W>
 class Matrix {
@@ -52,6 +55,13 @@ class Matrix {
   template <typename U>
   Matrix<T, H, W> operator*(U p) const;
 
+  template <std::size_t K>
+  Matrix<T, H, K> operator*(Matrix<T, W, K> const& m) const;
+
+  Vec<T, H> operator*(Vec<T, W> const& v) const;
+
+  [[nodiscard]] Matrix<T, W, H> transpose() const;
+
   [[nodiscard]] std::size_t rows() const { return H; }
 
   [[nodiscard]] std::size_t cols() const { return W; }
@@ -124,9 +134,92 @@ Matrix<T, H, W> Matrix<T, H, W>::operator*(U p) const {
   return new_m;
 }
 
+template <typename T, std::size_t H, std::size_t W>
+template <std::size_t K>
+Matrix<T, H, K> Matrix<T, H, W>::operator*(const Matrix<T, W, K>& m) const {
+  Matrix<T, H, K> new_m{};
+  for (int i = 0; i < H; i++) {
+    for (int k = 0; k < W; k++) {
+      for (int j = 0; j < K; j++) {
+        new_m.at(i, j) += this->at(i, k) * m.at(k, j);
+      }
+    }
+  }
+  return new_m;
+}
+
+template <typename T, std::size_t H, std::size_t W>
+Vec<T, H> Matrix<T, H, W>::operator*(const Vec<T, W>& v) const {
+  Vec<T, H> new_v{};
+  for (int i = 0; i < H; i++) {
+    T sum{};
+    for (int j = 0; j < W; j++) {
+      sum += this->at(i, j) * v[j];
+    }
+    new_v[i] = sum;
+  }
+  return new_v;
+}
+
+template <typename T, std::size_t H, std::size_t W>
+Matrix<T, W, H> Matrix<T, H, W>::transpose() const {
+  Matrix<T, W, H> new_m{};
+  for (int i = 0; i < H; i++) {
+    for (int j = 0; j < W; j++) {
+      new_m.at(j, i) = this->at(i, j);
+    }
+  }
+  return new_m;
+}
+
 template <typename T, std::size_t H, std::size_t W, typename U>
 Matrix<T, H, W> operator*(U p, Matrix<T, H, W> m) {
   return m * p;
 }
 
+template <typename T, std::size_t N>
+Matrix<T, N, N> identity() {
+  Matrix<T, N, N> m{};
+  for (int i = 0; i < N; i++) m.at(i, i) = T{1};
+  return m;
+}
+
+// Gauss-Jordan elimination with partial pivoting. `det`, if given, receives
+// the determinant.
+template <typename T, std::size_t N>
+Matrix<T, N, N> inverse(Matrix<T, N, N> m, T* det = nullptr) {
+  Matrix<T, N, N> inv = identity<T, N>();
+  T d{1};
+  for (int c = 0; c < N; c++) {
+    int pivot = c;
+    for (int r = c + 1; r < N; r++) {
+      if (std::abs(m.at(r, c)) > std::abs(m.at(pivot, c))) pivot = r;
+    }
+    ASSERT(m.at(pivot, c) != T{}, "singular matrix");
+    if (pivot != c) {
+      for (int j = 0; j < N; j++) {
+        std::swap(m.at(c, j), m.at(pivot, j));
+        std::swap(inv.at(c, j), inv.at(pivot, j));
+      }
+      d = -d;
+    }
+    T p = m.at(c, c);
+    d *= p;
+    for (int j = 0; j < N; j++) {
+      m.at(c, j) /= p;
+      inv.at(c, j) /= p;
+    }
+    for (int r = 0; r < N; r++) {
+      if (r == c) continue;
+      T f = m.at(r, c);
+      for (int j = 0; j < N; j++) {
+        m.at(r, j) -= f * m.at(c, j);
+        inv.at(r, j) -= f * inv.at(c, j);
+      }
+    }
+  }
+  if (det != nullptr) *det = d;
+  return inv;
+}
+
 #endif  // TIGHTB_MATRIX_H
@@ -0,0 +1,109 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_MODEL_H
+#define TIGHTB_MODEL_H
+
+#include <tightb/assert.h>
+#include <tightb/hopping.h>
+#include <tightb/lattice.h>
+#include <tightb/matrix.h>
+#include <tightb/vector.h>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Periodic tight-binding model as described by a model file. The dimension is
+// only known at run time; unit_cell<D>() and hopping_table<D>() build the
+// typed objects once the caller has dispatched on it.
+//
+// The file is line oriented, with '#' starting a comment:
+//
+//   dimension 2
+//   lattice                     # followed by one line per vector a_i
+//   1.0 0.0
+//   0.5 0.8660254037844386
+//   site 0.3333333333 0.3333333333 1   # fractional position, orbitals
+//   site 0.6666666667 0.6666666667 1
+//   hoppings                    # every remaining line is one hopping
+//   0 0 0 1 -1.0 0.0            # R_1 .. R_D, a, b, Re t, [Im t]
+//
+// A hopping line adds t to <a, 0|H|b, R>, with a and b counted over all
+// orbitals of the cell starting at zero. As in Wannier90's hr.dat, both
+// directions of a bond are listed, so the file alone fixes the Hamiltonian.
+// The hopping list, which may run to millions of lines, is parsed in
+// parallel, one chunk of the file per thread.
+struct Model {
+  std::size_t dimension = 0;
+  std::vector<double> lattice;        // row-major, row i is a_i
+  std::vector<double> positions;      // row-major, one row per site
+  std::vector<std::size_t> orbitals;  // per site
+
+  // Hopping list in file order, one row of `dimension` cells per hopping.
+  std::vector<int> cells;
+  std::vector<std::size_t> from;
+  std::vector<std::size_t> to;
+  std::vector<double> re;
+  std::vector<double> im;
+
+  [[nodiscard]] std::size_t sites() const { return orbitals.size(); }
+
+  [[nodiscard]] std::size_t total_orbitals() const;
+
+  [[nodiscard]] std::size_t hoppings() const { return from.size(); }
+};
+
+// Malformed input is reported with its line number and aborts.
+Model parse_model(std::string_view text);
+
+// Parses the file through a read-only memory mapping.
+Model load_model(std::string const& path);
+
+template <std::size_t D>
+UnitCell<D> unit_cell(Model const& model) {
+  ASSERT(model.dimension == D);
+  Matrix<double, D, D> vectors{};
+  for (std::size_t i = 0; i < D; i++) {
+    for (std::size_t j = 0; j < D; j++) {
+      vectors.at(i, j) = model.lattice[i * D + j];
+    }
+  }
+  UnitCell<D> cell{Lattice<D>(vectors)};
+  for (std::size_t s = 0; s < model.sites(); s++) {
+    Vec<double, D> position{};
+    for (std::size_t d = 0; d < D; d++) {
+      position[d] = model.positions[s * D + d];
+    }
+    cell.add_site(position, model.orbitals[s]);
+  }
+  return cell;
+}
+
+template <std::size_t D>
+HoppingTable<D> hopping_table(Model const& model) {
+  ASSERT(model.dimension == D);
+  HoppingTable<D> table(model.total_orbitals());
+  Vec<int, D> cell{};
+  for (std::size_t h = 0; h < model.hoppings(); h++) {
+    for (std::size_t d = 0; d < D; d++) cell[d] = model.cells[h * D + d];
+    table.add(cell, model.from[h], model.to[h], {model.re[h], model.im[h]});
+  }
+  return table;
+}
+
+#endif  // TIGHTB_MODEL_H
@@ -0,0 +1,180 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_MODEL_CACHE_H
+#define TIGHTB_MODEL_CACHE_H
+
+#include <tightb/assert.h>
+#include <tightb/graph.h>
+#include <tightb/hopping.h>
+#include <tightb/lattice.h>
+#include <tightb/mapped_file.h>
+#include <tightb/matrix.h>
+#include <tightb/model.h>
+#include <tightb/supercell.h>
+#include <tightb/vector.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 64-bit cache key of a file's contents: FNV-1a over 64-bit words, computed
+// per 1 MiB block in parallel and then over the block hashes. Fast enough to
+// run on every startup; not meant to resist deliberate collisions.
+std::uint64_t content_hash(std::string_view bytes);
+
+// Compiled form of a Model. Everything is stored in 64-bit native words at
+// 8-byte aligned offsets, so the file is used in place through a memory
+// mapping and opening it only reads the header:
+//
+//   magic "TBMODEL", version, hash and size of the source file,
+//   dimension, sites, orbitals, translations, cell bonds, crossing bonds,
+//   lattice vectors, site positions, orbitals per site,
+//   translations R, Re t(R) and Im t(R) blocks as in HoppingTable,
+//   CSR graph of the orbitals coupled within the home cell,
+//   bonds to other cells as (from, to, R), each listed once.
+//
+// The graph and the bond list are what Supercell takes, so real-space
+// samples can be built without touching the hopping blocks.
+class ModelCache {
+ public:
+  static constexpr std::uint64_t kVersion = 1;
+
+  explicit ModelCache(MappedFile file);
+
+  explicit ModelCache(std::vector<char> bytes);
+
+  // Whether `bytes` hold a cache of this version compiled from a source with
+  // the given hash and size.
+  static bool matches(std::string_view bytes, std::uint64_t hash,
+                      std::uint64_t size);
+
+  [[nodiscard]] std::uint64_t source_hash() const { return header_[2]; }
+
+  [[nodiscard]] std::size_t dimension() const { return header_[4]; }
+
+  [[nodiscard]] std::size_t sites() const { return header_[5]; }
+
+  [[nodiscard]] std::size_t orbitals() const { return header_[6]; }
+
+  [[nodiscard]] std::size_t translations() const { return header_[7]; }
+
+  [[nodiscard]] std::size_t bonds() const { return header_[9]; }
+
+  [[nodiscard]] double const* lattice() const { return lattice_; }
+
+  [[nodiscard]] double const* positions() const { return positions_; }
+
+  [[nodiscard]] std::uint64_t const* site_orbitals() const {
+    return site_orbitals_;
+  }
+
+  [[nodiscard]] std::int64_t const* cells() const { return cells_; }
+
+  [[nodiscard]] double const* real() const { return re_; }
+
+  [[nodiscard]] double const* imag() const { return im_; }
+
+  // Orbitals coupled by R = 0 hoppings.
+  [[nodiscard]] Graph cell_graph() const;
+
+  // Bond b as (from, to, R_1 .. R_D).
+  [[nodiscard]] std::int64_t const* bond(std::size_t b) const {
+    return bonds_ + b * (2 + dimension());
+  }
+
+ private:
+  void index(std::string_view bytes);
+
+  MappedFile file_;
+  std::vector<char> bytes_;
+  std::uint64_t const* header_ = nullptr;
+  double const* lattice_ = nullptr;
+  double const* positions_ = nullptr;
+  std::uint64_t const* site_orbitals_ = nullptr;
+  std::int64_t const* cells_ = nullptr;
+  double const* re_ = nullptr;
+  double const* im_ = nullptr;
+  std::uint64_t const* offsets_ = nullptr;
+  std::uint64_t const* adjacency_ = nullptr;
+  std::int64_t const* bonds_ = nullptr;
+};
+
+std::vector<char> compile_model(Model const& model, std::uint64_t source_hash,
+                                std::uint64_t source_size);
+
+// Loads the model in `source` through its compiled cache at `cache`. A cache
+// that is missing, of another version or built from different contents is
+// rebuilt from the source and replaced atomically, so concurrent jobs never
+// see a partial file. If the cache cannot be written the compiled model is
+// still returned from memory.
+ModelCache load_cached_model(std::string const& source,
+                             std::string const& cache);
+
+template <std::size_t D>
+UnitCell<D> unit_cell(ModelCache const& cache) {
+  ASSERT(cache.dimension() == D);
+  Matrix<double, D, D> vectors{};
+  for (std::size_t i = 0; i < D; i++) {
+    for (std::size_t j = 0; j < D; j++) {
+      vectors.at(i, j) = cache.lattice()[i * D + j];
+    }
+  }
+  UnitCell<D> cell{Lattice<D>(vectors)};
+  for (std::size_t s = 0; s < cache.sites(); s++) {
+    Vec<double, D> position{};
+    for (std::size_t d = 0; d < D; d++) {
+      position[d] = cache.positions()[s * D + d];
+    }
+    cell.add_site(position, cache.site_orbitals()[s]);
+  }
+  return cell;
+}
+
+// Copies the blocks, one per translation, into a table.
+template <std::size_t D>
+HoppingTable<D> hopping_table(ModelCache const& cache) {
+  ASSERT(cache.dimension() == D);
+  std::size_t block = cache.orbitals() * cache.orbitals();
+  HoppingTable<D> table(cache.orbitals());
+  Vec<int, D> cell{};
+  for (std::size_t r = 0; r < cache.translations(); r++) {
+    for (std::size_t d = 0; d < D; d++) {
+      cell[d] = static_cast<int>(cache.cells()[r * D + d]);
+    }
+    table.add_block(cell, cache.real() + r * block, cache.imag() + r * block);
+  }
+  return table;
+}
+
+template <std::size_t D>
+std::vector<Bond<D>> cell_bonds(ModelCache const& cache) {
+  ASSERT(cache.dimension() == D);
+  std::vector<Bond<D>> bonds(cache.bonds());
+  for (std::size_t b = 0; b < cache.bonds(); b++) {
+    std::int64_t const* bond = cache.bond(b);
+    bonds[b].from = static_cast<std::size_t>(bond[0]);
+    bonds[b].to = static_cast<std::size_t>(bond[1]);
+    for (std::size_t d = 0; d < D; d++) {
+      bonds[b].cell[d] = static_cast<int>(bond[2 + d]);
+    }
+  }
+  return bonds;
+}
+
+#endif  // TIGHTB_MODEL_CACHE_H
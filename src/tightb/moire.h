@@ -0,0 +1,382 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_MOIRE_H
+#define TIGHTB_MOIRE_H
+
+#include <tightb/assert.h>
+#include <tightb/graph.h>
+#include <tightb/hopping.h>
+#include <tightb/lattice.h>
+#include <tightb/matrix.h>
+#include <tightb/parallel.h>
+#include <tightb/sparse.h>
+#include <tightb/vector.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Commensurate twist of a hexagonal lattice: rotating by `angle` (radians)
+// takes the lattice vector m a1 + n a2 to n a1 + m a2, and both layers share
+// the superlattice spanned by n a1 + m a2 and its 60 degree rotation, which
+// holds `cells` = m^2 + mn + n^2 unit cells of each layer.
+struct CommensurateAngle {
+  int m;
+  int n;
+  double angle;
+  std::size_t cells;
+};
+
+CommensurateAngle commensurate_angle(int m, int n);
+
+// Every primitive commensurate angle with 0 < m < n <= max_index, from the
+// largest angle to the smallest. Pairs with a common factor or with 3 | n - m
+// are left out: the formula above overcounts their cell.
+std::vector<CommensurateAngle> commensurate_angles(int max_index);
+
+// The commensurate angle closest to `degrees` among those with n <=
+// max_index.
+CommensurateAngle closest_commensurate(double degrees, int max_index);
+
+// Twisted bilayer of a hexagonal crystal in its commensurate supercell. Layer
+// 0 is the crystal as given and layer 1 the crystal rotated by the twist
+// angle, both in the plane. Orbital (layer * cells + p) * orbitals + a is
+// orbital a of the p-th unit cell of that layer inside the supercell.
+//
+// The intralayer hoppings come from the crystal's table, mapped through the
+// superlattice with integer arithmetic. Interlayer hoppings depend on the
+// in-plane displacement and are found with a spatial hash: the orbitals of
+// layer 1 are binned on a grid of the supercell with bins no smaller than
+// the cutoff, so each orbital of layer 0 only visits the 3 x 3 bins around
+// it. Both steps are linear in the number of orbitals and run in parallel.
+class MoireBilayer {
+ public:
+  // <from, cell 0| H |to, cell>, cell in superlattice units.
+  struct Hop {
+    std::size_t from;
+    std::size_t to;
+    std::size_t cell;  // index into cells()
+    std::complex<double> t;
+  };
+
+  // interlayer(d, a, b) is the hopping from orbital a of layer 0 to orbital b
+  // of layer 1 displaced by d (Cartesian, in the plane). It is only called
+  // for |d| <= cutoff, and zeros are dropped. The table must be Hermitian, as
+  // add_hermitian() keeps it.
+  template <typename F>
+  MoireBilayer(UnitCell<2> const& cell, HoppingTable<2> const& table,
+               CommensurateAngle const& twist, double cutoff, F&& interlayer);
+
+  [[nodiscard]] Lattice<2> const& lattice() const { return lattice_; }
+
+  [[nodiscard]] CommensurateAngle const& twist() const { return twist_; }
+
+  [[nodiscard]] std::size_t orbitals() const { return orbitals_; }
+
+  [[nodiscard]] std::size_t size() const { return 2 * cells_ * orbitals_; }
+
+  // Cartesian position of orbital i in supercell 0.
+  [[nodiscard]] Vec<double, 2> const& position(std::size_t i) const {
+    return positions_[i];
+  }
+
+  [[nodiscard]] std::vector<Vec<int, 2>> const& cells() const {
+    return translations_;
+  }
+
+  // Sorted by `from`; hops of orbital i are [first_hop(i), first_hop(i + 1)).
+  [[nodiscard]] std::vector<Hop> const& hops() const { return hops_; }
+
+  [[nodiscard]] std::size_t first_hop(std::size_t i) const {
+    return first_hop_[i];
+  }
+
+  // Orbitals coupled by any hopping, all supercells folded together.
+  [[nodiscard]] Graph graph() const;
+
+  // Fills h, built with the pattern of graph(), with H(k), k in units of the
+  // reciprocal superlattice vectors. Rows are filled in parallel.
+  void hamiltonian(Vec<double, 2> const& k,
+                   SparseMatrix<std::complex<double>>& h) const;
+
+  [[nodiscard]] SparseMatrix<std::complex<double>> hamiltonian(
+      Vec<double, 2> const& k) const;
+
+ private:
+  using Cell = std::array<long, 2>;
+
+  // Superlattice of one layer in its own fractional coordinates: columns
+  // of `vectors` are the superlattice vectors, `adjugate` / cells_ the
+  // inverse.
+  struct Layer {
+    std::array<std::array<long, 2>, 2> vectors;
+    std::array<std::array<long, 2>, 2> adjugate;
+    std::vector<Cell> points;
+    std::unordered_map<std::uint64_t, std::size_t> index;
+  };
+
+  static std::uint64_t key(Cell const& p) {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(p[0]))
+            << 32) |
+           static_cast<std::uint32_t>(p[1]);
+  }
+
+  static long floor_div(long a, long b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+  }
+
+  // Splits p into a point inside the supercell and the superlattice shift.
+  std::pair<Cell, Cell> wrap(Layer const& layer, Cell const& p) const;
+
+  void enumerate(Layer& layer) const;
+
+  std::size_t translation(Cell const& c);
+
+  template <typename F>
+  void connect(double cutoff, F& interlayer, std::vector<Hop>& hops);
+
+  CommensurateAngle twist_;
+  Lattice<2> lattice_;
+  std::size_t orbitals_;
+  std::size_t cells_;
+  std::array<Layer, 2> layers_;
+  std::vector<std::size_t> basis_of_;  // orbital -> site of the crystal cell
+  std::vector<Vec<double, 2>> positions_;
+  std::vector<Vec<int, 2>> translations_;
+  std::map<Cell, std::size_t> translation_index_;
+  std::vector<Hop> hops_;
+  std::vector<std::size_t> first_hop_;
+};
+
+namespace detail {
+
+// Counterclockwise rotation by `angle` radians.
+Matrix<double, 2, 2> rotation(double angle);
+
+// Superlattice of `twist` for the hexagonal lattice `lattice`: n a1 + m a2
+// and its 60 degree rotation.
+Lattice<2> moire_superlattice(Lattice<2> const& lattice,
+                              CommensurateAngle const& twist);
+
+}  // namespace detail
+
+template <typename F>
+MoireBilayer::MoireBilayer(UnitCell<2> const& cell,
+                           HoppingTable<2> const& table,
+                           CommensurateAngle const& twist, double cutoff,
+                           F&& interlayer)
+    : twist_(twist),
+      lattice_(detail::moire_superlattice(cell.lattice(), twist)),
+      orbitals_(table.orbitals()),
+      cells_(twist.cells) {
+  ASSERT(cell.orbitals() == table.orbitals());
+  Vec<double, 2> a1 = cell.lattice().vector(0);
+  Vec<double, 2> a2 = cell.lattice().vector(1);
+  double length = a1.dot(a1);
+  ASSERT(std::abs(a2.dot(a2) - length) < 1e-9 * length &&
+             std::abs(a1.dot(a2) - 0.5 * length) < 1e-9 * length,
+         "the lattice must be hexagonal with a 60 degree angle");
+
+  // Superlattice vectors L1 and L2 = R60 L1 in each layer's own basis, where
+  // R60 a1 = a2 and R60 a2 = a2 - a1.
+  long m = twist.m;
+  long n = twist.n;
+  layers_[0].vectors = {{{n, -m}, {m, n + m}}};
+  layers_[1].vectors = {{{m, -n}, {n, m + n}}};
+  for (auto& layer : layers_) {
+    auto const& v = layer.vectors;
+    layer.adjugate = {{{v[1][1], -v[0][1]}, {-v[1][0], v[0][0]}}};
+    ASSERT(v[0][0] * v[1][1] - v[0][1] * v[1][0] ==
+           static_cast<long>(cells_));
+    enumerate(layer);
+  }
+
+  // Sign of the rotation taking m a1 + n a2 to n a1 + m a2 = L1.
+  Vec<double, 2> v = a1 * static_cast<double>(m) + a2 * static_cast<double>(n);
+  Vec<double, 2> l1 = lattice_.vector(0);
+  double sign = v[0] * l1[1] - v[1] * l1[0] >= 0.0 ? 1.0 : -1.0;
+  std::array<Matrix<double, 2, 2>, 2> rotations = {
+      detail::rotation(0.0), detail::rotation(sign * twist.angle)};
+
+  basis_of_.resize(orbitals_);
+  for (std::size_t s = 0; s < cell.sites(); s++) {
+    for (std::size_t o = 0; o < cell.orbitals(s); o++) {
+      basis_of_[cell.orbital_offset(s) + o] = s;
+    }
+  }
+  positions_.resize(size());
+  for (std::size_t l = 0; l < 2; l++) {
+    for (std::size_t p = 0; p < cells_; p++) {
+      Cell const& point = layers_[l].points[p];
+      for (std::size_t a = 0; a < orbitals_; a++) {
+        Vec<double, 2> f = cell.position(basis_of_[a]);
+        f[0] += static_cast<double>(point[0]);
+        f[1] += static_cast<double>(point[1]);
+        positions_[(l * cells_ + p) * orbitals_ + a] =
+            rotations[l] * cell.lattice().to_cartesian(f);
+      }
+    }
+  }
+
+  // Intralayer hoppings: the nonzeros of the table, repeated over the points
+  // of each layer.
+  struct Entry {
+    Cell R;
+    std::size_t a;
+    std::size_t b;
+    std::complex<double> t;
+  };
+  std::vector<Entry> entries;
+  for (std::size_t r = 0; r < table.translations(); r++) {
+    Vec<int, 2> const& R = table.translation(r);
+    for (std::size_t a = 0; a < orbitals_; a++) {
+      for (std::size_t b = 0; b < orbitals_; b++) {
+        std::complex<double> t = table.at(r, a, b);
+        if (t != 0.0) entries.push_back({{R[0], R[1]}, a, b, t});
+      }
+    }
+  }
+  std::vector<Hop> hops;
+  hops.reserve(2 * cells_ * orbitals_ * (entries.size() / orbitals_ + 4));
+  for (std::size_t l = 0; l < 2; l++) {
+    Layer const& layer = layers_[l];
+    for (std::size_t p = 0; p < cells_; p++) {
+      for (auto const& entry : entries) {
+        Cell target = {layer.points[p][0] + entry.R[0],
+                       layer.points[p][1] + entry.R[1]};
+        auto [inside, shift] = wrap(layer, target);
+        std::size_t q = layer.index.at(key(inside));
+        hops.push_back({(l * cells_ + p) * orbitals_ + entry.a,
+                        (l * cells_ + q) * orbitals_ + entry.b,
+                        translation(shift), entry.t});
+      }
+    }
+  }
+  connect(cutoff, interlayer, hops);
+
+  // Counting sort by `from`.
+  first_hop_.assign(size() + 1, 0);
+  for (auto const& hop : hops) first_hop_[hop.from + 1]++;
+  for (std::size_t i = 0; i < size(); i++) first_hop_[i + 1] += first_hop_[i];
+  hops_.resize(hops.size());
+  std::vector<std::size_t> next(first_hop_.begin(), first_hop_.end() - 1);
+  for (auto const& hop : hops) hops_[next[hop.from]++] = hop;
+}
+
+template <typename F>
+void MoireBilayer::connect(double cutoff, F& interlayer,
+                           std::vector<Hop>& hops) {
+  ASSERT(cutoff > 0.0);
+  // Bins along each superlattice direction, as many as fit with a width of
+  // at least the cutoff. The width of the cell across L_d is area / |L_other|.
+  Matrix<double, 2, 2> const& L = lattice_.vectors();
+  std::array<long, 2> bins;
+  for (std::size_t d = 0; d < 2; d++) {
+    Vec<double, 2> other = lattice_.vector(1 - d);
+    double width = lattice_.volume() / std::sqrt(other.dot(other));
+    ASSERT(cutoff <= width, "interlayer cutoff larger than the supercell");
+    bins[d] = std::max(1L, static_cast<long>(width / cutoff));
+  }
+
+  // Orbitals wrapped into supercell 0, remembering the image they came from.
+  std::size_t half = cells_ * orbitals_;
+  std::vector<Vec<double, 2>> wrapped(size());
+  std::vector<Cell> image(size());
+  std::vector<Cell> bin_of(size());
+  for (std::size_t i = 0; i < size(); i++) {
+    Vec<double, 2> f = lattice_.to_fractional(positions_[i]);
+    for (std::size_t d = 0; d < 2; d++) {
+      double shift = std::floor(f[d]);
+      image[i][d] = static_cast<long>(shift);
+      f[d] -= shift;
+      bin_of[i][d] = std::min(bins[d] - 1, static_cast<long>(f[d] * bins[d]));
+    }
+    wrapped[i] = lattice_.to_cartesian(f);
+  }
+
+  // Layer 1 orbitals sorted by bin.
+  std::vector<std::size_t> first(bins[0] * bins[1] + 1, 0);
+  for (std::size_t j = half; j < size(); j++) {
+    first[bin_of[j][0] * bins[1] + bin_of[j][1] + 1]++;
+  }
+  for (std::size_t b = 0; b + 1 < first.size(); b++) first[b + 1] += first[b];
+  std::vector<std::size_t> binned(half);
+  {
+    std::vector<std::size_t> next(first.begin(), first.end() - 1);
+    for (std::size_t j = half; j < size(); j++) {
+      binned[next[bin_of[j][0] * bins[1] + bin_of[j][1]]++] = j;
+    }
+  }
+
+  struct Found {
+    std::size_t from;
+    std::size_t to;
+    Cell cell;
+    std::complex<double> t;
+  };
+  std::vector<std::vector<Found>> found(max_threads());
+  double cutoff2 = cutoff * cutoff;
+  parallel_for(
+      half,
+      [&](std::size_t begin, std::size_t end, std::size_t thread) {
+        for (std::size_t i = begin; i < end; i++) {
+          for (long o0 = -1; o0 <= 1; o0++) {
+            for (long o1 = -1; o1 <= 1; o1++) {
+              long b0 = bin_of[i][0] + o0;
+              long b1 = bin_of[i][1] + o1;
+              Cell w = {floor_div(b0, bins[0]), floor_div(b1, bins[1])};
+              b0 -= w[0] * bins[0];
+              b1 -= w[1] * bins[1];
+              Vec<double, 2> offset{
+                  L.at(0, 0) * w[0] + L.at(1, 0) * w[1],
+                  L.at(0, 1) * w[0] + L.at(1, 1) * w[1]};
+              std::size_t b = b0 * bins[1] + b1;
+              for (std::size_t x = first[b]; x < first[b + 1]; x++) {
+                std::size_t j = binned[x];
+                Vec<double, 2> d = wrapped[j] + offset - wrapped[i];
+                if (d.dot(d) > cutoff2) continue;
+                std::complex<double> t =
+                    interlayer(static_cast<Vec<double, 2> const&>(d),
+                               i % orbitals_, j % orbitals_);
+                if (t == 0.0) continue;
+                Cell c = {w[0] - image[j][0] + image[i][0],
+                          w[1] - image[j][1] + image[i][1]};
+                found[thread].push_back({i, j, c, t});
+              }
+            }
+          }
+        }
+      },
+      256);
+
+  for (auto const& list : found) {
+    for (auto const& f : list) {
+      hops.push_back({f.from, f.to, translation(f.cell), f.t});
+      hops.push_back({f.to, f.from, translation({-f.cell[0], -f.cell[1]}),
+                      std::conj(f.t)});
+    }
+  }
+}
+
+#endif  // TIGHTB_MOIRE_H
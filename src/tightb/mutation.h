@@ -0,0 +1,149 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_MUTATION_H
+#define TIGHTB_MUTATION_H
+
+#include <tightb/assert.h>
+#include <tightb/graph.h>
+#include <tightb/scalar.h>
+#include <tightb/sparse.h>
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// A batch of structural edits. Removals are applied before insertions.
+struct GraphEdits {
+  std::vector<std::size_t> removed_sites;
+  std::vector<std::pair<std::size_t, std::size_t>> removed_bonds;
+
+  // Reinserts a removed site, or appends a new one when the id equals the
+  // current number of sites. New sites start without bonds.
+  std::vector<std::size_t> inserted_sites;
+  std::vector<std::pair<std::size_t, std::size_t>> inserted_bonds;
+};
+
+// Graph that supports cheap batched edits. Every row keeps some spare capacity
+// so bonds can be inserted in place; a row that overflows is moved to the end
+// of the adjacency array and its old slots become garbage. Removed sites stay
+// as tombstones, keeping every other site id (and therefore every Hamiltonian
+// index) stable, until compact() squeezes them out.
+class MutableGraph {
+ public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  explicit MutableGraph(Graph const& graph, std::size_t slack = 2);
+
+  void apply(GraphEdits const& edits);
+
+  [[nodiscard]] std::size_t size() const { return alive_.size(); }
+
+  [[nodiscard]] bool alive(std::size_t v) const { return alive_[v]; }
+
+  [[nodiscard]] std::size_t dead_sites() const { return dead_; }
+
+  [[nodiscard]] std::size_t degree(std::size_t v) const { return count_[v]; }
+
+  // Neighbors of v, in no particular order.
+  [[nodiscard]] Graph::Neighbors neighbors(std::size_t v) const {
+    return {adjacency_.data() + begin_[v],
+            adjacency_.data() + begin_[v] + count_[v]};
+  }
+
+  [[nodiscard]] bool has_bond(std::size_t u, std::size_t v) const;
+
+  // Fraction of storage held by tombstones and abandoned rows. Callers that
+  // run many batches compact() once this grows past what they tolerate.
+  [[nodiscard]] double garbage() const;
+
+  // Snapshot with the current site ids; removed sites appear without bonds.
+  [[nodiscard]] Graph graph() const;
+
+  // Drops removed sites, renumbering the survivors in order, and repacks the
+  // rows. Returns the new id of every old site (npos for removed ones).
+  std::vector<std::size_t> compact();
+
+ private:
+  void insert_bond(std::size_t u, std::size_t v);
+
+  void erase_bond(std::size_t u, std::size_t v);
+
+  std::size_t slack_;
+  std::size_t dead_ = 0;
+  std::size_t wasted_ = 0;
+  std::vector<std::size_t> begin_;
+  std::vector<std::size_t> count_;
+  std::vector<std::size_t> capacity_;
+  std::vector<char> alive_;
+  std::vector<std::size_t> adjacency_;
+};
+
+// Propagates edits to a Hamiltonian with full storage assembled on the
+// pattern of the graph before the edits. Removed bonds and sites are zeroed in
+// place, leaving their slots as tombstones; those without a slot (added to the
+// graph after h was assembled) hold nothing and are skipped. Inserted bonds
+// and sites take hopping(i, j) = H_ij (and hopping(v, v) on the diagonal) if
+// their slot is in the pattern, which is the case when they were removed
+// earlier or when the Hamiltonian was assembled on a graph that already holds
+// every candidate site and bond. h never grows: for adatoms, assemble it once
+// on a graph that includes every candidate adatom site and bond, and remove
+// the ones absent from the starting configuration. Returns false, leaving `h`
+// untouched, when some insertion needs a new slot; the caller then has to
+// assemble again on MutableGraph::graph().
+template <typename T, typename F>
+bool apply_edits(SparseMatrix<T>& h, GraphEdits const& edits, F&& hopping) {
+  ASSERT(h.triangle() == Triangle::Full);
+  std::size_t n = h.size();
+  auto slot = [&](std::size_t i, std::size_t j) {
+    return i < n && j < n ? h.find(i, j) : h.npos;
+  };
+  for (std::size_t v : edits.inserted_sites) {
+    if (v >= n) return false;
+  }
+  for (auto const& [i, j] : edits.inserted_bonds) {
+    if (slot(i, j) == h.npos || slot(j, i) == h.npos) return false;
+  }
+
+  std::vector<T>& values = h.values();
+  auto const& offsets = h.offsets();
+  auto const& columns = h.columns();
+  for (auto const& [i, j] : edits.removed_bonds) {
+    for (std::size_t k : {slot(i, j), slot(j, i)}) {
+      if (k != h.npos) values[k] = T{};
+    }
+  }
+  for (std::size_t v : edits.removed_sites) {
+    if (v >= n) continue;
+    for (std::size_t k = offsets[v]; k < offsets[v + 1]; k++) {
+      values[k] = T{};
+      std::size_t mirror = h.find(columns[k], v);
+      if (mirror != h.npos) values[mirror] = T{};
+    }
+  }
+  for (std::size_t v : edits.inserted_sites) {
+    values[h.find(v, v)] = hopping(v, v);
+  }
+  for (auto const& [i, j] : edits.inserted_bonds) {
+    T t = hopping(i, j);
+    values[h.find(i, j)] = t;
+    values[h.find(j, i)] = conjugate(t);
+  }
+  return true;
+}
+
+#endif  // TIGHTB_MUTATION_H
@@ -0,0 +1,53 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_ORBITALS_H
+#define TIGHTB_ORBITALS_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Largest orbital count with a dedicated instantiation of the block kernels.
+inline constexpr std::size_t kMaxFixedOrbitals = 16;
+
+namespace detail {
+
+template <typename F, std::size_t... N>
+decltype(auto) dispatch_orbitals(std::size_t n, F& f,
+                                 std::index_sequence<N...>) {
+  using Result = decltype(f(std::integral_constant<std::size_t, 0>{}));
+  using Entry = Result (*)(F&);
+  static constexpr Entry table[] = {[](F& g) -> Result {
+    return g(std::integral_constant<std::size_t, N>{});
+  }...};
+  return table[n < sizeof...(N) ? n : 0](f);
+}
+
+}  // namespace detail
+
+// Turns a run-time orbital count into a compile-time one: calls
+// f(std::integral_constant<std::size_t, n>{}) through a table of
+// instantiations for n = 1 .. kMaxFixedOrbitals, and f with N = 0, the
+// generic path that reads the count at run time, for anything else. Kernels
+// written against a constant N get fully unrolled block loops.
+template <typename F>
+decltype(auto) dispatch_orbitals(std::size_t n, F&& f) {
+  return detail::dispatch_orbitals(
+      n, f, std::make_index_sequence<kMaxFixedOrbitals + 1>());
+}
+
+#endif  // TIGHTB_ORBITALS_H
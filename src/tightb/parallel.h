@@ -0,0 +1,52 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_PARALLEL_H
+#define TIGHTB_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// Upper bound on the number of threads used by the parallel kernels. Defaults
+// to the hardware concurrency.
+std::size_t max_threads();
+
+void set_max_threads(std::size_t threads);
+
+// Runs task(thread) for thread = 0 .. threads - 1 concurrently, the calling
+// thread taking index 0, and returns once all of them have finished.
+void parallel_run(std::size_t threads,
+                  std::function<void(std::size_t)> const& task);
+
+// Splits [0, count) into contiguous blocks, one per thread, and calls
+// f(begin, end, thread) for each of them. Blocks smaller than `grain` are not
+// worth a thread, so short loops run on the calling thread.
+template <typename F>
+void parallel_for(std::size_t count, F&& f, std::size_t grain = 1024) {
+  std::size_t threads = max_threads();
+  if (grain > 0 && count / grain < threads) threads = count / grain;
+  if (threads <= 1) {
+    if (count > 0) f(std::size_t{0}, count, std::size_t{0});
+    return;
+  }
+  parallel_run(threads, [&](std::size_t thread) {
+    std::size_t begin = count * thread / threads;
+    std::size_t end = count * (thread + 1) / threads;
+    if (begin < end) f(begin, end, thread);
+  });
+}
+
+#endif  // TIGHTB_PARALLEL_H
@@ -0,0 +1,53 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_PARTITION_H
+#define TIGHTB_PARTITION_H
+
+#include <tightb/graph.h>
+
+#include <cstddef>
+#include <vector>
+
+struct Partition {
+  // Part owning each vertex.
+  std::vector<std::size_t> part;
+
+  // Number of bonds whose endpoints live in different parts.
+  std::size_t edge_cut = 0;
+
+  // Vertices owned by part p that have a neighbor in another part, i.e. the
+  // values p has to send during a halo exchange. Sorted.
+  std::vector<std::vector<std::size_t>> boundary;
+
+  // Vertices owned by other parts that part p reads, i.e. its ghost layer.
+  // Sorted.
+  std::vector<std::vector<std::size_t>> ghosts;
+
+  [[nodiscard]] std::size_t parts() const { return boundary.size(); }
+};
+
+// Splits the graph into `parts` pieces of (nearly) equal size while keeping
+// the number of cut bonds small. Uses multilevel recursive bisection: the
+// graph is coarsened by heavy-edge matching, the coarsest graph is bisected by
+// greedy region growing, and the bisection is refined with Fiduccia-Mattheyses
+// passes while it is projected back to the original graph. Every part holds at
+// most (1 + imbalance) times its share of vertices, up to the rounding of a
+// single vertex.
+Partition partition(Graph const& graph, std::size_t parts,
+                    double imbalance = 0.03);
+
+#endif  // TIGHTB_PARTITION_H
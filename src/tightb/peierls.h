@@ -0,0 +1,202 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_PEIERLS_H
+#define TIGHTB_PEIERLS_H
+
+#include <tightb/assert.h>
+#include <tightb/hopping.h>
+#include <tightb/lattice.h>
+#include <tightb/matrix.h>
+#include <tightb/parallel.h>
+#include <tightb/sparse.h>
+#include <tightb/vector.h>
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+// Gauge of a uniform field B along z. Fluxes are in units of the flux
+// quantum, so a hopping from r_i to r_j picks up e^{2 pi i int A.dl}.
+enum class Gauge {
+  Landau,     // A = B (0, x): translation invariant along y
+  Symmetric,  // A = B (-y, x) / 2: rotation invariant about the origin
+};
+
+// Multiplies every stored H_ij of h by the Peierls phase of the straight
+// path from positions[i] to positions[j] (Cartesian; only x and y are used)
+// in a field of `field` flux quanta per unit area. The pattern of h, i.e. the
+// bonds of its Graph, supplies the geometry, so this works for any open or
+// finite sample built on real-space positions, such as flakes or Supercell
+// graphs with every direction open. A bond that wraps a periodic boundary, or
+// a slab hop folded onto in-cell positions, would get the phase of the
+// straight path across the sample instead; use MagneticCell for periodic
+// models. The phases are antisymmetric, so h stays Hermitian.
+template <std::size_t D>
+void apply_peierls(SparseMatrix<std::complex<double>>& h,
+                   std::vector<Vec<double, D>> const& positions, double field,
+                   Gauge gauge) {
+  static_assert(D >= 2, "a field along z needs x and y");
+  ASSERT(positions.size() == h.size());
+  auto const& offsets = h.offsets();
+  auto const& columns = h.columns();
+  std::vector<std::complex<double>>& values = h.values();
+  parallel_for(h.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t i = begin; i < end; i++) {
+      Vec<double, D> const& a = positions[i];
+      for (std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+        Vec<double, D> const& b = positions[columns[k]];
+        double flux = gauge == Gauge::Landau
+                          ? 0.5 * (a[0] + b[0]) * (b[1] - a[1])
+                          : 0.5 * (a[0] * b[1] - a[1] * b[0]);
+        values[k] *= std::polar(1.0, 2.0 * M_PI * field * flux);
+      }
+    }
+  });
+}
+
+// Magnetic unit cell of a periodic model threaded by p/q flux quanta per
+// (a1, a2) plaquette. The field is taken in the Landau gauge A = phi (0, u)
+// of the fractional coordinates (u, v), so the phases are periodic along a2
+// and repeat along a1 after q cells up to the gauge transformation
+// e^{-2 pi i p v}. Folding that transformation into the magnetic translation
+// makes q x 1 cells, the smallest possible, a unit cell, and the result is an
+// ordinary UnitCell and HoppingTable: H(k) comes from BlochHamiltonian and
+// every tool built on it. Copy c of orbital a is orbital c * orbitals + a.
+template <std::size_t D>
+class MagneticCell {
+  static_assert(D >= 2, "flux threads the plane of a1 and a2");
+
+ public:
+  MagneticCell(UnitCell<D> const& cell, HoppingTable<D> const& table, long p,
+               long q);
+
+  // Flux per original cell, p / q in lowest terms with q > 0.
+  [[nodiscard]] long p() const { return p_; }
+
+  [[nodiscard]] long q() const { return q_; }
+
+  [[nodiscard]] UnitCell<D> const& cell() const { return cell_; }
+
+  [[nodiscard]] HoppingTable<D> const& table() const { return table_; }
+
+ private:
+  // q itself, asserted nonzero before any initializer divides by it.
+  static long denominator(long q);
+
+  static UnitCell<D> enlarge(UnitCell<D> const& cell, long q);
+
+  long p_;
+  long q_;
+  UnitCell<D> cell_;
+  HoppingTable<D> table_;
+};
+
+template <std::size_t D>
+long MagneticCell<D>::denominator(long q) {
+  ASSERT(q != 0, "flux with a zero denominator");
+  return q;
+}
+
+template <std::size_t D>
+UnitCell<D> MagneticCell<D>::enlarge(UnitCell<D> const& cell, long q) {
+  Matrix<double, D, D> vectors = cell.lattice().vectors();
+  for (std::size_t d = 0; d < D; d++) vectors.at(0, d) *= q;
+  UnitCell<D> magnetic{Lattice<D>(vectors)};
+  for (long c = 0; c < q; c++) {
+    for (std::size_t s = 0; s < cell.sites(); s++) {
+      Vec<double, D> f = cell.position(s);
+      f[0] = (f[0] + c) / q;
+      magnetic.add_site(f, cell.orbitals(s));
+    }
+  }
+  return magnetic;
+}
+
+namespace detail {
+
+// Calls f(c, a, copy, b, cell, t) for every hopping of the magnetic cell of
+// flux p/q: from orbital a of copy c in magnetic cell 0 to orbital b of copy
+// `copy` in magnetic cell `cell`, with amplitude t including the Peierls
+// phase. `position` holds the fractional position of every orbital of the
+// original cell.
+template <std::size_t D, typename F>
+void magnetic_hops(std::vector<Vec<double, D>> const& position,
+                   HoppingTable<D> const& table, long p, long q, F&& f) {
+  std::size_t n = table.orbitals();
+  double flux = static_cast<double>(p) / static_cast<double>(q);
+  for (std::size_t r = 0; r < table.translations(); r++) {
+    Vec<int, D> const& R = table.translation(r);
+    for (long c = 0; c < q; c++) {
+      // The target cell c + R[0] along a1 is copy `copy` of magnetic cell M.
+      long shifted = c + R[0];
+      long M = shifted >= 0 ? shifted / q : -((-shifted + q - 1) / q);
+      long copy = shifted - M * q;
+      Vec<int, D> cell = R;
+      cell[0] = static_cast<int>(M);
+      for (std::size_t a = 0; a < n; a++) {
+        for (std::size_t b = 0; b < n; b++) {
+          std::complex<double> t = table.at(r, a, b);
+          if (t == 0.0) continue;
+          double u = 0.5 * (2.0 * c + R[0] + position[a][0] + position[b][0]);
+          double dv = R[1] + position[b][1] - position[a][1];
+          // int A.dl over the bond, then the magnetic translation of the
+          // target back by M magnetic cells.
+          double phase =
+              flux * u * dv - static_cast<double>(p * M) * position[b][1];
+          f(static_cast<std::size_t>(c), a, static_cast<std::size_t>(copy), b,
+            static_cast<Vec<int, D> const&>(cell),
+            t * std::polar(1.0, 2.0 * M_PI * phase));
+        }
+      }
+    }
+  }
+}
+
+// Fractional position of every orbital of `cell`.
+template <std::size_t D>
+std::vector<Vec<double, D>> orbital_positions(UnitCell<D> const& cell) {
+  std::vector<Vec<double, D>> position(cell.orbitals());
+  for (std::size_t s = 0; s < cell.sites(); s++) {
+    for (std::size_t o = 0; o < cell.orbitals(s); o++) {
+      position[cell.orbital_offset(s) + o] = cell.position(s);
+    }
+  }
+  return position;
+}
+
+}  // namespace detail
+
+template <std::size_t D>
+MagneticCell<D>::MagneticCell(UnitCell<D> const& cell,
+                              HoppingTable<D> const& table, long p, long q)
+    : p_(p / std::gcd(p, denominator(q)) * (q < 0 ? -1 : 1)),
+      q_(std::abs(q) / std::gcd(p, q)),
+      cell_(enlarge(cell, q_)),
+      table_(table.orbitals() * q_) {
+  ASSERT(cell.orbitals() == table.orbitals());
+  std::size_t n = table.orbitals();
+  detail::magnetic_hops(
+      detail::orbital_positions(cell), table, p_, q_,
+      [&](std::size_t c, std::size_t a, std::size_t copy, std::size_t b,
+          Vec<int, D> const& cell, std::complex<double> t) {
+        table_.add(cell, c * n + a, copy * n + b, t);
+      });
+}
+
+#endif  // TIGHTB_PEIERLS_H
@@ -0,0 +1,128 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_RANDOM_H
+#define TIGHTB_RANDOM_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Philox4x32-10 counter-based generator (Salmon et al., SC'11). The output is
+// a pure function of a 64-bit key and a 128-bit counter, so the n-th number of
+// any stream can be computed directly: streams keyed by realization and
+// indexed by position need no shared state and give the same numbers for any
+// split of the work between threads.
+class Philox {
+ public:
+  using Block = std::array<std::uint32_t, 4>;
+
+  explicit Philox(std::uint64_t key)
+      : key_{static_cast<std::uint32_t>(key),
+             static_cast<std::uint32_t>(key >> 32)} {}
+
+  [[nodiscard]] Block operator()(Block counter) const {
+    std::uint32_t k0 = key_[0];
+    std::uint32_t k1 = key_[1];
+    for (int round = 0; round < 10; round++) {
+      std::uint64_t p0 = std::uint64_t{0xD2511F53} * counter[0];
+      std::uint64_t p1 = std::uint64_t{0xCD9E8D57} * counter[2];
+      counter = {static_cast<std::uint32_t>(p1 >> 32) ^ counter[1] ^ k0,
+                 static_cast<std::uint32_t>(p1),
+                 static_cast<std::uint32_t>(p0 >> 32) ^ counter[3] ^ k1,
+                 static_cast<std::uint32_t>(p0)};
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+    return counter;
+  }
+
+  // Block for position `index` of stream `stream`.
+  [[nodiscard]] Block operator()(std::uint64_t stream,
+                                 std::uint64_t index) const {
+    return (*this)({static_cast<std::uint32_t>(index),
+                    static_cast<std::uint32_t>(index >> 32),
+                    static_cast<std::uint32_t>(stream),
+                    static_cast<std::uint32_t>(stream >> 32)});
+  }
+
+  // Uniform double in [0, 1) with 53 random bits, from the first two words
+  // of a block.
+  [[nodiscard]] static double uniform(Block const& block) {
+    std::uint64_t bits =
+        (static_cast<std::uint64_t>(block[0]) << 32 | block[1]) >> 11;
+    return static_cast<double>(bits) * 0x1.0p-53;
+  }
+
+  [[nodiscard]] double uniform(std::uint64_t stream,
+                               std::uint64_t index) const {
+    return uniform((*this)(stream, index));
+  }
+
+ private:
+  std::array<std::uint32_t, 2> key_;
+};
+
+// Sequential view of one Philox stream, usable wherever a standard uniform
+// random bit generator is expected. Jumping to any position is free.
+class RandomStream {
+ public:
+  using result_type = std::uint32_t;
+
+  RandomStream(std::uint64_t seed, std::uint64_t stream,
+               std::uint64_t position = 0)
+      : philox_(seed), stream_(stream), index_(position) {}
+
+  static constexpr result_type min() { return 0; }
+
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() {
+    if (used_ == 4) {
+      block_ = philox_(stream_, index_++);
+      used_ = 0;
+    }
+    return block_[used_++];
+  }
+
+  // Uniform in [0, 1); each call consumes a fresh block.
+  double uniform() {
+    used_ = 4;
+    return philox_.uniform(stream_, index_++);
+  }
+
+  // Standard normal deviate by Box-Muller on one block.
+  double normal() {
+    used_ = 4;
+    Philox::Block block = philox_(stream_, index_++);
+    double u = 1.0 - Philox::uniform(block);  // (0, 1]
+    double v = Philox::uniform({block[2], block[3], 0, 0});
+    return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * M_PI * v);
+  }
+
+ private:
+  Philox philox_;
+  std::uint64_t stream_;
+  std::uint64_t index_;
+  Philox::Block block_{};
+  std::size_t used_ = 4;
+};
+
+#endif  // TIGHTB_RANDOM_H
@@ -0,0 +1,360 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_SLAB_H
+#define TIGHTB_SLAB_H
+
+#include <tightb/assert.h>
+#include <tightb/graph.h>
+#include <tightb/hopping.h>
+#include <tightb/lattice.h>
+#include <tightb/matrix.h>
+#include <tightb/parallel.h>
+#include <tightb/sparse.h>
+#include <tightb/vector.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+// Unimodular basis adapted to the lattice planes with Miller indices h: the
+// columns of the result, in fractional coordinates of the old basis, are
+// D - 1 lattice vectors spanning the plane (h . u = 0) followed by one
+// stacking vector with h . u = 1. The indices must be coprime.
+template <std::size_t D>
+Matrix<int, D, D> plane_basis(Vec<int, D> const& miller) {
+  Matrix<int, D, D> u{};
+  for (std::size_t d = 0; d < D; d++) u.at(d, d) = 1;
+  std::array<long, D> v;
+  for (std::size_t d = 0; d < D; d++) v[d] = miller[d];
+
+  // Euclid on the entries of h, mirrored by column operations on u, until a
+  // single entry, the gcd, is left.
+  while (true) {
+    std::size_t pivot = D;
+    std::size_t nonzero = 0;
+    for (std::size_t d = 0; d < D; d++) {
+      if (v[d] == 0) continue;
+      nonzero++;
+      if (pivot == D || std::abs(v[d]) < std::abs(v[pivot])) pivot = d;
+    }
+    ASSERT(nonzero > 0, "Miller indices must not all vanish");
+    if (nonzero == 1) {
+      for (std::size_t r = 0; r < D; r++) {
+        std::swap(u.at(r, pivot), u.at(r, D - 1));
+      }
+      std::swap(v[pivot], v[D - 1]);
+      break;
+    }
+    for (std::size_t d = 0; d < D; d++) {
+      if (d == pivot || v[d] == 0) continue;
+      long q = v[d] / v[pivot];
+      v[d] -= q * v[pivot];
+      for (std::size_t r = 0; r < D; r++) {
+        u.at(r, d) -= static_cast<int>(q) * u.at(r, pivot);
+      }
+    }
+  }
+  if (v[D - 1] < 0) {
+    v[D - 1] = -v[D - 1];
+    for (std::size_t r = 0; r < D; r++) u.at(r, D - 1) = -u.at(r, D - 1);
+  }
+  ASSERT(v[D - 1] == 1, "Miller indices must be coprime");
+  return u;
+}
+
+// Crystal cut into a slab (ribbon in 2D) of `width` layers stacked along the
+// Miller direction, open in that direction and periodic in the others.
+// Slab orbital l * orbitals + a is orbital a of layer l, so H(k_par) is
+// block banded; grouping principal_layer() consecutive layers makes it block
+// tridiagonal. The hoppings are kept per layer, not per slab, so building
+// the graph and assembling H(k_par) are linear in the width.
+template <std::size_t D>
+class Slab {
+  static_assert(D >= 2, "a slab needs at least one periodic direction");
+
+ public:
+  // A hopping of the layer hamiltonian: <from, layer l, cell 0| H |to, layer
+  // l + layer, cell>.
+  struct Hop {
+    std::size_t from;
+    std::size_t to;
+    Vec<int, D - 1> cell;
+    int layer;
+    std::complex<double> t;
+  };
+
+  Slab(UnitCell<D> const& cell, HoppingTable<D> const& table,
+       Vec<int, D> const& miller, std::size_t width);
+
+  // Columns: the new basis in fractional coordinates of the crystal.
+  [[nodiscard]] Matrix<int, D, D> const& basis() const { return basis_; }
+
+  // In-plane lattice, in a frame of its own.
+  [[nodiscard]] Lattice<D - 1> const& lattice() const { return lattice_; }
+
+  [[nodiscard]] std::size_t width() const { return width_; }
+
+  [[nodiscard]] std::size_t orbitals() const { return orbitals_; }
+
+  [[nodiscard]] std::size_t size() const { return width_ * orbitals_; }
+
+  [[nodiscard]] std::vector<Hop> const& hops() const { return hops_; }
+
+  // Largest number of layers a hopping crosses.
+  [[nodiscard]] std::size_t principal_layer() const { return reach_; }
+
+  // Cartesian position, in the crystal frame, of slab orbital i in cell 0.
+  [[nodiscard]] Vec<double, D> position(std::size_t i) const;
+
+  void add_onsite(std::size_t i, double energy) { onsite_[i] += energy; }
+
+  // Adds `energy` times the number of hoppings cut by the surfaces to every
+  // orbital, e.g. to push dangling-bond states out of the gap the way
+  // hydrogen passivation does.
+  void passivate(double energy);
+
+  // Orbitals coupled by any hopping, all parallel cells folded together.
+  [[nodiscard]] Graph graph() const;
+
+  // Fills h, built with the pattern of graph(), with H(k_par); k_par is in
+  // units of the in-plane reciprocal vectors. The layers are independent rows
+  // and are filled in parallel.
+  void hamiltonian(Vec<double, D - 1> const& k,
+                   SparseMatrix<std::complex<double>>& h) const;
+
+  [[nodiscard]] SparseMatrix<std::complex<double>> hamiltonian(
+      Vec<double, D - 1> const& k) const;
+
+ private:
+  Matrix<int, D, D> basis_;
+  Lattice<D - 1> lattice_;
+  std::size_t width_;
+  std::size_t orbitals_;
+  std::size_t reach_ = 0;
+  std::vector<Vec<double, D>> positions_;  // per orbital, new fractional
+  std::vector<Hop> hops_;                  // sorted by `from`
+  std::vector<std::size_t> first_hop_;     // hops_ of orbital a start here
+  std::vector<double> onsite_;
+  Lattice<D> crystal_;
+};
+
+namespace detail {
+
+// Lattice of the in-plane vectors (the first D - 1 columns of `basis`)
+// expressed in an orthonormal frame of the plane: a Cholesky factor of their
+// metric.
+template <std::size_t D>
+Lattice<D - 1> plane_lattice(Lattice<D> const& crystal,
+                             Matrix<int, D, D> const& basis) {
+  std::vector<Vec<double, D>> vectors;
+  for (std::size_t i = 0; i + 1 < D; i++) {
+    Vec<double, D> f{};
+    for (std::size_t d = 0; d < D; d++) f[d] = basis.at(d, i);
+    vectors.push_back(crystal.to_cartesian(f));
+  }
+  Matrix<double, D - 1, D - 1> l{};
+  for (std::size_t i = 0; i + 1 < D; i++) {
+    for (std::size_t j = 0; j <= i; j++) {
+      double sum = vectors[i].dot(vectors[j]);
+      for (std::size_t k = 0; k < j; k++) sum -= l.at(i, k) * l.at(j, k);
+      l.at(i, j) = i == j ? std::sqrt(sum) : sum / l.at(j, j);
+    }
+  }
+  return Lattice<D - 1>(l);
+}
+
+}  // namespace detail
+
+template <std::size_t D>
+Slab<D>::Slab(UnitCell<D> const& cell, HoppingTable<D> const& table,
+              Vec<int, D> const& miller, std::size_t width)
+    : basis_(plane_basis(miller)),
+      lattice_(detail::plane_lattice(cell.lattice(), basis_)),
+      width_(width),
+      orbitals_(table.orbitals()),
+      onsite_(width * table.orbitals(), 0.0),
+      crystal_(cell.lattice()) {
+  ASSERT(width > 0);
+  ASSERT(cell.orbitals() == table.orbitals());
+  Matrix<double, D, D> u{};
+  for (std::size_t i = 0; i < D; i++) {
+    for (std::size_t j = 0; j < D; j++) u.at(i, j) = basis_.at(i, j);
+  }
+  Matrix<double, D, D> inv = inverse(u);
+  Matrix<int, D, D> to_new{};
+  for (std::size_t i = 0; i < D; i++) {
+    for (std::size_t j = 0; j < D; j++) {
+      to_new.at(i, j) = static_cast<int>(std::lround(inv.at(i, j)));
+    }
+  }
+
+  // Sites wrapped into the new cell, remembering the cell they came from.
+  std::vector<Vec<int, D>> shift(cell.sites());
+  for (std::size_t s = 0; s < cell.sites(); s++) {
+    Vec<double, D> g = inv * cell.position(s);
+    for (std::size_t d = 0; d < D; d++) {
+      double n = std::floor(g[d] + 1e-9);
+      shift[s][d] = static_cast<int>(n);
+      g[d] -= n;
+    }
+    for (std::size_t o = 0; o < cell.orbitals(s); o++) positions_.push_back(g);
+  }
+  std::vector<std::size_t> site_of(orbitals_);
+  for (std::size_t s = 0; s < cell.sites(); s++) {
+    for (std::size_t o = 0; o < cell.orbitals(s); o++) {
+      site_of[cell.orbital_offset(s) + o] = s;
+    }
+  }
+
+  for (std::size_t r = 0; r < table.translations(); r++) {
+    Vec<int, D> const& R = table.translation(r);
+    Vec<int, D> moved{};
+    for (std::size_t i = 0; i < D; i++) {
+      moved[i] = 0;
+      for (std::size_t j = 0; j < D; j++) moved[i] += to_new.at(i, j) * R[j];
+    }
+    for (std::size_t a = 0; a < orbitals_; a++) {
+      for (std::size_t b = 0; b < orbitals_; b++) {
+        std::complex<double> t = table.at(r, a, b);
+        if (t == 0.0) continue;
+        Vec<int, D> c = moved + shift[site_of[b]] - shift[site_of[a]];
+        Hop hop{a, b, Vec<int, D - 1>{}, c[D - 1], t};
+        for (std::size_t d = 0; d + 1 < D; d++) hop.cell[d] = c[d];
+        reach_ = std::max<std::size_t>(reach_, std::abs(hop.layer));
+        hops_.push_back(hop);
+      }
+    }
+  }
+  std::stable_sort(hops_.begin(), hops_.end(),
+                   [](Hop const& x, Hop const& y) { return x.from < y.from; });
+  first_hop_.assign(orbitals_ + 1, 0);
+  for (auto const& hop : hops_) first_hop_[hop.from + 1]++;
+  for (std::size_t a = 0; a < orbitals_; a++) {
+    first_hop_[a + 1] += first_hop_[a];
+  }
+}
+
+template <std::size_t D>
+Vec<double, D> Slab<D>::position(std::size_t i) const {
+  std::size_t layer = i / orbitals_;
+  Vec<double, D> g = positions_[i % orbitals_];
+  g[D - 1] += static_cast<double>(layer);
+  Vec<double, D> f{};
+  for (std::size_t r = 0; r < D; r++) {
+    f[r] = 0.0;
+    for (std::size_t c = 0; c < D; c++) f[r] += basis_.at(r, c) * g[c];
+  }
+  return crystal_.to_cartesian(f);
+}
+
+template <std::size_t D>
+void Slab<D>::passivate(double energy) {
+  auto cut = [&](std::size_t layer) {
+    for (std::size_t a = 0; a < orbitals_; a++) {
+      for (std::size_t h = first_hop_[a]; h < first_hop_[a + 1]; h++) {
+        long target = static_cast<long>(layer) + hops_[h].layer;
+        if (target < 0 || target >= static_cast<long>(width_)) {
+          onsite_[layer * orbitals_ + a] += energy;
+        }
+      }
+    }
+  };
+  // Only layers within reach of a surface can lose hoppings.
+  for (std::size_t l = 0; l < width_; l++) {
+    if (l < reach_ || l + reach_ >= width_) cut(l);
+  }
+}
+
+template <std::size_t D>
+Graph Slab<D>::graph() const {
+  // Neighbor template of each orbital as (layer offset, orbital), including
+  // reversed hoppings so the graph is symmetric even for a one-sided table.
+  std::vector<std::vector<std::pair<int, std::size_t>>> pattern(orbitals_);
+  for (auto const& hop : hops_) {
+    pattern[hop.from].emplace_back(hop.layer, hop.to);
+    pattern[hop.to].emplace_back(-hop.layer, hop.from);
+  }
+  for (auto& row : pattern) {
+    std::sort(row.begin(), row.end());
+    row.erase(std::unique(row.begin(), row.end()), row.end());
+  }
+
+  std::vector<std::size_t> offsets{0};
+  offsets.reserve(size() + 1);
+  std::vector<std::size_t> adjacency;
+  for (std::size_t l = 0; l < width_; l++) {
+    for (std::size_t a = 0; a < orbitals_; a++) {
+      std::size_t self = l * orbitals_ + a;
+      // (layer, orbital) order is the slab order, so the row comes out sorted.
+      for (auto [layer, b] : pattern[a]) {
+        long target = static_cast<long>(l) + layer;
+        if (target < 0 || target >= static_cast<long>(width_)) continue;
+        std::size_t j = static_cast<std::size_t>(target) * orbitals_ + b;
+        if (j != self) adjacency.push_back(j);
+      }
+      offsets.push_back(adjacency.size());
+    }
+  }
+  return {std::move(offsets), std::move(adjacency)};
+}
+
+template <std::size_t D>
+void Slab<D>::hamiltonian(Vec<double, D - 1> const& k,
+                          SparseMatrix<std::complex<double>>& h) const {
+  ASSERT(h.size() == size() && h.triangle() == Triangle::Full);
+  std::vector<std::complex<double>> phase(hops_.size());
+  for (std::size_t i = 0; i < hops_.size(); i++) {
+    double angle = 0.0;
+    for (std::size_t d = 0; d + 1 < D; d++) angle += k[d] * hops_[i].cell[d];
+    phase[i] = hops_[i].t * std::polar(1.0, 2.0 * M_PI * angle);
+  }
+
+  std::vector<std::complex<double>>& values = h.values();
+  std::fill(values.begin(), values.end(), 0.0);
+  parallel_for(
+      width_,
+      [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t l = begin; l < end; l++) {
+          for (std::size_t a = 0; a < orbitals_; a++) {
+            std::size_t i = l * orbitals_ + a;
+            values[h.find(i, i)] += onsite_[i];
+            for (std::size_t x = first_hop_[a]; x < first_hop_[a + 1]; x++) {
+              long target = static_cast<long>(l) + hops_[x].layer;
+              if (target < 0 || target >= static_cast<long>(width_)) continue;
+              std::size_t j =
+                  static_cast<std::size_t>(target) * orbitals_ + hops_[x].to;
+              values[h.find(i, j)] += phase[x];
+            }
+          }
+        }
+      },
+      64);
+}
+
+template <std::size_t D>
+SparseMatrix<std::complex<double>> Slab<D>::hamiltonian(
+    Vec<double, D - 1> const& k) const {
+  SparseMatrix<std::complex<double>> h(graph());
+  hamiltonian(k, h);
+  return h;
+}
+
+#endif  // TIGHTB_SLAB_H
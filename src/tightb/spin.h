@@ -0,0 +1,157 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_SPIN_H
+#define TIGHTB_SPIN_H
+
+#include <tightb/assert.h>
+#include <tightb/bloch.h>
+#include <tightb/graph.h>
+#include <tightb/hopping.h>
+#include <tightb/matrix.h>
+#include <tightb/sparse.h>
+#include <tightb/vector.h>
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+enum class Pauli { X, Y, Z };
+
+// h0 I + hx sigma_x + hy sigma_y + hz sigma_z.
+inline Matrix<std::complex<double>, 2, 2> spin_block(std::complex<double> h0,
+                                                     std::complex<double> hx,
+                                                     std::complex<double> hy,
+                                                     std::complex<double> hz) {
+  std::complex<double> const i(0.0, 1.0);
+  return {{h0 + hz, hx - i * hy}, {hx + i * hy, h0 - hz}};
+}
+
+// Spinful Hamiltonian H = H0 (x) I + sum_a H_a (x) sigma_a on a graph, stored
+// as its four N x N components instead of the 2N x 2N matrix. The components
+// share one sparsity pattern, so each bond costs one column index and up to
+// four values instead of four of each, and a component that was never
+// touched (no Rashba term, say) costs nothing at all.
+//
+// Spinful vectors interleave the spin: element 2 i + s is site i, spin s.
+class SpinMatrix {
+ public:
+  explicit SpinMatrix(Graph const& graph);
+
+  [[nodiscard]] std::size_t size() const { return h0_.size(); }
+
+  // The spin-independent part, usable on its own by the spinless kernels.
+  [[nodiscard]] SparseMatrix<std::complex<double>> const& h0() const {
+    return h0_;
+  }
+
+  SparseMatrix<std::complex<double>>& h0() { return h0_; }
+
+  [[nodiscard]] bool has(Pauli a) const { return !spin_[index(a)].empty(); }
+
+  // Values of H_a in the pattern of h0(), allocated on first use.
+  std::vector<std::complex<double>>& values(Pauli a);
+
+  [[nodiscard]] std::vector<std::complex<double>> const& values(
+      Pauli a) const {
+    return spin_[index(a)];
+  }
+
+  std::complex<double>& at(Pauli a, std::size_t i, std::size_t j);
+
+  // The 2 x 2 spin block of sites (i, j).
+  [[nodiscard]] Matrix<std::complex<double>, 2, 2> block(std::size_t i,
+                                                         std::size_t j) const;
+
+  // y = H x for spinful vectors of length 2 size(). Each stored entry is
+  // expanded into its 2 x 2 block on the fly.
+  void multiply(std::complex<double> const* x, std::complex<double>* y) const;
+
+  // The explicit 2N x 2N matrix, for checks and small systems.
+  [[nodiscard]] SparseMatrix<std::complex<double>> expand() const;
+
+ private:
+  static std::size_t index(Pauli a) { return static_cast<std::size_t>(a); }
+
+  SparseMatrix<std::complex<double>> h0_;
+  std::array<std::vector<std::complex<double>>, 3> spin_;
+};
+
+// Bloch Hamiltonian of a spinful periodic model from the hopping tables of
+// its components; null tables are absent terms. H(k) is written as a dense
+// 2n x 2n matrix with interleaved spin, assembled block by block, so the
+// tables only hold n x n blocks.
+template <std::size_t D>
+class SpinBlochHamiltonian {
+ public:
+  SpinBlochHamiltonian(HoppingTable<D> const& h0, HoppingTable<D> const* hx,
+                       HoppingTable<D> const* hy, HoppingTable<D> const* hz)
+      : h0_(h0), spin_{hx, hy, hz} {
+    for (auto const* table : spin_) {
+      ASSERT(table == nullptr || table->orbitals() == h0.orbitals());
+    }
+  }
+
+  // Number of spinful states, twice the orbitals.
+  [[nodiscard]] std::size_t size() const { return 2 * h0_.orbitals(); }
+
+  void build(Vec<double, D> const& k, std::complex<double>* h,
+             BlochWorkspace& w) const;
+
+ private:
+  HoppingTable<D> const& h0_;
+  std::array<HoppingTable<D> const*, 3> spin_;
+};
+
+template <std::size_t D>
+void SpinBlochHamiltonian<D>::build(Vec<double, D> const& k,
+                                    std::complex<double>* h,
+                                    BlochWorkspace& w) const {
+  std::size_t n = h0_.orbitals();
+  // Components go through w.re / w.im one at a time and are collected in
+  // w.h as four consecutive n x n blocks.
+  w.h.assign(4 * n * n, 0.0);
+  auto component = [&](HoppingTable<D> const& table, std::size_t slot) {
+    BlochHamiltonian<D> bloch(table);
+    bloch.phases(k, w);
+    bloch.accumulate(w);
+    std::complex<double>* out = w.h.data() + slot * n * n;
+    for (std::size_t i = 0; i < n * n; i++) out[i] = {w.re[i], w.im[i]};
+  };
+  component(h0_, 0);
+  for (std::size_t a = 0; a < 3; a++) {
+    if (spin_[a] != nullptr) component(*spin_[a], a + 1);
+  }
+
+  std::complex<double> const* c0 = w.h.data();
+  std::complex<double> const* cx = c0 + n * n;
+  std::complex<double> const* cy = cx + n * n;
+  std::complex<double> const* cz = cy + n * n;
+  for (std::size_t a = 0; a < n; a++) {
+    for (std::size_t b = 0; b < n; b++) {
+      std::size_t e = a * n + b;
+      auto block = spin_block(c0[e], cx[e], cy[e], cz[e]);
+      for (std::size_t s = 0; s < 2; s++) {
+        for (std::size_t t = 0; t < 2; t++) {
+          h[(2 * a + s) * 2 * n + 2 * b + t] = block.at(s, t);
+        }
+      }
+    }
+  }
+}
+
+#endif  // TIGHTB_SPIN_H
@@ -0,0 +1,161 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_STRAIN_H
+#define TIGHTB_STRAIN_H
+
+#include <tightb/assert.h>
+#include <tightb/parallel.h>
+#include <tightb/scalar.h>
+#include <tightb/sparse.h>
+#include <tightb/vector.h>
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Strain-dependent hoppings t(d) = t0 exp(-beta (d / d0 - 1)) on the bonds of
+// an assembled Hamiltonian with full storage. The reference state, i.e. t0,
+// d0 and the bond vectors, is read once at construction; each update then
+// rewrites only the values of the bonds in place, so the pattern, and
+// anything built on it, survives any number of strain configurations.
+//
+// Bonds are kept as structure-of-arrays (the two endpoints, the slots of H_ij
+// and H_ji, one array per component of the reference bond vector), and the
+// update is a single pass over them split across threads. The strained bond
+// vector is the reference one plus u_j - u_i, which stays right for bonds
+// that cross a periodic boundary.
+template <typename T, std::size_t D>
+class BondStrain {
+ public:
+  // Reference bond vectors are positions[j] - positions[i].
+  BondStrain(SparseMatrix<T> const& h,
+             std::vector<Vec<double, D>> const& positions, double beta)
+      : BondStrain(h, positions, beta,
+                   [&](std::size_t i, std::size_t j) {
+                     return positions[j] - positions[i];
+                   }) {}
+
+  // Reference bond vectors from bond(i, j), e.g. the minimum image in a
+  // periodic sample.
+  template <typename F>
+  BondStrain(SparseMatrix<T> const& h,
+             std::vector<Vec<double, D>> const& positions, double beta,
+             F&& bond);
+
+  [[nodiscard]] std::size_t bonds() const { return t0_.size(); }
+
+  [[nodiscard]] double beta() const { return beta_; }
+
+  // Sets every bond of h to its hopping under the displacements u (one per
+  // site, in the units of the positions). h must have the pattern the strain
+  // was built from.
+  void apply(std::vector<Vec<double, D>> const& u, SparseMatrix<T>& h) const;
+
+  // Same with u = field(position) evaluated at the reference positions.
+  template <typename F>
+  void apply_field(F&& field, SparseMatrix<T>& h);
+
+ private:
+  double beta_;
+  std::vector<Vec<double, D>> positions_;
+  std::size_t nonzeros_;  // of the pattern the slots index into
+  std::vector<std::size_t> from_;
+  std::vector<std::size_t> to_;
+  std::vector<std::size_t> upper_;  // slot of H_ij, i < j
+  std::vector<std::size_t> lower_;  // slot of H_ji
+  std::array<std::vector<double>, D> bond_;
+  std::vector<double> inverse_length_;  // 1 / d0
+  std::vector<T> t0_;
+  std::vector<Vec<double, D>> displacement_;
+};
+
+template <typename T, std::size_t D>
+template <typename F>
+BondStrain<T, D>::BondStrain(SparseMatrix<T> const& h,
+                             std::vector<Vec<double, D>> const& positions,
+                             double beta, F&& bond)
+    : beta_(beta), positions_(positions), nonzeros_(h.nonzeros()) {
+  ASSERT(h.triangle() == Triangle::Full);
+  ASSERT(positions.size() == h.size());
+  auto const& offsets = h.offsets();
+  auto const& columns = h.columns();
+  for (std::size_t i = 0; i < h.size(); i++) {
+    for (std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+      std::size_t j = columns[k];
+      if (j <= i) continue;
+      Vec<double, D> d = bond(i, j);
+      double length = std::sqrt(d.dot(d));
+      ASSERT(length > 0.0, "bond between coincident sites");
+      std::size_t mirror = h.find(j, i);
+      ASSERT(mirror != h.npos, "pattern is not structurally symmetric");
+      from_.push_back(i);
+      to_.push_back(j);
+      upper_.push_back(k);
+      lower_.push_back(mirror);
+      for (std::size_t c = 0; c < D; c++) bond_[c].push_back(d[c]);
+      inverse_length_.push_back(1.0 / length);
+      t0_.push_back(h.values()[k]);
+    }
+  }
+}
+
+template <typename T, std::size_t D>
+void BondStrain<T, D>::apply(std::vector<Vec<double, D>> const& u,
+                             SparseMatrix<T>& h) const {
+  ASSERT(u.size() == positions_.size());
+  ASSERT(h.size() == positions_.size() && h.nonzeros() == nonzeros_);
+  std::vector<T>& values = h.values();
+  parallel_for(
+      bonds(),
+      [&](std::size_t begin, std::size_t end, std::size_t) {
+        std::size_t const* from = from_.data();
+        std::size_t const* to = to_.data();
+        double const* inverse_length = inverse_length_.data();
+        for (std::size_t b = begin; b < end; b++) {
+          Vec<double, D> const& ui = u[from[b]];
+          Vec<double, D> const& uj = u[to[b]];
+          double length2 = 0.0;
+          for (std::size_t c = 0; c < D; c++) {
+            double x = bond_[c][b] + uj[c] - ui[c];
+            length2 += x * x;
+          }
+          double ratio = std::sqrt(length2) * inverse_length[b];
+          T t = t0_[b] * std::exp(-beta_ * (ratio - 1.0));
+          values[upper_[b]] = t;
+          values[lower_[b]] = conjugate(t);
+        }
+      },
+      4096);
+}
+
+template <typename T, std::size_t D>
+template <typename F>
+void BondStrain<T, D>::apply_field(F&& field, SparseMatrix<T>& h) {
+  displacement_.resize(positions_.size());
+  parallel_for(
+      positions_.size(),
+      [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; i++) {
+          displacement_[i] = field(positions_[i]);
+        }
+      },
+      4096);
+  apply(displacement_, h);
+}
+
+#endif  // TIGHTB_STRAIN_H
@@ -0,0 +1,233 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_SUPERCELL_H
+#define TIGHTB_SUPERCELL_H
+
+#include <tightb/assert.h>
+#include <tightb/graph.h>
+#include <tightb/parallel.h>
+#include <tightb/vector.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+// Bond from basis site `from` of the home cell to basis site `to` of the cell
+// displaced by `cell` lattice vectors.
+template <std::size_t D>
+struct Bond {
+  std::size_t from;
+  std::size_t to;
+  Vec<int, D> cell;
+};
+
+// Rows [first_row, first_row + offsets.size() - 1) of a supercell graph, with
+// offsets relative to the start of `adjacency`.
+struct GraphChunk {
+  std::size_t first_row = 0;
+  std::vector<std::size_t> offsets{0};
+  std::vector<std::size_t> adjacency;
+};
+
+// Writes the chunks produced by Supercell::stream() to a binary file and reads
+// the result back as a Graph.
+void write_chunk(std::ostream& out, GraphChunk const& chunk);
+
+void write_graph_header(std::ostream& out, std::size_t sites);
+
+Graph read_graph(std::istream& in);
+
+// Repeats a unit cell extent[0] x ... x extent[D-1] times. Site ids are
+// cell * basis + b with cells numbered in row-major order, so the neighbors of
+// any site follow from its cell coordinates and the supercell never has to
+// hold a bond list: rows are generated directly in CSR form, a chunk of cells
+// at a time and in parallel within a chunk.
+template <std::size_t D>
+class Supercell {
+ public:
+  // `cell` holds the bonds inside the unit cell, `bonds` the ones crossing
+  // into neighboring cells. Directions with periodic[d] == false are open.
+  Supercell(Graph const& cell, std::vector<Bond<D>> const& bonds,
+            std::array<std::size_t, D> extent, std::array<bool, D> periodic);
+
+  [[nodiscard]] std::size_t basis() const { return basis_; }
+
+  [[nodiscard]] std::size_t cells() const { return cells_; }
+
+  [[nodiscard]] std::size_t size() const { return cells_ * basis_; }
+
+  [[nodiscard]] std::size_t site(std::array<std::size_t, D> cell,
+                                 std::size_t b) const;
+
+  // Appends the sorted neighbors of `site` to `row`.
+  void neighbors(std::size_t site, std::vector<std::size_t>& row) const;
+
+  // Rows of the sites in cells [first_cell, last_cell).
+  void generate(std::size_t first_cell, std::size_t last_cell,
+                GraphChunk& chunk) const;
+
+  // Hands the graph to sink(GraphChunk const&) in order, `cells_per_chunk`
+  // cells at a time. Only one chunk is alive at any moment.
+  template <typename F>
+  void stream(std::size_t cells_per_chunk, F&& sink) const;
+
+  void write(std::ostream& out, std::size_t cells_per_chunk) const;
+
+  // Builds the whole graph, counting degrees first so the CSR arrays are
+  // allocated once and filled in parallel.
+  [[nodiscard]] Graph build() const;
+
+ private:
+  struct HalfBond {
+    std::size_t to;
+    Vec<int, D> cell;
+  };
+
+  std::size_t basis_;
+  std::size_t cells_ = 1;
+  std::array<std::size_t, D> extent_;
+  std::array<bool, D> periodic_;
+  std::vector<std::vector<HalfBond>> outgoing_;
+};
+
+template <std::size_t D>
+Supercell<D>::Supercell(Graph const& cell, std::vector<Bond<D>> const& bonds,
+                        std::array<std::size_t, D> extent,
+                        std::array<bool, D> periodic)
+    : basis_(cell.size()),
+      extent_(extent),
+      periodic_(periodic),
+      outgoing_(cell.size()) {
+  for (std::size_t d = 0; d < D; d++) {
+    ASSERT(extent[d] > 0);
+    cells_ *= extent[d];
+  }
+  Vec<int, D> home{};
+  for (std::size_t d = 0; d < D; d++) home[d] = 0;
+  for (std::size_t b = 0; b < basis_; b++) {
+    for (std::size_t u : cell.neighbors(b)) outgoing_[b].push_back({u, home});
+  }
+  for (auto const& bond : bonds) {
+    ASSERT(bond.from < basis_ && bond.to < basis_);
+    outgoing_[bond.from].push_back({bond.to, bond.cell});
+    outgoing_[bond.to].push_back({bond.from, bond.cell * -1});
+  }
+}
+
+template <std::size_t D>
+std::size_t Supercell<D>::site(std::array<std::size_t, D> cell,
+                               std::size_t b) const {
+  std::size_t index = 0;
+  for (std::size_t d = 0; d < D; d++) index = index * extent_[d] + cell[d];
+  return index * basis_ + b;
+}
+
+template <std::size_t D>
+void Supercell<D>::neighbors(std::size_t site,
+                             std::vector<std::size_t>& row) const {
+  std::size_t b = site % basis_;
+  std::size_t index = site / basis_;
+  std::array<std::size_t, D> cell;
+  for (std::size_t d = D; d > 0; d--) {
+    cell[d - 1] = index % extent_[d - 1];
+    index /= extent_[d - 1];
+  }
+
+  std::size_t first = row.size();
+  for (auto const& half : outgoing_[b]) {
+    std::array<std::size_t, D> target;
+    bool inside = true;
+    for (std::size_t d = 0; d < D; d++) {
+      long n = static_cast<long>(extent_[d]);
+      long c = static_cast<long>(cell[d]) + half.cell[d];
+      if (periodic_[d]) {
+        c = ((c % n) + n) % n;
+      } else if (c < 0 || c >= n) {
+        inside = false;
+        break;
+      }
+      target[d] = static_cast<std::size_t>(c);
+    }
+    if (!inside) continue;
+    std::size_t neighbor = this->site(target, half.to);
+    if (neighbor != site) row.push_back(neighbor);
+  }
+  std::sort(row.begin() + first, row.end());
+  row.erase(std::unique(row.begin() + first, row.end()), row.end());
+}
+
+template <std::size_t D>
+void Supercell<D>::generate(std::size_t first_cell, std::size_t last_cell,
+                            GraphChunk& chunk) const {
+  std::size_t first = first_cell * basis_;
+  std::size_t rows = (last_cell - first_cell) * basis_;
+  chunk.first_row = first;
+  chunk.offsets.assign(rows + 1, 0);
+
+  parallel_for(rows, [&](std::size_t begin, std::size_t end, std::size_t) {
+    std::vector<std::size_t> row;
+    for (std::size_t r = begin; r < end; r++) {
+      row.clear();
+      neighbors(first + r, row);
+      chunk.offsets[r + 1] = row.size();
+    }
+  });
+  for (std::size_t r = 0; r < rows; r++) {
+    chunk.offsets[r + 1] += chunk.offsets[r];
+  }
+
+  chunk.adjacency.resize(chunk.offsets[rows]);
+  parallel_for(rows, [&](std::size_t begin, std::size_t end, std::size_t) {
+    std::vector<std::size_t> row;
+    for (std::size_t r = begin; r < end; r++) {
+      row.clear();
+      neighbors(first + r, row);
+      std::copy(row.begin(), row.end(),
+                chunk.adjacency.begin() + chunk.offsets[r]);
+    }
+  });
+}
+
+template <std::size_t D>
+template <typename F>
+void Supercell<D>::stream(std::size_t cells_per_chunk, F&& sink) const {
+  ASSERT(cells_per_chunk > 0);
+  GraphChunk chunk;
+  for (std::size_t c = 0; c < cells_; c += cells_per_chunk) {
+    generate(c, std::min(cells_, c + cells_per_chunk), chunk);
+    sink(static_cast<GraphChunk const&>(chunk));
+  }
+}
+
+template <std::size_t D>
+void Supercell<D>::write(std::ostream& out, std::size_t cells_per_chunk) const {
+  write_graph_header(out, size());
+  stream(cells_per_chunk,
+         [&](GraphChunk const& chunk) { write_chunk(out, chunk); });
+}
+
+template <std::size_t D>
+Graph Supercell<D>::build() const {
+  GraphChunk whole;
+  generate(0, cells_, whole);
+  return {std::move(whole.offsets), std::move(whole.adjacency)};
+}
+
+#endif  // TIGHTB_SUPERCELL_H
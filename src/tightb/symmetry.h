@@ -0,0 +1,303 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TIGHTB_SYMMETRY_H
+#define TIGHTB_SYMMETRY_H
+
+#include <tightb/assert.h>
+#include <tightb/hopping.h>
+#include <tightb/lattice.h>
+#include <tightb/matrix.h>
+#include <tightb/vector.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Space-group operation f -> rotation f + translation acting on fractional
+// coordinates. The rotation is an integer matrix since it maps the lattice
+// onto itself.
+template <std::size_t D>
+struct SymmetryOperation {
+  Matrix<int, D, D> rotation;
+  Vec<double, D> translation;
+};
+
+namespace detail {
+
+template <std::size_t D>
+bool same_fractional(Vec<double, D> const& a, Vec<double, D> const& b,
+                     double tolerance) {
+  for (std::size_t d = 0; d < D; d++) {
+    double x = a[d] - b[d];
+    if (std::abs(x - std::round(x)) > tolerance) return false;
+  }
+  return true;
+}
+
+template <std::size_t D>
+Vec<double, D> apply(SymmetryOperation<D> const& op, Vec<double, D> const& f) {
+  Vec<double, D> g{};
+  for (std::size_t i = 0; i < D; i++) {
+    g[i] = op.translation[i];
+    for (std::size_t j = 0; j < D; j++) g[i] += op.rotation.at(i, j) * f[j];
+  }
+  return g;
+}
+
+template <std::size_t D>
+bool is_identity(Matrix<int, D, D> const& m) {
+  for (std::size_t i = 0; i < D; i++) {
+    for (std::size_t j = 0; j < D; j++) {
+      if (m.at(i, j) != (i == j ? 1 : 0)) return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace detail
+
+// Symmetry operations of the crystal: rotations W that preserve the metric,
+// W^T G W = G with G_ij = a_i . a_j, and map the basis onto itself (site onto
+// a site with as many orbitals) up to a translation. Rotations are searched
+// among matrices with entries in {-1, 0, 1}, which covers every point group
+// when the lattice vectors are a reduced basis. The identity comes first.
+//
+// This is the symmetry of the geometry; a model whose hoppings break it must
+// not be reduced with the result.
+template <std::size_t D>
+std::vector<SymmetryOperation<D>> point_group(UnitCell<D> const& cell,
+                                              double tolerance = 1e-6) {
+  ASSERT(cell.sites() > 0);
+  Matrix<double, D, D> const& a = cell.lattice().vectors();
+  Matrix<double, D, D> metric = a * a.transpose();
+  double scale = 0.0;
+  for (std::size_t i = 0; i < D; i++) scale = std::max(scale, metric.at(i, i));
+
+  std::vector<SymmetryOperation<D>> ops;
+  std::size_t candidates = 1;
+  for (std::size_t i = 0; i < D * D; i++) candidates *= 3;
+  for (std::size_t c = 0; c < candidates; c++) {
+    Matrix<int, D, D> w{};
+    std::size_t rest = c;
+    for (std::size_t i = 0; i < D * D; i++) {
+      w.at(i / D, i % D) = static_cast<int>(rest % 3) - 1;
+      rest /= 3;
+    }
+
+    bool isometry = true;
+    for (std::size_t i = 0; i < D && isometry; i++) {
+      for (std::size_t j = 0; j < D && isometry; j++) {
+        double g = 0.0;
+        for (std::size_t k = 0; k < D; k++) {
+          for (std::size_t l = 0; l < D; l++) {
+            g += w.at(k, i) * metric.at(k, l) * w.at(l, j);
+          }
+        }
+        isometry = std::abs(g - metric.at(i, j)) <= tolerance * scale;
+      }
+    }
+    if (!isometry) continue;
+
+    // The image of site 0 fixes the translation; try every candidate.
+    for (std::size_t target = 0; target < cell.sites(); target++) {
+      if (cell.orbitals(target) != cell.orbitals(0)) continue;
+      SymmetryOperation<D> op{w, Vec<double, D>{}};
+      for (std::size_t d = 0; d < D; d++) op.translation[d] = 0.0;
+      Vec<double, D> image = detail::apply(op, cell.position(0));
+      op.translation = cell.position(target) - image;
+      for (std::size_t d = 0; d < D; d++) {
+        op.translation[d] -= std::floor(op.translation[d] + tolerance);
+      }
+
+      bool maps = true;
+      for (std::size_t i = 0; i < cell.sites() && maps; i++) {
+        Vec<double, D> f = detail::apply(op, cell.position(i));
+        maps = false;
+        for (std::size_t j = 0; j < cell.sites() && !maps; j++) {
+          maps = cell.orbitals(j) == cell.orbitals(i) &&
+                 detail::same_fractional(f, cell.position(j), tolerance);
+        }
+      }
+      if (maps) {
+        ops.push_back(op);
+        break;
+      }
+    }
+  }
+  std::stable_partition(ops.begin(), ops.end(), [](auto const& op) {
+    return detail::is_identity(op.rotation);
+  });
+  return ops;
+}
+
+// Action of a fractional rotation W on reduced k: k -> W^{-T} k, so that
+// k . f is invariant.
+template <std::size_t D>
+Matrix<int, D, D> reciprocal_rotation(Matrix<int, D, D> const& w) {
+  Matrix<double, D, D> m{};
+  for (std::size_t i = 0; i < D; i++) {
+    for (std::size_t j = 0; j < D; j++) m.at(i, j) = w.at(i, j);
+  }
+  Matrix<double, D, D> inv = inverse(m).transpose();
+  Matrix<int, D, D> r{};
+  for (std::size_t i = 0; i < D; i++) {
+    for (std::size_t j = 0; j < D; j++) {
+      r.at(i, j) = static_cast<int>(std::lround(inv.at(i, j)));
+    }
+  }
+  return r;
+}
+
+// Monkhorst-Pack mesh k = (n + shift) / mesh reduced to its irreducible
+// points. Full point p (row-major, as in BlochHamiltonian::mesh()) is
+// rotations[operation[p]] applied to points[map[p]].
+template <std::size_t D>
+struct IrreducibleMesh {
+  std::array<std::size_t, D> mesh;
+  Vec<double, D> shift;
+  std::vector<Vec<double, D>> points;
+  std::vector<double> weights;  // sum to one
+  std::vector<std::size_t> map;
+  std::vector<std::size_t> operation;
+  std::vector<Matrix<int, D, D>> rotations;  // acting on reduced k
+
+  [[nodiscard]] std::size_t size() const { return points.size(); }
+
+  [[nodiscard]] std::size_t full_size() const { return map.size(); }
+};
+
+// Reduces the mesh with the rotations of `ops` that map it onto itself. With
+// `time_reversal` k and -k are identified as well, which is valid only for
+// models with E(k) = E(-k).
+template <std::size_t D>
+IrreducibleMesh<D> reduce_mesh(std::vector<SymmetryOperation<D>> const& ops,
+                               std::array<std::size_t, D> const& mesh,
+                               Vec<double, D> const& shift,
+                               bool time_reversal = false,
+                               double tolerance = 1e-6) {
+  IrreducibleMesh<D> result;
+  result.mesh = mesh;
+  result.shift = shift;
+  std::size_t total = 1;
+  for (std::size_t d = 0; d < D; d++) {
+    ASSERT(mesh[d] > 0);
+    total *= mesh[d];
+  }
+
+  auto coordinates = [&](std::size_t p) {
+    Vec<double, D> k{};
+    for (std::size_t d = D; d > 0; d--) {
+      k[d - 1] = (static_cast<double>(p % mesh[d - 1]) + shift[d - 1]) /
+                 static_cast<double>(mesh[d - 1]);
+      p /= mesh[d - 1];
+    }
+    return k;
+  };
+  // Mesh index of r k, or total if r k is not a mesh point.
+  auto image = [&](Matrix<int, D, D> const& r, Vec<double, D> const& k) {
+    std::size_t index = 0;
+    for (std::size_t i = 0; i < D; i++) {
+      double x = 0.0;
+      for (std::size_t j = 0; j < D; j++) x += r.at(i, j) * k[j];
+      double n = x * static_cast<double>(mesh[i]) - shift[i];
+      double rounded = std::round(n);
+      if (std::abs(n - rounded) > tolerance) return total;
+      long m = static_cast<long>(mesh[i]);
+      long c = ((static_cast<long>(rounded) % m) + m) % m;
+      index = index * mesh[i] + static_cast<std::size_t>(c);
+    }
+    return index;
+  };
+
+  // The identity and, with time reversal, inversion are always there, so an
+  // empty `ops` still gives the half-zone mesh.
+  std::vector<Matrix<int, D, D>> candidates;
+  Matrix<int, D, D> one{};
+  for (std::size_t d = 0; d < D; d++) one.at(d, d) = 1;
+  candidates.push_back(one);
+  if (time_reversal) candidates.push_back(one * -1);
+  for (auto const& op : ops) {
+    Matrix<int, D, D> r = reciprocal_rotation(op.rotation);
+    candidates.push_back(r);
+    if (time_reversal) candidates.push_back(r * -1);
+  }
+  for (auto const& r : candidates) {
+    if (std::find(result.rotations.begin(), result.rotations.end(), r) !=
+        result.rotations.end()) {
+      continue;
+    }
+    bool closed = true;
+    for (std::size_t p = 0; p < total && closed; p++) {
+      closed = image(r, coordinates(p)) < total;
+    }
+    if (closed) result.rotations.push_back(r);
+  }
+
+  std::size_t none = std::numeric_limits<std::size_t>::max();
+  result.map.assign(total, none);
+  result.operation.assign(total, none);
+  for (std::size_t p = 0; p < total; p++) {
+    if (result.map[p] != none) continue;
+    Vec<double, D> k = coordinates(p);
+    std::size_t irreducible = result.points.size();
+    std::size_t count = 0;
+    for (std::size_t o = 0; o < result.rotations.size(); o++) {
+      std::size_t q = image(result.rotations[o], k);
+      if (result.map[q] != none) continue;
+      result.map[q] = irreducible;
+      result.operation[q] = o;
+      count++;
+    }
+    result.points.push_back(k);
+    result.weights.push_back(static_cast<double>(count) /
+                             static_cast<double>(total));
+  }
+  return result;
+}
+
+// Same, with time reversal used whenever `table` has it.
+template <std::size_t D>
+IrreducibleMesh<D> reduce_mesh(std::vector<SymmetryOperation<D>> const& ops,
+                               HoppingTable<D> const& table,
+                               std::array<std::size_t, D> const& mesh,
+                               Vec<double, D> const& shift,
+                               double tolerance = 1e-6) {
+  return reduce_mesh(ops, mesh, shift, table.time_reversal_symmetric(),
+                     tolerance);
+}
+
+// Copies per-point results (`stride` values per point, e.g. band energies)
+// from the irreducible points to the whole mesh. Quantities that transform
+// under rotations, such as velocities, need mesh.rotations[mesh.operation[p]]
+// applied on top.
+template <std::size_t D, typename T>
+std::vector<T> unfold(IrreducibleMesh<D> const& mesh,
+                      std::vector<T> const& values, std::size_t stride = 1) {
+  ASSERT(values.size() == mesh.size() * stride);
+  std::vector<T> full(mesh.full_size() * stride);
+  for (std::size_t p = 0; p < mesh.full_size(); p++) {
+    std::copy(values.begin() + mesh.map[p] * stride,
+              values.begin() + (mesh.map[p] + 1) * stride,
+              full.begin() + p * stride);
+  }
+  return full;
+}
+
+#endif  // TIGHTB_SYMMETRY_H
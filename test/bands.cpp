@@ -0,0 +1,125 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/bands.h>
+
+#include <cmath>
+
+namespace {
+
+Lattice<2> hexagonal() {
+  Matrix<double, 2, 2> a{};
+  a.at(0, 0) = 1.0;
+  a.at(1, 0) = 0.5;
+  a.at(1, 1) = std::sqrt(3.0) / 2.0;
+  return Lattice<2>(a);
+}
+
+HoppingTable<2> graphene() {
+  HoppingTable<2> table(2);
+  table.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  return table;
+}
+
+std::map<std::string, Vec<double, 2>> hexagonal_points() {
+  return {{"G", Vec<double, 2>{0.0, 0.0}},
+          {"K", Vec<double, 2>{1.0 / 3.0, 2.0 / 3.0}},
+          {"M", Vec<double, 2>{0.0, 0.5}}};
+}
+
+}  // namespace
+
+TEST(test_bands, path_layout) {
+  KPath<2> path(hexagonal(), hexagonal_points(), {"G", "K", "M", "G"}, 61);
+  EXPECT_EQ(path.size(), 61);
+  auto const& labels = path.labels();
+  ASSERT_EQ(labels.size(), 4);
+  EXPECT_EQ(labels[0].first, 0);
+  EXPECT_EQ(labels[3].first, 60);
+  EXPECT_EQ(labels[1].second, "K");
+
+  Vec<double, 2> k = path.point(labels[1].first);
+  EXPECT_NEAR(k[0], 1.0 / 3.0, 1e-12);
+  EXPECT_NEAR(k[1], 2.0 / 3.0, 1e-12);
+  Vec<double, 2> last = path.point(60);
+  EXPECT_NEAR(last[0], 0.0, 1e-12);
+  EXPECT_NEAR(last[1], 0.0, 1e-12);
+
+  for (std::size_t i = 0; i + 1 < path.size(); i++) {
+    EXPECT_LT(path.distance(i), path.distance(i + 1));
+  }
+  // |GK| : |KM| : |MG| = 2 : 1 : sqrt(3), so points follow the same ratio.
+  double gk = static_cast<double>(labels[1].first);
+  double km = static_cast<double>(labels[2].first - labels[1].first);
+  EXPECT_NEAR(gk / km, 2.0, 0.2);
+}
+
+TEST(test_bands, chain) {
+  Matrix<double, 1, 1> a{};
+  a.at(0, 0) = 1.0;
+  HoppingTable<1> table(1);
+  table.add_hermitian(Vec<int, 1>{1}, 0, 0, -1.0);
+  BlochHamiltonian<1> h(table);
+  KPath<1> path(Lattice<1>(a),
+                {{"G", Vec<double, 1>{0.0}}, {"X", Vec<double, 1>{0.5}}},
+                {"G", "X"}, 11);
+  Bands bands = band_structure(h, path);
+  ASSERT_EQ(bands.points, 11);
+  ASSERT_EQ(bands.bands, 1);
+  for (std::size_t i = 0; i < 11; i++) {
+    double k = path.point(i)[0];
+    EXPECT_NEAR(bands.at(i, 0), -2.0 * std::cos(2.0 * M_PI * k), 1e-12);
+  }
+}
+
+TEST(test_bands, graphene) {
+  HoppingTable<2> table = graphene();
+  BlochHamiltonian<2> h(table);
+  KPath<2> path(hexagonal(), hexagonal_points(), {"G", "K", "M", "G"}, 301);
+  Bands bands = band_structure(h, path);
+  auto const& labels = path.labels();
+  EXPECT_NEAR(bands.at(0, 0), -3.0, 1e-12);
+  EXPECT_NEAR(bands.at(0, 1), 3.0, 1e-12);
+  EXPECT_NEAR(bands.at(labels[1].first, 0), 0.0, 1e-9);
+  EXPECT_NEAR(bands.at(labels[1].first, 1), 0.0, 1e-9);
+  EXPECT_NEAR(bands.at(labels[2].first, 0), -1.0, 1e-12);
+  for (std::size_t i = 0; i < bands.points; i++) {
+    EXPECT_NEAR(bands[i][0], -bands[i][1], 1e-12);
+  }
+}
+
+TEST(test_bands, independent_of_threads) {
+  HoppingTable<2> table = graphene();
+  table.add_hermitian(Vec<int, 2>{1, 0}, 0, 0, 0.2);
+  BlochHamiltonian<2> h(table);
+  KPath<2> path(hexagonal(), hexagonal_points(), {"G", "K", "M", "G"}, 5000);
+
+  std::size_t threads = max_threads();
+  set_max_threads(1);
+  Bands serial = band_structure(h, path);
+  set_max_threads(4);
+  Bands parallel = band_structure(h, path);
+  set_max_threads(threads);
+
+  ASSERT_EQ(serial.energies.size(), parallel.energies.size());
+  for (std::size_t i = 0; i < serial.energies.size(); i++) {
+    EXPECT_NEAR(serial.energies[i], parallel.energies[i], 1e-10);
+  }
+}
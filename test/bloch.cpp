@@ -0,0 +1,108 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/bloch.h>
+
+#include <cmath>
+#include <complex>
+
+namespace {
+
+using complex = std::complex<double>;
+
+// Graphene with nearest-neighbor hopping -1 between sublattices A and B.
+HoppingTable<2> graphene() {
+  HoppingTable<2> table(2);
+  table.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  return table;
+}
+
+}  // namespace
+
+TEST(test_bloch, chain_dispersion) {
+  HoppingTable<1> table(1);
+  table.add_hermitian(Vec<int, 1>{1}, 0, 0, -1.0);
+  BlochHamiltonian<1> h(table);
+  for (double k : {0.0, 0.1, 0.25, 0.5}) {
+    Matrix<complex, 1, 1> hk = h.build<1>(Vec<double, 1>{k});
+    EXPECT_NEAR(hk.at(0, 0).real(), -2.0 * std::cos(2.0 * M_PI * k), 1e-12);
+    EXPECT_NEAR(hk.at(0, 0).imag(), 0.0, 1e-12);
+  }
+}
+
+TEST(test_bloch, graphene_dirac_point) {
+  HoppingTable<2> table = graphene();
+  BlochHamiltonian<2> h(table);
+  BlochWorkspace w;
+  std::vector<complex> hk(4);
+
+  h.build(Vec<double, 2>{0.0, 0.0}, hk.data(), w);
+  EXPECT_NEAR(std::abs(hk[1] - complex(-3.0)), 0.0, 1e-12);
+
+  h.build(Vec<double, 2>{1.0 / 3.0, 2.0 / 3.0}, hk.data(), w);
+  EXPECT_NEAR(std::abs(hk[1]), 0.0, 1e-12);
+  EXPECT_NEAR(std::abs(hk[2]), 0.0, 1e-12);
+}
+
+TEST(test_bloch, hermitian) {
+  HoppingTable<2> table = graphene();
+  table.add_hermitian(Vec<int, 2>{1, 1}, 0, 0, complex(0.0, 0.1));
+  BlochHamiltonian<2> h(table);
+  Matrix<complex, 2, 2> hk = h.build<2>(Vec<double, 2>{0.17, -0.31});
+  EXPECT_NEAR(std::abs(hk.at(0, 1) - std::conj(hk.at(1, 0))), 0.0, 1e-12);
+  EXPECT_NEAR(hk.at(0, 0).imag(), 0.0, 1e-12);
+}
+
+TEST(test_bloch, walk_matches_direct_evaluation) {
+  HoppingTable<2> table = graphene();
+  table.add_hermitian(Vec<int, 2>{2, -1}, 1, 1, complex(0.3, 0.2));
+  BlochHamiltonian<2> h(table);
+  BlochWorkspace w;
+  BlochWorkspace direct;
+  std::vector<complex> expected(4);
+  Vec<double, 2> start{0.1, -0.2};
+  Vec<double, 2> step{0.0013, 0.0021};
+  std::size_t visited = 0;
+  h.walk(start, step, 1000, w, [&](std::size_t i, complex const* hk) {
+    h.build(start + step * static_cast<double>(i), expected.data(), direct);
+    for (std::size_t j = 0; j < 4; j++) {
+      EXPECT_NEAR(std::abs(hk[j] - expected[j]), 0.0, 1e-12);
+    }
+    visited++;
+  });
+  EXPECT_EQ(visited, 1000);
+}
+
+TEST(test_bloch, mesh_visits_every_point) {
+  HoppingTable<2> table = graphene();
+  BlochHamiltonian<2> h(table);
+  BlochWorkspace w;
+  BlochWorkspace direct;
+  std::vector<complex> expected(4);
+  std::vector<int> seen(12, 0);
+  h.mesh({3, 4}, Vec<double, 2>{0.5, 0.5}, w,
+         [&](std::size_t i, complex const* hk) {
+           seen[i]++;
+           Vec<double, 2> k{(i / 4 + 0.5) / 3.0, (i % 4 + 0.5) / 4.0};
+           h.build(k, expected.data(), direct);
+           EXPECT_NEAR(std::abs(hk[1] - expected[1]), 0.0, 1e-12);
+         });
+  EXPECT_THAT(seen, ::testing::Each(1));
+}
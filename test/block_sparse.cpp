@@ -0,0 +1,119 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/block_sparse.h>
+#include <tightb/bloch.h>
+
+#include <cmath>
+#include <complex>
+#include <random>
+
+namespace {
+
+using complex = std::complex<double>;
+
+Graph ring(std::size_t n) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t v = 0; v < n; v++) bonds.emplace_back(v, (v + 1) % n);
+  return {n, bonds};
+}
+
+// Checks the block product against the same matrix expanded to scalars.
+void check_multiply(std::size_t b) {
+  std::size_t n = 9;
+  Graph g = ring(n);
+  BlockSparseMatrix<complex> h(g, b);
+  std::mt19937 rng(b);
+  std::normal_distribution<double> normal;
+  std::vector<complex> block(b * b);
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t j : {i, (i + 1) % n, (i + n - 1) % n}) {
+      for (auto& x : block) x = {normal(rng), normal(rng)};
+      h.add_block(i, j, block.data());
+    }
+  }
+
+  std::vector<complex> x(h.dimension());
+  for (auto& v : x) v = {normal(rng), normal(rng)};
+  std::vector<complex> y(h.dimension());
+  h.multiply(x.data(), y.data());
+
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t r = 0; r < b; r++) {
+      complex expected{};
+      for (std::size_t j = 0; j < n; j++) {
+        if (h.find(i, j) == h.npos) continue;
+        complex const* blk = h.block(i, j);
+        for (std::size_t c = 0; c < b; c++) {
+          expected += blk[r * b + c] * x[j * b + c];
+        }
+      }
+      EXPECT_NEAR(std::abs(y[i * b + r] - expected), 0.0, 1e-12);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(test_block_sparse, dispatch_orbitals) {
+  auto fixed = [](std::size_t n) {
+    return dispatch_orbitals(n, [](auto N) { return decltype(N)::value; });
+  };
+  EXPECT_EQ(fixed(1), 1);
+  EXPECT_EQ(fixed(5), 5);
+  EXPECT_EQ(fixed(16), 16);
+  EXPECT_EQ(fixed(17), 0);
+  EXPECT_EQ(fixed(0), 0);
+}
+
+TEST(test_block_sparse, multiply_fixed_and_generic) {
+  check_multiply(1);
+  check_multiply(5);
+  check_multiply(16);
+  check_multiply(19);
+}
+
+TEST(test_block_sparse, bloch_accumulate_any_orbital_count) {
+  for (std::size_t n : {3, 10, 18}) {
+    HoppingTable<1> table(n);
+    std::mt19937 rng(n);
+    std::normal_distribution<double> normal;
+    for (int r = -2; r <= 2; r++) {
+      for (std::size_t a = 0; a < n; a++) {
+        for (std::size_t b = 0; b < n; b++) {
+          table.add(Vec<int, 1>{r}, a, b, {normal(rng), normal(rng)});
+        }
+      }
+    }
+    BlochHamiltonian<1> h(table);
+    BlochWorkspace w;
+    std::vector<complex> hk(n * n);
+    double k = 0.123;
+    h.build(Vec<double, 1>{k}, hk.data(), w);
+    for (std::size_t a = 0; a < n; a++) {
+      for (std::size_t b = 0; b < n; b++) {
+        complex expected{};
+        for (std::size_t r = 0; r < table.translations(); r++) {
+          double phase = 2.0 * M_PI * k * table.translation(r)[0];
+          expected += table.at(r, a, b) * std::polar(1.0, phase);
+        }
+        EXPECT_NEAR(std::abs(hk[a * n + b] - expected), 0.0, 1e-12);
+      }
+    }
+  }
+}
@@ -0,0 +1,110 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/coloring.h>
+#include <tightb/parallel.h>
+
+namespace {
+
+Graph square_grid(std::size_t nx, std::size_t ny) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t x = 0; x < nx; x++) {
+    for (std::size_t y = 0; y < ny; y++) {
+      std::size_t v = x * ny + y;
+      if (x + 1 < nx) bonds.emplace_back(v, v + ny);
+      if (y + 1 < ny) bonds.emplace_back(v, v + 1);
+    }
+  }
+  return {nx * ny, bonds};
+}
+
+// Open triangular grid: the square grid plus one diagonal per plaquette.
+Graph triangular_grid(std::size_t nx, std::size_t ny) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t x = 0; x < nx; x++) {
+    for (std::size_t y = 0; y < ny; y++) {
+      std::size_t v = x * ny + y;
+      if (x + 1 < nx) bonds.emplace_back(v, v + ny);
+      if (y + 1 < ny) bonds.emplace_back(v, v + 1);
+      if (x + 1 < nx && y + 1 < ny) bonds.emplace_back(v, v + ny + 1);
+    }
+  }
+  return {nx * ny, bonds};
+}
+
+}  // namespace
+
+TEST(test_coloring, distance_one) {
+  Graph g = square_grid(30, 30);
+  Coloring c = color_graph(g);
+  EXPECT_LE(c.colors(), 5);
+  for (std::size_t v = 0; v < g.size(); v++) {
+    for (std::size_t u : g.neighbors(v)) EXPECT_NE(c.color[u], c.color[v]);
+  }
+}
+
+TEST(test_coloring, distance_two) {
+  Graph g = square_grid(30, 30);
+  Coloring c = color_graph(g, 2);
+  EXPECT_EQ(c.distance, 2);
+  EXPECT_LE(c.colors(), 13);
+  for (std::size_t v = 0; v < g.size(); v++) {
+    for (std::size_t u : g.neighbors(v)) {
+      EXPECT_NE(c.color[u], c.color[v]);
+      for (std::size_t w : g.neighbors(u)) {
+        if (w != v) {
+          EXPECT_NE(c.color[w], c.color[v]);
+        }
+      }
+    }
+  }
+}
+
+TEST(test_coloring, color_classes) {
+  Graph g = square_grid(7, 5);
+  Coloring c = color_graph(g);
+  EXPECT_EQ(c.vertices.size(), g.size());
+  for (std::size_t k = 0; k < c.colors(); k++) {
+    for (std::size_t i = c.offsets[k]; i < c.offsets[k + 1]; i++) {
+      EXPECT_EQ(c.color[c.vertices[i]], k);
+    }
+  }
+}
+
+TEST(test_coloring, threads_give_the_same_coloring) {
+  // Large enough that every Jones-Plassmann round starts out split between
+  // threads.
+  Graph g = triangular_grid(250, 250);
+  std::size_t threads = max_threads();
+  set_max_threads(1);
+  Coloring serial = color_graph(g, 2);
+  set_max_threads(4);
+  Coloring parallel = color_graph(g, 2);
+  set_max_threads(threads);
+  EXPECT_EQ(parallel.color, serial.color);
+  for (std::size_t v = 0; v < g.size(); v++) {
+    for (std::size_t u : g.neighbors(v)) {
+      EXPECT_NE(parallel.color[u], parallel.color[v]);
+      for (std::size_t w : g.neighbors(u)) {
+        if (w != v) {
+          EXPECT_NE(parallel.color[w], parallel.color[v]);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,223 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/eigen.h>
+
+#include <complex>
+#include <random>
+
+using ::testing::DoubleNear;
+using ::testing::ElementsAre;
+
+namespace {
+
+using complex = std::complex<double>;
+
+std::vector<complex> random_hermitian(std::size_t n, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> normal;
+  std::vector<complex> a(n * n);
+  for (std::size_t i = 0; i < n; i++) {
+    a[i * n + i] = normal(rng);
+    for (std::size_t j = i + 1; j < n; j++) {
+      a[i * n + j] = {normal(rng), normal(rng)};
+      a[j * n + i] = std::conj(a[i * n + j]);
+    }
+  }
+  return a;
+}
+
+}  // namespace
+
+TEST(test_eigen, real_symmetric_eigenvalues) {
+  std::vector<double> a{2.0, -1.0, 0.0, -1.0, 2.0, -1.0, 0.0, -1.0, 2.0};
+  std::vector<double> w(3);
+  EigenWorkspace<double> ws;
+  hermitian_eigenvalues(3, a.data(), w.data(), ws);
+  double r = std::sqrt(2.0);
+  EXPECT_THAT(w, ElementsAre(DoubleNear(2.0 - r, 1e-12), DoubleNear(2.0, 1e-12),
+                             DoubleNear(2.0 + r, 1e-12)));
+}
+
+TEST(test_eigen, pauli_y) {
+  std::vector<complex> a{0.0, complex(0.0, -1.0), complex(0.0, 1.0), 0.0};
+  std::vector<double> w(2);
+  EigenWorkspace<complex> ws;
+  hermitian_eigensystem(2, a.data(), w.data(), ws);
+  EXPECT_THAT(w, ElementsAre(DoubleNear(-1.0, 1e-12), DoubleNear(1.0, 1e-12)));
+  // sigma_y |v> = -|v> for the first eigenvector.
+  complex v0 = a[0];
+  complex v1 = a[1];
+  EXPECT_NEAR(std::abs(complex(0.0, -1.0) * v1 + v0), 0.0, 1e-12);
+}
+
+TEST(test_eigen, random_hermitian_decomposition) {
+  std::size_t n = 12;
+  std::vector<complex> original = random_hermitian(n, 7);
+  std::vector<complex> a = original;
+  std::vector<double> w(n);
+  EigenWorkspace<complex> ws;
+  hermitian_eigensystem(n, a.data(), w.data(), ws);
+
+  for (std::size_t i = 0; i + 1 < n; i++) EXPECT_LE(w[i], w[i + 1]);
+  for (std::size_t i = 0; i < n; i++) {
+    // A v_i = w_i v_i
+    for (std::size_t r = 0; r < n; r++) {
+      complex av{};
+      for (std::size_t c = 0; c < n; c++) {
+        av += original[r * n + c] * a[i * n + c];
+      }
+      EXPECT_NEAR(std::abs(av - w[i] * a[i * n + r]), 0.0, 1e-10);
+    }
+    // <v_i|v_j> = delta_ij
+    for (std::size_t j = 0; j < n; j++) {
+      complex dot{};
+      for (std::size_t k = 0; k < n; k++) {
+        dot += std::conj(a[i * n + k]) * a[j * n + k];
+      }
+      EXPECT_NEAR(std::abs(dot - (i == j ? 1.0 : 0.0)), 0.0, 1e-10);
+    }
+  }
+
+  std::vector<complex> b = original;
+  std::vector<double> values(n);
+  hermitian_eigenvalues(n, b.data(), values.data(), ws);
+  for (std::size_t i = 0; i < n; i++) EXPECT_NEAR(values[i], w[i], 1e-10);
+}
+
+TEST(test_eigen, degenerate_spectrum) {
+  std::vector<double> a(16, 0.0);
+  for (std::size_t i = 0; i < 4; i++) a[i * 4 + i] = 1.0;
+  std::vector<double> w(4);
+  EigenWorkspace<double> ws;
+  hermitian_eigensystem(4, a.data(), w.data(), ws);
+  EXPECT_THAT(w, ::testing::Each(DoubleNear(1.0, 1e-14)));
+}
+
+TEST(test_eigen, real_fast_path_matches_complex) {
+  std::size_t n = 9;
+  std::vector<complex> original = random_hermitian(n, 11);
+  // Time-reversal invariant momenta leave rounding-level imaginary parts.
+  for (auto& x : original) x = {x.real(), 1e-17 * x.real()};
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t j = 0; j < i; j++) {
+      original[i * n + j] = std::conj(original[j * n + i]);
+    }
+  }
+  EXPECT_TRUE(detail::effectively_real(n, original.data()));
+
+  std::vector<complex> a = original;
+  std::vector<double> w(n);
+  EigenWorkspace<complex> ws;
+  hermitian_eigensystem(n, a.data(), w.data(), ws);
+  EXPECT_FALSE(ws.real.empty());
+  EXPECT_TRUE(ws.offdiagonal.empty());
+
+  std::vector<double> real(n * n);
+  for (std::size_t i = 0; i < n * n; i++) real[i] = original[i].real();
+  std::vector<double> expected(n);
+  EigenWorkspace<double> real_ws;
+  hermitian_eigenvalues(n, real.data(), expected.data(), real_ws);
+  for (std::size_t i = 0; i < n; i++) {
+    EXPECT_NEAR(w[i], expected[i], 1e-12);
+    for (std::size_t r = 0; r < n; r++) {
+      complex av{};
+      for (std::size_t c = 0; c < n; c++) {
+        av += original[r * n + c] * a[i * n + c];
+      }
+      EXPECT_NEAR(std::abs(av - w[i] * a[i * n + r]), 0.0, 1e-10);
+    }
+  }
+
+  std::vector<complex> b = random_hermitian(n, 11);
+  EXPECT_FALSE(detail::effectively_real(n, b.data()));
+
+  // In small units the imaginary parts are still genuine.
+  for (complex& x : b) x *= 1e-16;
+  EXPECT_FALSE(detail::effectively_real(n, b.data()));
+  for (complex& x : a) x = {1e-16 * x.real(), 0.0};
+  EXPECT_TRUE(detail::effectively_real(n, a.data()));
+  std::vector<complex> zero(n * n);
+  EXPECT_TRUE(detail::effectively_real(n, zero.data()));
+  zero[1] = complex(0.0, 1e-300);
+  zero[n] = complex(0.0, -1e-300);
+  EXPECT_FALSE(detail::effectively_real(n, zero.data()));
+}
+
+TEST(test_eigen, band_eigenvalues) {
+  std::size_t n = 40;
+  std::size_t b = 3;
+  std::mt19937 rng(5);
+  std::normal_distribution<double> normal;
+  std::vector<complex> band(n * (b + 1));
+  std::vector<complex> dense(n * n);
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t j = 0; j <= b && i + j < n; j++) {
+      complex x = {normal(rng), j == 0 ? 0.0 : normal(rng)};
+      band[i * (b + 1) + j] = x;
+      dense[i * n + i + j] = x;
+      dense[(i + j) * n + i] = std::conj(x);
+    }
+  }
+
+  std::vector<double> expected(n);
+  EigenWorkspace<complex> ws;
+  hermitian_eigenvalues(n, dense.data(), expected.data(), ws);
+  std::vector<double> w(n);
+  BandWorkspace<complex> work;
+  band_eigenvalues(n, b, band.data(), w.data(), work);
+  for (std::size_t i = 0; i < n; i++) EXPECT_NEAR(w[i], expected[i], 1e-10);
+
+  // Two interleaved copies: every level is doubly degenerate.
+  std::vector<complex> wide(2 * n * (2 * b + 1));
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t j = 0; j <= b && i + j < n; j++) {
+      for (std::size_t copy = 0; copy < 2; copy++) {
+        wide[(2 * i + copy) * (2 * b + 1) + 2 * j] = band[i * (b + 1) + j];
+      }
+    }
+  }
+  std::vector<double> pairs(2 * n);
+  band_eigenvalues(2 * n, 2 * b, wide.data(), pairs.data(), work);
+  for (std::size_t i = 0; i < n; i++) {
+    EXPECT_NEAR(pairs[2 * i], expected[i], 1e-10);
+    EXPECT_NEAR(pairs[2 * i + 1], expected[i], 1e-10);
+  }
+
+  // A bandwidth past the matrix keeps the caller's row stride; the entries
+  // beyond the last column are ignored.
+  std::size_t m = 5;
+  std::size_t over = 7;
+  std::vector<complex> full(m * (over + 1), complex(99.0, 99.0));
+  std::vector<complex> small(m * m);
+  for (std::size_t i = 0; i < m; i++) {
+    for (std::size_t j = 0; i + j < m; j++) {
+      complex x = {normal(rng), j == 0 ? 0.0 : normal(rng)};
+      full[i * (over + 1) + j] = x;
+      small[i * m + i + j] = x;
+      small[(i + j) * m + i] = std::conj(x);
+    }
+  }
+  std::vector<double> reference(m);
+  hermitian_eigenvalues(m, small.data(), reference.data(), ws);
+  std::vector<double> clamped(m);
+  band_eigenvalues(m, over, full.data(), clamped.data(), work);
+  for (std::size_t i = 0; i < m; i++) {
+    EXPECT_NEAR(clamped[i], reference[i], 1e-10);
+  }
+}
@@ -0,0 +1,156 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/ensemble.h>
+#include <tightb/random.h>
+
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using complex = std::complex<double>;
+
+SparseMatrix<complex> chain(std::size_t n) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t i = 0; i + 1 < n; i++) bonds.emplace_back(i, i + 1);
+  SparseMatrix<complex> h(Graph(n, bonds));
+  for (std::size_t i = 0; i + 1 < n; i++) {
+    h.at(i, i + 1) = -1.0;
+    h.at(i + 1, i) = -1.0;
+  }
+  return h;
+}
+
+// Trace and sum of |H_ij|^2 as a cheap observable.
+void moments(std::uint64_t, SparseMatrix<complex> const& h, double* out) {
+  out[0] = 0.0;
+  out[1] = 0.0;
+  for (std::size_t i = 0; i < h.size(); i++) {
+    for (std::size_t k = h.offsets()[i]; k < h.offsets()[i + 1]; k++) {
+      if (h.columns()[k] == i) out[0] += h.values()[k].real();
+      out[1] += std::norm(h.values()[k]);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(test_ensemble, philox_known_answers) {
+  // Known-answer vectors of the Random123 reference implementation.
+  Philox zero(0);
+  EXPECT_EQ(zero({0, 0, 0, 0}),
+            (Philox::Block{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+  Philox ones(0xffffffffffffffffULL);
+  EXPECT_EQ(ones({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}),
+            (Philox::Block{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+  Philox pi(0x299f31d0a4093822ULL);
+  EXPECT_EQ(pi({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}),
+            (Philox::Block{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(test_ensemble, random_stream) {
+  RandomStream a(7, 3);
+  RandomStream b(7, 3, 100);
+  for (int i = 0; i < 100; i++) a.uniform();
+  EXPECT_EQ(a.uniform(), b.uniform());
+
+  RandomStream normal(11, 0);
+  EnsembleAverage average(1);
+  for (int i = 0; i < 20000; i++) {
+    double x = normal.normal();
+    average.add(&x);
+  }
+  EXPECT_NEAR(average.mean()[0], 0.0, 0.03);
+  EXPECT_NEAR(average.variance(0), 1.0, 0.05);
+}
+
+TEST(test_ensemble, merge_matches_single_pass) {
+  std::vector<double> xs;
+  RandomStream stream(1, 0);
+  for (int i = 0; i < 1000; i++) xs.push_back(10.0 + stream.uniform());
+
+  EnsembleAverage whole(1);
+  for (double& x : xs) whole.add(&x);
+  EnsembleAverage left(1);
+  EnsembleAverage right(1);
+  for (std::size_t i = 0; i < xs.size(); i++) {
+    (i < 313 ? left : right).add(&xs[i]);
+  }
+  left.merge(right);
+  EXPECT_EQ(left.count(), 1000);
+  EXPECT_NEAR(left.mean()[0], whole.mean()[0], 1e-12);
+  EXPECT_NEAR(left.variance(0), whole.variance(0), 1e-12);
+  EXPECT_NEAR(whole.variance(0), 1.0 / 12.0, 0.01);
+}
+
+TEST(test_ensemble, disorder_is_hermitian_and_reproducible) {
+  SparseMatrix<complex> base = chain(50);
+  Disorder disorder{2.0, 0.5};
+  SparseMatrix<complex> h = base;
+  apply_disorder(base, disorder, 42, 17, h);
+  for (std::size_t i = 0; i < h.size(); i++) {
+    EXPECT_LE(std::abs(h.at(i, i).real()), 1.0);
+    for (std::size_t k = h.offsets()[i]; k < h.offsets()[i + 1]; k++) {
+      std::size_t j = h.columns()[k];
+      EXPECT_EQ(h.values()[k], std::conj(h.at(j, i)));
+    }
+  }
+  SparseMatrix<complex> again = base;
+  apply_disorder(base, disorder, 42, 17, again);
+  EXPECT_EQ(h.values(), again.values());
+  apply_disorder(base, disorder, 42, 18, again);
+  EXPECT_NE(h.values(), again.values());
+}
+
+TEST(test_ensemble, run_ensemble) {
+  SparseMatrix<complex> base = chain(200);
+  Disorder disorder{1.0, 0.0};
+  std::size_t threads = max_threads();
+  set_max_threads(1);
+  EnsembleAverage one = run_ensemble(base, disorder, 5, 0, 300, 2, moments);
+  set_max_threads(4);
+  EnsembleAverage four = run_ensemble(base, disorder, 5, 0, 300, 2, moments);
+  set_max_threads(threads);
+
+  EXPECT_EQ(one.count(), 300);
+  EXPECT_EQ(std::memcmp(one.mean().data(), four.mean().data(),
+                        2 * sizeof(double)),
+            0);
+  EXPECT_EQ(one.variance(0), four.variance(0));
+
+  // The trace is a sum of 200 deviates of variance 1/12.
+  EXPECT_NEAR(one.mean()[0], 0.0, 4.0 * one.standard_error(0));
+  EXPECT_NEAR(one.variance(0), 200.0 / 12.0, 3.0);
+
+  // Realization 123 on its own gives what the ensemble saw.
+  double seen[2] = {};
+  run_ensemble(base, disorder, 5, 0, 300, 2,
+               [&](std::uint64_t r, SparseMatrix<complex> const& h,
+                   double* out) {
+                 moments(r, h, out);
+                 if (r == 123) std::memcpy(seen, out, sizeof(seen));
+               });
+  SparseMatrix<complex> h = base;
+  apply_disorder(base, disorder, 5, 123, h);
+  double alone[2];
+  moments(123, h, alone);
+  EXPECT_EQ(std::memcmp(seen, alone, sizeof(seen)), 0);
+}
@@ -0,0 +1,51 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/graph.h>
+
+using ::testing::ElementsAre;
+
+TEST(test_graph, empty) {
+  Graph g;
+  EXPECT_EQ(g.size(), 0);
+  EXPECT_EQ(g.bonds(), 0);
+}
+
+TEST(test_graph, build_from_bonds) {
+  Graph g(4, {{0, 1}, {1, 2}, {2, 3}, {3, 0}});
+  EXPECT_EQ(g.size(), 4);
+  EXPECT_EQ(g.bonds(), 4);
+  EXPECT_EQ(g.degree(0), 2);
+  EXPECT_THAT(g.neighbors(0), ElementsAre(1, 3));
+  EXPECT_THAT(g.neighbors(2), ElementsAre(1, 3));
+}
+
+TEST(test_graph, drops_repeated_bonds_and_self_loops) {
+  Graph g(3, {{0, 1}, {1, 0}, {1, 1}, {2, 1}});
+  EXPECT_EQ(g.bonds(), 2);
+  EXPECT_THAT(g.neighbors(1), ElementsAre(0, 2));
+  EXPECT_THAT(g.offsets(), ElementsAre(0, 1, 3, 4));
+}
+
+TEST(test_graph, has_bond) {
+  Graph g(3, {{0, 1}, {1, 2}});
+  EXPECT_TRUE(g.has_bond(0, 1));
+  EXPECT_TRUE(g.has_bond(2, 1));
+  EXPECT_FALSE(g.has_bond(0, 2));
+}
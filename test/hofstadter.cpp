@@ -0,0 +1,178 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/bloch.h>
+#include <tightb/eigen.h>
+#include <tightb/hofstadter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+using complex = std::complex<double>;
+
+UnitCell<2> graphene_cell() {
+  UnitCell<2> cell(Lattice<2>({{1.0, 0.0}, {0.5, std::sqrt(3.0) / 2}}));
+  cell.add_site(Vec<double, 2>{1.0 / 3, 1.0 / 3});
+  cell.add_site(Vec<double, 2>{2.0 / 3, 2.0 / 3});
+  return cell;
+}
+
+HoppingTable<2> graphene_table() {
+  HoppingTable<2> table(2);
+  table.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{1, 0}, 0, 0, 0.1);
+  return table;
+}
+
+}  // namespace
+
+TEST(test_hofstadter, farey_fluxes) {
+  std::vector<Flux> fluxes = farey_fluxes(5);
+  EXPECT_EQ(fluxes.size(), 11);
+  EXPECT_EQ(fluxes.front().p, 0);
+  EXPECT_EQ(fluxes.back().q, 5);
+  for (auto const& f : fluxes) EXPECT_EQ(std::gcd(f.p, f.q), 1);
+}
+
+TEST(test_hofstadter, matches_dense_magnetic_cell) {
+  UnitCell<2> cell = graphene_cell();
+  HoppingTable<2> table = graphene_table();
+  Vec<double, 2> k{0.23, -0.31};
+  HofstadterSweep<2> sweep(cell, table, {k});
+
+  std::vector<double> energies;
+  std::vector<complex> band;
+  BandWorkspace<complex> work;
+  for (Flux flux :
+       {Flux{0, 1}, Flux{1, 2}, Flux{2, 7}, Flux{-2, 7}, Flux{5, 12}}) {
+    sweep.spectrum(flux, 0, energies, band, work);
+
+    MagneticCell<2> magnetic(cell, table, flux.p, flux.q);
+    std::size_t n = magnetic.table().orbitals();
+    std::vector<complex> h(n * n);
+    BlochWorkspace w;
+    BlochHamiltonian<2>(magnetic.table()).build(k, h.data(), w);
+    std::vector<double> expected(n);
+    EigenWorkspace<complex> ws;
+    hermitian_eigenvalues(n, h.data(), expected.data(), ws);
+
+    ASSERT_EQ(energies.size(), n);
+    for (std::size_t i = 0; i < n; i++) {
+      EXPECT_NEAR(energies[i], expected[i], 1e-9);
+    }
+  }
+}
+
+TEST(test_hofstadter, sweep_and_file) {
+  UnitCell<2> cell = graphene_cell();
+  HoppingTable<2> table = graphene_table();
+  HofstadterSweep<2> sweep(
+      cell, table, {Vec<double, 2>{0.0, 0.0}, Vec<double, 2>{0.5, 0.0}});
+  std::vector<Flux> fluxes = farey_fluxes(8);
+
+  std::size_t threads = max_threads();
+  set_max_threads(3);
+  std::vector<FluxSpectrum> collected;
+  sweep.run(fluxes,
+            [&](FluxSpectrum const& s) { collected.push_back(s); });
+  std::stringstream file;
+  sweep.write(file, fluxes);
+  set_max_threads(threads);
+
+  EXPECT_EQ(collected.size(), 2 * fluxes.size());
+  std::vector<FluxSpectrum> read = read_hofstadter(file);
+  ASSERT_EQ(read.size(), collected.size());
+
+  auto order = [](FluxSpectrum const& x, FluxSpectrum const& y) {
+    return std::tie(x.flux.q, x.flux.p, x.k) <
+           std::tie(y.flux.q, y.flux.p, y.k);
+  };
+  std::sort(collected.begin(), collected.end(), order);
+  std::sort(read.begin(), read.end(), order);
+  for (std::size_t i = 0; i < read.size(); i++) {
+    EXPECT_EQ(read[i].flux.p, collected[i].flux.p);
+    EXPECT_EQ(read[i].flux.q, collected[i].flux.q);
+    EXPECT_EQ(read[i].k, collected[i].k);
+    ASSERT_EQ(read[i].energies.size(), 2 * collected[i].flux.q);
+    for (std::size_t e = 0; e < read[i].energies.size(); e++) {
+      EXPECT_NEAR(read[i].energies[e], collected[i].energies[e], 1e-5);
+    }
+  }
+}
+
+TEST(test_hofstadter, reversed_field_round_trips) {
+  std::stringstream file;
+  write_hofstadter_header(file);
+  write_spectrum(file, {{-3, 7}, 2, std::vector<double>(7, 0.25)});
+  std::vector<FluxSpectrum> read = read_hofstadter(file);
+  ASSERT_EQ(read.size(), 1);
+  EXPECT_EQ(read[0].flux.p, -3);
+  EXPECT_EQ(read[0].flux.q, 7);
+  EXPECT_EQ(read[0].k, 2u);
+  EXPECT_EQ(read[0].energies, std::vector<double>(7, 0.25));
+}
+
+TEST(test_hofstadter, non_positive_denominator_aborts) {
+  UnitCell<2> cell = graphene_cell();
+  HoppingTable<2> table = graphene_table();
+  HofstadterSweep<2> sweep(cell, table, {Vec<double, 2>{0.0, 0.0}});
+  std::vector<double> energies;
+  std::vector<complex> band;
+  BandWorkspace<complex> work;
+  EXPECT_DEATH(sweep.spectrum({1, -3}, 0, energies, band, work),
+               "non-positive denominator");
+  EXPECT_DEATH(sweep.spectrum({1, 0}, 0, energies, band, work),
+               "non-positive denominator");
+}
+
+TEST(test_hofstadter, corrupt_file_aborts) {
+  auto record = [](std::uint32_t q, std::uint32_t count) {
+    std::stringstream file;
+    write_hofstadter_header(file);
+    for (std::uint32_t word : {std::uint32_t{1}, q, std::uint32_t{0}, count}) {
+      file.write(reinterpret_cast<char const*>(&word), sizeof(word));
+    }
+    float energy = 0.5f;
+    file.write(reinterpret_cast<char const*>(&energy), sizeof(energy));
+    return file;
+  };
+  // A count far past the data fails as truncated rather than allocating it.
+  EXPECT_DEATH(
+      {
+        std::stringstream file = record(4, 0xfffffff0u);
+        read_hofstadter(file);
+      },
+      "truncated Hofstadter file");
+  EXPECT_DEATH(
+      {
+        std::stringstream file = record(0, 1);
+        read_hofstadter(file);
+      },
+      "corrupt Hofstadter record");
+  std::stringstream file = record(1, 1);
+  std::vector<FluxSpectrum> read = read_hofstadter(file);
+  ASSERT_EQ(read.size(), 1);
+  EXPECT_EQ(read[0].energies, std::vector<double>{0.5});
+}
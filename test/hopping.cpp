@@ -0,0 +1,47 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/hopping.h>
+
+#include <complex>
+
+namespace {
+
+using complex = std::complex<double>;
+
+}  // namespace
+
+TEST(test_hopping, blocks_grouped_by_translation) {
+  HoppingTable<2> table(2);
+  table.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  EXPECT_EQ(table.orbitals(), 2);
+  EXPECT_EQ(table.translations(), 5);
+  std::size_t r = table.find(Vec<int, 2>{1, 0});
+  ASSERT_LT(r, table.translations());
+  EXPECT_EQ(table.at(r, 1, 0), complex(-1.0));
+  EXPECT_EQ(table.at(r, 0, 1), complex(0.0));
+  EXPECT_EQ(table.find(Vec<int, 2>{5, 5}), table.translations());
+}
+
+TEST(test_hopping, onsite_added_once) {
+  HoppingTable<1> table(1);
+  table.add_hermitian(Vec<int, 1>{0}, 0, 0, 2.0);
+  EXPECT_EQ(table.at(0, 0, 0), complex(2.0));
+}
@@ -0,0 +1,197 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/interpolation.h>
+
+#include <cmath>
+#include <complex>
+
+namespace {
+
+using complex = std::complex<double>;
+
+Lattice<2> hexagonal() {
+  Matrix<double, 2, 2> a{};
+  a.at(0, 0) = 1.0;
+  a.at(1, 0) = 0.5;
+  a.at(1, 1) = std::sqrt(3.0) / 2.0;
+  return Lattice<2>(a);
+}
+
+HoppingTable<2> graphene() {
+  HoppingTable<2> table(2);
+  table.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{1, 1}, 0, 0, complex(0.1, 0.05));
+  return table;
+}
+
+template <std::size_t D>
+std::vector<complex> sample(HoppingTable<D> const& table,
+                            std::array<std::size_t, D> const& mesh) {
+  BlochHamiltonian<D> h(table);
+  BlochWorkspace w;
+  std::size_t block = table.orbitals() * table.orbitals();
+  std::size_t points = 1;
+  for (std::size_t m : mesh) points *= m;
+  std::vector<complex> hk(points * block);
+  Vec<double, D> shift{};
+  for (std::size_t d = 0; d < D; d++) shift[d] = 0.0;
+  h.mesh(mesh, shift, w, [&](std::size_t i, complex const* values) {
+    std::copy(values, values + block, hk.begin() + i * block);
+  });
+  return hk;
+}
+
+}  // namespace
+
+TEST(test_interpolation, even_mesh_splits_aliased_shell) {
+  HoppingTable<1> chain(1);
+  chain.add_hermitian(Vec<int, 1>{1}, 0, 0, -1.0);
+  std::array<std::size_t, 1> mesh{2};
+  HoppingTable<1> table = fourier_interpolate(mesh, 1, sample(chain, mesh));
+
+  BlochHamiltonian<1> h(table);
+  for (double k : {0.0, 0.13, 0.25, 0.4}) {
+    complex hk = h.build<1>(Vec<double, 1>{k}).at(0, 0);
+    EXPECT_NEAR(std::abs(hk - (-2.0 * std::cos(2.0 * M_PI * k))), 0.0, 1e-12);
+  }
+}
+
+TEST(test_interpolation, reproduces_model_off_mesh) {
+  HoppingTable<2> model = graphene();
+  std::array<std::size_t, 2> mesh{5, 6};
+  HoppingTable<2> table = fourier_interpolate(mesh, 2, sample(model, mesh));
+
+  BlochHamiltonian<2> direct(model);
+  BlochHamiltonian<2> interpolated(table);
+  for (Vec<double, 2> k :
+       {Vec<double, 2>{0.11, 0.37}, Vec<double, 2>{-0.4, 0.9},
+        Vec<double, 2>{1.0 / 3.0, 2.0 / 3.0}}) {
+    auto a = direct.build<2>(k);
+    auto b = interpolated.build<2>(k);
+    for (std::size_t i = 0; i < 2; i++) {
+      for (std::size_t j = 0; j < 2; j++) {
+        EXPECT_NEAR(std::abs(a.at(i, j) - b.at(i, j)), 0.0, 1e-12);
+      }
+    }
+  }
+}
+
+TEST(test_interpolation, chain_velocity) {
+  Matrix<double, 1, 1> a{};
+  a.at(0, 0) = 2.0;
+  HoppingTable<1> chain(1);
+  chain.add_hermitian(Vec<int, 1>{1}, 0, 0, -1.0);
+  BandInterpolator<1> bands(Lattice<1>(a), chain);
+
+  std::vector<Vec<double, 1>> k{Vec<double, 1>{0.0}, Vec<double, 1>{0.1},
+                                Vec<double, 1>{0.25}};
+  std::vector<double> energies(3);
+  std::vector<double> velocities(3);
+  bands.evaluate(3, k.data(), energies.data(), velocities.data());
+  for (std::size_t i = 0; i < 3; i++) {
+    double phase = 2.0 * M_PI * k[i][0];
+    EXPECT_NEAR(energies[i], -2.0 * std::cos(phase), 1e-12);
+    // E = -2 cos(q a), so dE/dq = 2 a sin(q a).
+    EXPECT_NEAR(velocities[i], 4.0 * std::sin(phase), 1e-12);
+  }
+}
+
+TEST(test_interpolation, velocity_matches_finite_difference) {
+  Lattice<2> lattice = hexagonal();
+  BandInterpolator<2> bands(lattice, graphene());
+  Vec<double, 2> k{0.17, 0.29};
+  std::vector<double> energies(2);
+  std::vector<double> velocities(4);
+  bands.evaluate(1, &k, energies.data(), velocities.data());
+
+  double h = 1e-6;
+  for (std::size_t c = 0; c < 2; c++) {
+    Vec<double, 2> dq{};
+    dq[0] = 0.0;
+    dq[1] = 0.0;
+    dq[c] = h;
+    // Cartesian displacement dq in reduced coordinates: a_i . dq / (2 pi).
+    Vec<double, 2> dk = lattice.vectors() * dq * (1.0 / (2.0 * M_PI));
+    std::array<Vec<double, 2>, 2> points{k + dk, k - dk};
+    std::vector<double> shifted(4);
+    bands.evaluate(2, points.data(), shifted.data());
+    for (std::size_t b = 0; b < 2; b++) {
+      double slope = (shifted[b] - shifted[2 + b]) / (2.0 * h);
+      EXPECT_NEAR(velocities[b * 2 + c], slope, 1e-6);
+    }
+  }
+}
+
+TEST(test_interpolation, mesh_matches_points) {
+  BandInterpolator<2> bands(hexagonal(), graphene());
+  std::array<std::size_t, 2> mesh{7, 40};
+  Vec<double, 2> shift{0.5, 0.25};
+  std::vector<double> grid(7 * 40 * 2);
+  bands.evaluate_mesh(mesh, shift, grid.data());
+
+  std::vector<Vec<double, 2>> k;
+  for (std::size_t i = 0; i < 7; i++) {
+    for (std::size_t j = 0; j < 40; j++) {
+      k.push_back(Vec<double, 2>{(i + 0.5) / 7.0, (j + 0.25) / 40.0});
+    }
+  }
+  std::vector<double> direct(k.size() * 2);
+  bands.evaluate(k.size(), k.data(), direct.data());
+  for (std::size_t i = 0; i < grid.size(); i++) {
+    EXPECT_NEAR(grid[i], direct[i], 1e-10);
+  }
+}
+
+TEST(test_interpolation, time_reversal_half_mesh) {
+  HoppingTable<2> model = graphene();
+  EXPECT_FALSE(model.time_reversal_symmetric());
+  HoppingTable<2> real(2);
+  real.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  real.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  real.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  real.add_hermitian(Vec<int, 2>{2, 1}, 0, 1, 0.3);
+  real.add_hermitian(Vec<int, 2>{1, 0}, 1, 1, 0.2);
+  ASSERT_TRUE(real.time_reversal_symmetric());
+
+  BandInterpolator<2> bands(hexagonal(), real);
+  for (std::array<std::size_t, 2> mesh :
+       {std::array<std::size_t, 2>{6, 8}, std::array<std::size_t, 2>{5, 7}}) {
+    for (Vec<double, 2> shift :
+         {Vec<double, 2>{0.0, 0.0}, Vec<double, 2>{0.5, 0.0},
+          Vec<double, 2>{0.25, 0.5}}) {
+      std::vector<double> grid(mesh[0] * mesh[1] * 2);
+      bands.evaluate_mesh(mesh, shift, grid.data());
+
+      std::vector<Vec<double, 2>> k;
+      for (std::size_t i = 0; i < mesh[0]; i++) {
+        for (std::size_t j = 0; j < mesh[1]; j++) {
+          k.push_back(Vec<double, 2>{(i + shift[0]) / mesh[0],
+                                     (j + shift[1]) / mesh[1]});
+        }
+      }
+      std::vector<double> direct(k.size() * 2);
+      bands.evaluate(k.size(), k.data(), direct.data());
+      for (std::size_t i = 0; i < grid.size(); i++) {
+        EXPECT_NEAR(grid[i], direct[i], 1e-10);
+      }
+    }
+  }
+}
@@ -0,0 +1,174 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include <tightb/kpm.h>
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace {
+
+using complex = std::complex<double>;
+
+template <typename T>
+SparseMatrix<T> ring(std::size_t n, double disorder = 0.0) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t i = 0; i < n; i++) bonds.emplace_back(i, (i + 1) % n);
+  SparseMatrix<T> h(Graph(n, bonds));
+  Philox philox(7);
+  for (std::size_t i = 0; i < n; i++) {
+    h.at(i, (i + 1) % n) = -1.0;
+    h.at((i + 1) % n, i) = -1.0;
+    h.at(i, i) = disorder * (philox.uniform(0, i) - 0.5);
+  }
+  return h;
+}
+
+// Moments of a diagonal matrix: the random phases drop out of <r|T_n|r>, so
+// the stochastic trace is exact.
+std::vector<double> diagonal_moments(std::vector<double> const& energies,
+                                     ChebyshevScale const& scale,
+                                     std::size_t moments) {
+  std::vector<double> mu(moments, 0.0);
+  for (double e : energies) {
+    double x = (e - scale.center) / scale.half_width;
+    for (std::size_t n = 0; n < moments; n++) {
+      mu[n] += std::cos(n * std::acos(x)) / energies.size();
+    }
+  }
+  return mu;
+}
+
+template <typename T>
+SparseMatrix<T> diagonal(std::vector<double> const& energies) {
+  SparseMatrix<T> h(Graph(energies.size(), {}));
+  for (std::size_t i = 0; i < energies.size(); i++) h.at(i, i) = energies[i];
+  return h;
+}
+
+}  // namespace
+
+TEST(test_kpm, kernels) {
+  std::vector<double> jackson = kpm_kernel(KpmKernel::Jackson, 64);
+  std::vector<double> lorentz = kpm_kernel(KpmKernel::Lorentz, 64, 4.0);
+  EXPECT_NEAR(jackson[0], 1.0, 1e-14);
+  EXPECT_NEAR(lorentz[0], 1.0, 1e-14);
+  for (std::size_t n = 1; n < 64; n++) {
+    EXPECT_LT(jackson[n], jackson[n - 1]);
+    EXPECT_LT(lorentz[n], lorentz[n - 1]);
+  }
+  EXPECT_LT(jackson.back(), 1e-3);
+  EXPECT_GT(jackson.back(), 0.0);
+}
+
+TEST(test_kpm, chebyshev_sum_is_a_dct) {
+  std::vector<double> c(100);
+  for (std::size_t n = 0; n < c.size(); n++) c[n] = std::sin(0.7 * n + 0.2);
+  for (std::size_t points : {64u, 128u, 50u}) {
+    std::vector<double> y = detail::chebyshev_sum(c, points);
+    for (std::size_t k = 0; k < points; k++) {
+      double theta = M_PI * (k + 0.5) / points;
+      double expected = 0.0;
+      for (std::size_t n = 0; n < c.size(); n++) {
+        expected += c[n] * std::cos(n * theta);
+      }
+      EXPECT_NEAR(y[k], expected, 1e-10) << points << " " << k;
+    }
+  }
+}
+
+TEST(test_kpm, bounds_enclose_the_spectrum) {
+  SparseMatrix<complex> h = ring<complex>(200, 1.0);
+  h.at(0, 1) = complex(-1.0, 0.3);
+  h.at(1, 0) = complex(-1.0, -0.3);
+  std::vector<complex> dense(200 * 200, 0.0);
+  for (std::size_t i = 0; i < 200; i++) {
+    for (std::size_t k = h.offsets()[i]; k < h.offsets()[i + 1]; k++) {
+      dense[i * 200 + h.columns()[k]] = h.values()[k];
+    }
+  }
+  std::vector<double> w(200);
+  EigenWorkspace<complex> ws;
+  hermitian_eigenvalues(200, dense.data(), w.data(), ws);
+
+  SpectralBounds gershgorin = gershgorin_bounds(h);
+  SpectralBounds lanczos = lanczos_bounds(h, 40);
+  EXPECT_LE(gershgorin.min, w.front());
+  EXPECT_GE(gershgorin.max, w.back());
+  EXPECT_LE(lanczos.min, w.front());
+  EXPECT_GE(lanczos.max, w.back());
+  EXPECT_GT(lanczos.min, gershgorin.min);
+  EXPECT_LT(lanczos.max, gershgorin.max);
+}
+
+TEST(test_kpm, moments_of_a_diagonal_matrix_are_exact) {
+  std::vector<double> energies(300);
+  for (std::size_t i = 0; i < energies.size(); i++) {
+    energies[i] = std::sin(1.3 * i) * 2.0 + 0.5;
+  }
+  ChebyshevScale scale({-1.5, 2.5}, 0.05);
+  std::vector<double> expected = diagonal_moments(energies, scale, 41);
+  std::vector<double> complex_mu =
+      kpm_moments(diagonal<complex>(energies), scale, 41, 6, 1, 4);
+  std::vector<double> real_mu =
+      kpm_moments(diagonal<double>(energies), scale, 41, 3, 1, 2);
+  for (std::size_t n = 0; n < expected.size(); n++) {
+    EXPECT_NEAR(complex_mu[n], expected[n], 1e-11) << n;
+    EXPECT_NEAR(real_mu[n], expected[n], 1e-11) << n;
+  }
+}
+
+TEST(test_kpm, moments_do_not_depend_on_blocking_or_threads) {
+  // Enough rows for parallel_for to split the SpMVs over all four threads.
+  SparseMatrix<complex> h = ring<complex>(8192, 0.5);
+  ChebyshevScale scale(gershgorin_bounds(h));
+  std::size_t threads = max_threads();
+  set_max_threads(1);
+  std::vector<double> single = kpm_moments(h, scale, 30, 20, 3, 1);
+  set_max_threads(4);
+  std::vector<double> fixed = kpm_moments(h, scale, 30, 20, 3, 4);
+  std::vector<double> generic = kpm_moments(h, scale, 30, 20, 3, 20);
+  set_max_threads(threads);
+  for (std::size_t n = 0; n < single.size(); n++) {
+    EXPECT_NEAR(single[n], fixed[n], 1e-12) << n;
+    EXPECT_NEAR(single[n], generic[n], 1e-12) << n;
+  }
+}
+
+TEST(test_kpm, chain_density_of_states) {
+  // Clean ring: rho(E) = 1 / (pi sqrt(4 - E^2)).
+  SparseMatrix<double> h = ring<double>(40000);
+  ChebyshevScale scale(lanczos_bounds(h, 40), 0.02);
+  std::vector<double> mu = kpm_moments(h, scale, 256, 8, 11);
+  EXPECT_NEAR(mu[0], 1.0, 1e-12);
+  KpmDensity dos = kpm_density(mu, scale, 512);
+  double total = 0.0;
+  for (std::size_t k = 0; k < dos.energy.size(); k++) {
+    if (k > 0) {
+      EXPECT_GT(dos.energy[k], dos.energy[k - 1]);
+      total += 0.5 * (dos.density[k] + dos.density[k - 1]) *
+               (dos.energy[k] - dos.energy[k - 1]);
+    }
+    double e = dos.energy[k];
+    if (std::abs(e) < 1.5) {
+      double exact = 1.0 / (M_PI * std::sqrt(4.0 - e * e));
+      EXPECT_NEAR(dos.density[k], exact, 0.08 * exact) << e;
+    }
+  }
+  EXPECT_NEAR(total, 1.0, 0.01);
+}
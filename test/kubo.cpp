@@ -0,0 +1,289 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include <tightb/eigen.h>
+#include <tightb/kubo.h>
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace {
+
+using complex = std::complex<double>;
+
+// Qi-Wu-Zhang model on an L x L torus, two orbitals per cell: H(k) = sin kx
+// sx + sin ky sy + (m + cos kx + cos ky) sz. Chern insulator for 0 < |m| < 2.
+struct Qwz {
+  std::size_t L;
+  SparseMatrix<complex> h;
+
+  std::size_t site(std::size_t x, std::size_t y, std::size_t a) const {
+    return ((y % L) * L + x % L) * 2 + a;
+  }
+
+  // Minimum-image bond vector.
+  Vec<double, 2> bond(std::size_t i, std::size_t j) const {
+    auto wrap = [&](long d) {
+      long l = static_cast<long>(L);
+      d = ((d % l) + l) % l;
+      return static_cast<double>(d > l / 2 ? d - l : d);
+    };
+    long xi = static_cast<long>(i / 2 % L);
+    long yi = static_cast<long>(i / 2 / L);
+    long xj = static_cast<long>(j / 2 % L);
+    long yj = static_cast<long>(j / 2 / L);
+    return {wrap(xj - xi), wrap(yj - yi)};
+  }
+};
+
+Qwz qwz(std::size_t L, double mass, double disorder = 0.0) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  Qwz model{L, {}};
+  for (std::size_t y = 0; y < L; y++) {
+    for (std::size_t x = 0; x < L; x++) {
+      bonds.emplace_back(model.site(x, y, 0), model.site(x, y, 1));
+      for (std::size_t a = 0; a < 2; a++) {
+        for (std::size_t b = 0; b < 2; b++) {
+          bonds.emplace_back(model.site(x, y, a), model.site(x + 1, y, b));
+          bonds.emplace_back(model.site(x, y, a), model.site(x, y + 1, b));
+        }
+      }
+    }
+  }
+  model.h = SparseMatrix<complex>(Graph(2 * L * L, bonds));
+  // t(R) = <0|H|R>: t(x) = sx / 2i + sz / 2, t(y) = sy / 2i + sz / 2.
+  complex const i(0.0, 1.0);
+  complex tx[2][2] = {{0.5, 1.0 / (2.0 * i)}, {1.0 / (2.0 * i), -0.5}};
+  complex ty[2][2] = {{0.5, -1.0 / 2.0}, {1.0 / 2.0, -0.5}};
+  Philox philox(5);
+  for (std::size_t y = 0; y < L; y++) {
+    for (std::size_t x = 0; x < L; x++) {
+      for (std::size_t a = 0; a < 2; a++) {
+        std::size_t s = model.site(x, y, a);
+        model.h.at(s, s) = (a == 0 ? mass : -mass) +
+                           disorder * (philox.uniform(0, s) - 0.5);
+        for (std::size_t b = 0; b < 2; b++) {
+          std::size_t u = model.site(x + 1, y, b);
+          std::size_t v = model.site(x, y + 1, b);
+          model.h.at(s, u) += tx[a][b];
+          model.h.at(u, s) += std::conj(tx[a][b]);
+          model.h.at(s, v) += ty[a][b];
+          model.h.at(v, s) += std::conj(ty[a][b]);
+        }
+      }
+    }
+  }
+  return model;
+}
+
+std::vector<complex> dense(SparseMatrix<complex> const& a) {
+  std::size_t n = a.size();
+  std::vector<complex> d(n * n, 0.0);
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t k = a.offsets()[i]; k < a.offsets()[i + 1]; k++) {
+      d[i * n + a.columns()[k]] = a.values()[k];
+    }
+  }
+  return d;
+}
+
+// Kubo (TKNN) Hall conductivity by exact diagonalization, e^2 / hbar units:
+// i / V sum_{i occupied, j empty} [<i|vx|j><j|vy|i> - (x <-> y)] /
+// (e_i - e_j)^2.
+double exact_hall(Qwz const& model, SparseMatrix<complex> const& vx,
+                  SparseMatrix<complex> const& vy, double fermi) {
+  std::size_t n = model.h.size();
+  std::vector<complex> states = dense(model.h);
+  std::vector<double> e(n);
+  EigenWorkspace<complex> ws;
+  hermitian_eigensystem(n, states.data(), e.data(), ws);
+  auto element = [&](SparseMatrix<complex> const& v, std::size_t a,
+                     std::size_t b) {
+    complex sum = 0.0;
+    for (std::size_t i = 0; i < n; i++) {
+      for (std::size_t k = v.offsets()[i]; k < v.offsets()[i + 1]; k++) {
+        sum += std::conj(states[a * n + i]) * v.values()[k] *
+               states[b * n + v.columns()[k]];
+      }
+    }
+    return sum;
+  };
+  complex sigma = 0.0;
+  for (std::size_t a = 0; a < n && e[a] < fermi; a++) {
+    for (std::size_t b = 0; b < n; b++) {
+      if (e[b] < fermi) continue;
+      complex xab = element(vx, a, b);
+      complex yab = element(vy, a, b);
+      double gap = e[a] - e[b];
+      sigma += (xab * std::conj(yab) - yab * std::conj(xab)) / (gap * gap);
+    }
+  }
+  double volume = static_cast<double>(model.L * model.L);
+  return (complex(0.0, 1.0) * sigma / volume).real();
+}
+
+}  // namespace
+
+TEST(test_kubo, velocity_is_hermitian_commutator) {
+  Qwz model = qwz(4, -1.0);
+  auto bond = [&](std::size_t i, std::size_t j) { return model.bond(i, j); };
+  SparseMatrix<complex> vx = velocity_operator(model.h, 0, bond);
+  for (std::size_t i = 0; i < vx.size(); i++) {
+    for (std::size_t k = vx.offsets()[i]; k < vx.offsets()[i + 1]; k++) {
+      std::size_t j = vx.columns()[k];
+      EXPECT_NEAR(std::abs(vx.values()[k] - std::conj(vx.at(j, i))), 0.0,
+                  1e-14);
+      double d = model.bond(i, j)[0];
+      EXPECT_NEAR(
+          std::abs(vx.values()[k] - complex(0.0, d) * model.h.at(i, j)), 0.0,
+          1e-14);
+    }
+  }
+
+  // Open sample: the same as i [H, x] with x the position operator.
+  std::vector<Vec<double, 2>> positions(model.h.size());
+  for (std::size_t i = 0; i < positions.size(); i++) {
+    positions[i] = {static_cast<double>(i / 2 % 4), 0.3 * i};
+  }
+  SparseMatrix<complex> vy = velocity_operator(model.h, positions, 1);
+  for (std::size_t i = 0; i < vy.size(); i++) {
+    for (std::size_t k = vy.offsets()[i]; k < vy.offsets()[i + 1]; k++) {
+      std::size_t j = vy.columns()[k];
+      complex commutator = model.h.values()[k] * (0.3 * j - 0.3 * i);
+      EXPECT_NEAR(std::abs(vy.values()[k] - complex(0.0, 1.0) * commutator),
+                  0.0, 1e-14);
+    }
+  }
+}
+
+TEST(test_kubo, moments_match_exact_traces) {
+  Qwz model = qwz(3, -1.0, 1.0);
+  auto bond = [&](std::size_t i, std::size_t j) { return model.bond(i, j); };
+  SparseMatrix<complex> vx = velocity_operator(model.h, 0, bond);
+  SparseMatrix<complex> vy = velocity_operator(model.h, 1, bond);
+  ChebyshevScale scale(gershgorin_bounds(model.h));
+  std::size_t moments = 6;
+  std::size_t n = model.h.size();
+
+  // T_n(H~) densely, then Tr[vx T_n vy T_m] / N.
+  std::vector<complex> h = dense(model.h);
+  std::vector<std::vector<complex>> t(moments, std::vector<complex>(n * n));
+  for (std::size_t i = 0; i < n; i++) t[0][i * n + i] = 1.0;
+  for (std::size_t p = 1; p < moments; p++) {
+    for (std::size_t i = 0; i < n; i++) {
+      for (std::size_t j = 0; j < n; j++) {
+        complex sum = 0.0;
+        for (std::size_t k = 0; k < n; k++) {
+          complex hik = (h[i * n + k] - (i == k ? scale.center : 0.0)) /
+                        scale.half_width;
+          sum += hik * t[p - 1][k * n + j];
+        }
+        t[p][i * n + j] = p == 1 ? sum : 2.0 * sum - t[p - 2][i * n + j];
+      }
+    }
+  }
+  std::vector<complex> x = dense(vx);
+  std::vector<complex> y = dense(vy);
+  auto product = [&](std::vector<complex> const& a,
+                     std::vector<complex> const& b) {
+    std::vector<complex> c(n * n, 0.0);
+    for (std::size_t i = 0; i < n; i++) {
+      for (std::size_t k = 0; k < n; k++) {
+        for (std::size_t j = 0; j < n; j++) {
+          c[i * n + j] += a[i * n + k] * b[k * n + j];
+        }
+      }
+    }
+    return c;
+  };
+
+  std::size_t threads = max_threads();
+  set_max_threads(1);
+  std::vector<complex> mu = kubo_moments(model.h, vx, vy, scale, moments,
+                                         4000, 9, 4);
+  set_max_threads(3);
+  std::vector<complex> parallel = kubo_moments(model.h, vx, vy, scale,
+                                               moments, 4000, 9, 6);
+  set_max_threads(threads);
+  for (std::size_t p = 0; p < moments; p++) {
+    std::vector<complex> left = product(x, t[p]);
+    for (std::size_t q = 0; q < moments; q++) {
+      std::vector<complex> whole = product(left, product(y, t[q]));
+      complex trace = 0.0;
+      for (std::size_t i = 0; i < n; i++) trace += whole[i * n + i];
+      trace /= static_cast<double>(n);
+      EXPECT_NEAR(std::abs(mu[p * moments + q] - trace), 0.0, 0.02)
+          << p << " " << q;
+      EXPECT_NEAR(std::abs(parallel[p * moments + q] - mu[p * moments + q]),
+                  0.0, 1e-12);
+    }
+  }
+}
+
+TEST(test_kubo, moments_do_not_depend_on_threads) {
+  // 4608 orbitals, enough rows for parallel_for to split the SpMVs and the
+  // tile products over four threads.
+  Qwz model = qwz(48, -1.0, 1.0);
+  auto bond = [&](std::size_t i, std::size_t j) { return model.bond(i, j); };
+  SparseMatrix<complex> vx = velocity_operator(model.h, 0, bond);
+  SparseMatrix<complex> vy = velocity_operator(model.h, 1, bond);
+  ChebyshevScale scale(gershgorin_bounds(model.h));
+  std::size_t moments = 12;
+  std::size_t threads = max_threads();
+  set_max_threads(1);
+  std::vector<complex> serial =
+      kubo_moments(model.h, vx, vy, scale, moments, 2, 5, 5);
+  set_max_threads(4);
+  std::vector<complex> parallel =
+      kubo_moments(model.h, vx, vy, scale, moments, 2, 5, 5);
+  set_max_threads(threads);
+  for (std::size_t k = 0; k < serial.size(); k++) {
+    EXPECT_NEAR(std::abs(parallel[k] - serial[k]), 0.0, 1e-12) << k;
+  }
+}
+
+TEST(test_kubo, hall_conductivity_of_a_chern_insulator) {
+  Qwz model = qwz(10, -1.0);
+  auto bond = [&](std::size_t i, std::size_t j) { return model.bond(i, j); };
+  SparseMatrix<complex> vx = velocity_operator(model.h, 0, bond);
+  SparseMatrix<complex> vy = velocity_operator(model.h, 1, bond);
+  ChebyshevScale scale(gershgorin_bounds(model.h), 0.05);
+  std::size_t moments = 64;
+  std::vector<complex> xy =
+      kubo_moments(model.h, vx, vy, scale, moments, 16, 3);
+  std::vector<complex> xx =
+      kubo_moments(model.h, vx, vx, scale, moments, 16, 3);
+  KuboConductivity hall = kubo_bastin(xy, moments, scale, 0.5, 256);
+  KuboConductivity longitudinal = kubo_bastin(xx, moments, scale, 0.5, 256);
+
+  // In the gap, sigma_xy is quantized to C / 2 pi and sigma_xx vanishes.
+  double exact = exact_hall(model, vx, vy, 0.0);
+  EXPECT_NEAR(std::abs(exact), 1.0 / (2.0 * M_PI), 0.01);
+  std::size_t middle = 0;
+  for (std::size_t k = 0; k < hall.energy.size(); k++) {
+    if (std::abs(hall.energy[k]) < std::abs(hall.energy[middle])) middle = k;
+  }
+  EXPECT_NEAR(hall.sigma[middle], exact, 0.1 * std::abs(exact));
+  EXPECT_NEAR(longitudinal.sigma[middle], 0.0, 0.02);
+  // Inside the bands the sample conducts.
+  std::size_t band = middle;
+  while (hall.energy[band] < 2.0) band++;
+  EXPECT_GT(longitudinal.sigma[band], 0.05);
+  // Below the spectrum nothing flows.
+  EXPECT_NEAR(hall.sigma.front(), 0.0, 1e-3);
+}
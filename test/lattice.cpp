@@ -0,0 +1,77 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/lattice.h>
+
+#include <cmath>
+
+using ::testing::DoubleNear;
+using ::testing::ElementsAre;
+
+namespace {
+
+Lattice<2> hexagonal() {
+  return Lattice<2>({{1.0, 0.0}, {0.5, std::sqrt(3.0) / 2.0}});
+}
+
+}  // namespace
+
+TEST(test_lattice, reciprocal_vectors) {
+  Lattice<2> lattice = hexagonal();
+  for (std::size_t i = 0; i < 2; i++) {
+    for (std::size_t j = 0; j < 2; j++) {
+      double expected = i == j ? 2.0 * M_PI : 0.0;
+      EXPECT_NEAR(lattice.vector(i).dot(lattice.reciprocal_vector(j)),
+                  expected, 1e-12);
+    }
+  }
+}
+
+TEST(test_lattice, volume) {
+  EXPECT_NEAR(hexagonal().volume(), std::sqrt(3.0) / 2.0, 1e-12);
+  Lattice<3> cubic({{2.0, 0.0, 0.0}, {0.0, 2.0, 0.0}, {0.0, 0.0, 2.0}});
+  EXPECT_DOUBLE_EQ(cubic.volume(), 8.0);
+}
+
+TEST(test_lattice, coordinates) {
+  Lattice<2> lattice = hexagonal();
+  Vec<double, 2> r = lattice.to_cartesian(Vec<double, 2>{1.0, 1.0});
+  EXPECT_THAT(r.data(), ElementsAre(DoubleNear(1.5, 1e-12),
+                                    DoubleNear(std::sqrt(3.0) / 2.0, 1e-12)));
+  Vec<double, 2> f = lattice.to_fractional(r);
+  EXPECT_THAT(f.data(), ElementsAre(DoubleNear(1.0, 1e-12),
+                                    DoubleNear(1.0, 1e-12)));
+}
+
+TEST(test_lattice, unit_cell_orbitals) {
+  UnitCell<2> cell(hexagonal());
+  EXPECT_EQ(cell.add_site(Vec<double, 2>{1.0 / 3.0, 1.0 / 3.0}), 0);
+  EXPECT_EQ(cell.add_site(Vec<double, 2>{2.0 / 3.0, 2.0 / 3.0}, 3), 1);
+  EXPECT_EQ(cell.sites(), 2);
+  EXPECT_EQ(cell.orbitals(), 4);
+  EXPECT_EQ(cell.orbitals(1), 3);
+  EXPECT_EQ(cell.orbital_offset(1), 1);
+}
+
+TEST(test_lattice, site_position_in_other_cell) {
+  UnitCell<2> cell(hexagonal());
+  cell.add_site(Vec<double, 2>{0.0, 0.0});
+  Vec<double, 2> r = cell.cartesian(0, Vec<int, 2>{0, 1});
+  EXPECT_THAT(r.data(), ElementsAre(DoubleNear(0.5, 1e-12),
+                                    DoubleNear(std::sqrt(3.0) / 2.0, 1e-12)));
+}
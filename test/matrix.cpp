@@ -102,3 +102,31 @@ TEST(test_matrix, dimensions) {
   EXPECT_EQ(m.rows(), 2);
   EXPECT_EQ(m.cols(), 3);
 }
+
+TEST(test_matrix, product_of_matrices) {
+  Matrix<double, 2, 3> m1{{1.0, 2.0, 3.0}, {4.0, 5.0, 6.0}};
+  Matrix<double, 3, 2> m2{{1.0, 0.0}, {0.0, 1.0}, {1.0, 1.0}};
+  Matrix<double, 2, 2> res = m1 * m2;
+  EXPECT_EQ(res, (Matrix<double, 2, 2>{{4.0, 5.0}, {10.0, 11.0}}));
+}
+
+TEST(test_matrix, product_of_matrix_by_vector) {
+  Matrix<double, 2, 2> m{{1.0, 2.0}, {3.0, 4.0}};
+  Vec<double, 2> v{1.0, -1.0};
+  Vec<double, 2> res = m * v;
+  EXPECT_EQ(res, (Vec<double, 2>{-1.0, -1.0}));
+}
+
+TEST(test_matrix, transpose) {
+  Matrix<double, 2, 3> m{{1.0, 2.0, 3.0}, {4.0, 5.0, 6.0}};
+  Matrix<double, 3, 2> t = m.transpose();
+  EXPECT_EQ(t, (Matrix<double, 3, 2>{{1.0, 4.0}, {2.0, 5.0}, {3.0, 6.0}}));
+}
+
+TEST(test_matrix, inverse) {
+  Matrix<double, 3, 3> m{{0.0, 2.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0, 4.0}};
+  double det = 0.0;
+  Matrix<double, 3, 3> inv = inverse(m, &det);
+  EXPECT_DOUBLE_EQ(det, -8.0);
+  EXPECT_EQ(m * inv, (identity<double, 3>()));
+}
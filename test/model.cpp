@@ -0,0 +1,134 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/model.h>
+#include <tightb/parallel.h>
+
+#include <complex>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using ::testing::ElementsAre;
+
+namespace {
+
+using complex = std::complex<double>;
+
+constexpr char kGraphene[] = R"(# graphene, nearest neighbors
+dimension 2
+
+lattice
+  1.0 0.0
+  0.5 0.8660254037844386   # a_2
+site 0.3333333333333333 0.3333333333333333
+site 0.6666666666666666 0.6666666666666666 1
+hoppings
+ 0  0  0 1 -1.0 0.0
+ 0  0  1 0 -1.0
+-1  0  0 1 -1.0 0.0
+ 1  0  1 0 -1.0 0.0
+ 0 -1  0 1 -1.0 0.0
+ 0  1  1 0 -1.0 -0.0
+)";
+
+}  // namespace
+
+TEST(test_model, parses_graphene) {
+  Model model = parse_model(kGraphene);
+  EXPECT_EQ(model.dimension, 2);
+  EXPECT_EQ(model.sites(), 2);
+  EXPECT_EQ(model.total_orbitals(), 2);
+  EXPECT_EQ(model.hoppings(), 6);
+  EXPECT_THAT(model.from, ElementsAre(0, 1, 0, 1, 0, 1));
+  EXPECT_THAT(model.cells,
+              ElementsAre(0, 0, 0, 0, -1, 0, 1, 0, 0, -1, 0, 1));
+  EXPECT_EQ(model.im[1], 0.0);
+
+  UnitCell<2> cell = unit_cell<2>(model);
+  EXPECT_NEAR(cell.lattice().volume(), std::sqrt(3.0) / 2.0, 1e-12);
+  EXPECT_NEAR(cell.position(1)[0], 2.0 / 3.0, 1e-12);
+
+  HoppingTable<2> table = hopping_table<2>(model);
+  EXPECT_EQ(table.translations(), 5);
+  std::size_t r = table.find(Vec<int, 2>{1, 0});
+  ASSERT_LT(r, table.translations());
+  EXPECT_EQ(table.at(r, 1, 0), complex(-1.0));
+  EXPECT_TRUE(table.time_reversal_symmetric());
+}
+
+TEST(test_model, multiple_orbitals) {
+  Model model = parse_model(
+      "dimension 1\nlattice\n2.0\nsite 0.0 2\nsite 0.5 3\nhoppings\n"
+      "1 4 0 0.5 0.25\n");
+  EXPECT_EQ(model.total_orbitals(), 5);
+  EXPECT_THAT(model.orbitals, ElementsAre(2, 3));
+  HoppingTable<1> table = hopping_table<1>(model);
+  EXPECT_EQ(table.at(0, 4, 0), complex(0.5, 0.25));
+}
+
+TEST(test_model, chunked_parse_matches_serial) {
+  // Large enough to be split into several chunks.
+  std::string text =
+      "dimension 3\nlattice\n1 0 0\n0 1 0\n0 0 1\nsite 0 0 0 4\nhoppings\n";
+  std::size_t lines = 120000;
+  for (std::size_t i = 0; i < lines; i++) {
+    text += std::to_string(static_cast<int>(i % 7) - 3) + " " +
+            std::to_string(static_cast<int>(i % 5) - 2) + " " +
+            std::to_string(static_cast<int>(i % 3) - 1) + " " +
+            std::to_string(i % 4) + " " + std::to_string((i / 4) % 4) + " " +
+            std::to_string(0.001 * static_cast<double>(i)) + " " +
+            std::to_string(-1e-4 * static_cast<double>(i)) + "\n";
+  }
+
+  std::size_t threads = max_threads();
+  set_max_threads(1);
+  Model serial = parse_model(text);
+  set_max_threads(4);
+  Model parallel = parse_model(text);
+  set_max_threads(threads);
+
+  EXPECT_EQ(serial.hoppings(), lines);
+  EXPECT_EQ(serial.cells, parallel.cells);
+  EXPECT_EQ(serial.from, parallel.from);
+  EXPECT_EQ(serial.to, parallel.to);
+  EXPECT_EQ(serial.re, parallel.re);
+  EXPECT_EQ(serial.im, parallel.im);
+  EXPECT_EQ(parallel.cells[3 * 12345], 12345 % 7 - 3);
+  EXPECT_DOUBLE_EQ(parallel.re[12345], 12.345);
+}
+
+TEST(test_model, load_from_file) {
+  std::string path = ::testing::TempDir() + "tightb_model_test.txt";
+  {
+    std::ofstream out(path);
+    out << kGraphene;
+  }
+  Model model = load_model(path);
+  EXPECT_EQ(model.hoppings(), 6);
+  EXPECT_EQ(model.lattice[2], 0.5);
+  std::remove(path.c_str());
+}
+
+TEST(test_model, malformed_input_aborts) {
+  EXPECT_DEATH(parse_model("dimension 2\nlattice\n1 0\n"), "");
+  EXPECT_DEATH(parse_model("dimension 1\nlattice\n1\nsite 0\nhoppings\n0 1 0 "
+                           "1.0\n"),
+               "");
+  EXPECT_DEATH(parse_model("dimension 1\nbogus\n"), "");
+}
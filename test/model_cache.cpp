@@ -0,0 +1,186 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/model_cache.h>
+
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using ::testing::ElementsAre;
+
+namespace {
+
+using complex = std::complex<double>;
+
+constexpr char kGraphene[] = R"(dimension 2
+lattice
+1.0 0.0
+0.5 0.8660254037844386
+site 0.3333333333333333 0.3333333333333333
+site 0.6666666666666666 0.6666666666666666
+hoppings
+ 0  0  0 1 -1.0
+ 0  0  1 0 -1.0
+-1  0  0 1 -1.0
+ 1  0  1 0 -1.0
+ 0 -1  0 1 -1.0
+ 0  1  1 0 -1.0
+ 0  0  0 0  0.5
+)";
+
+void write_file(std::string const& path, std::string const& text) {
+  std::ofstream out(path, std::ios::binary);
+  out << text;
+}
+
+}  // namespace
+
+TEST(test_model_cache, content_hash) {
+  std::string a(3 * 1024 * 1024 + 5, 'x');
+  std::string b = a;
+  b[2 * 1024 * 1024 + 1] = 'y';
+  EXPECT_EQ(content_hash(a), content_hash(a));
+  EXPECT_NE(content_hash(a), content_hash(b));
+  EXPECT_NE(content_hash("abc"), content_hash("abd"));
+  EXPECT_NE(content_hash(""), content_hash(std::string(1, '\0')));
+}
+
+TEST(test_model_cache, round_trip) {
+  Model model = parse_model(kGraphene);
+  ModelCache cache(compile_model(model, 42, 7));
+  EXPECT_EQ(cache.source_hash(), 42);
+  EXPECT_EQ(cache.dimension(), 2);
+  EXPECT_EQ(cache.sites(), 2);
+  EXPECT_EQ(cache.orbitals(), 2);
+  EXPECT_EQ(cache.translations(), 5);
+
+  UnitCell<2> cell = unit_cell<2>(cache);
+  EXPECT_NEAR(cell.position(1)[1], 2.0 / 3.0, 1e-12);
+
+  HoppingTable<2> expected = hopping_table<2>(model);
+  HoppingTable<2> table = hopping_table<2>(cache);
+  ASSERT_EQ(table.translations(), expected.translations());
+  for (std::size_t r = 0; r < table.translations(); r++) {
+    std::size_t s = expected.find(table.translation(r));
+    ASSERT_LT(s, expected.translations());
+    for (std::size_t a = 0; a < 2; a++) {
+      for (std::size_t b = 0; b < 2; b++) {
+        EXPECT_EQ(table.at(r, a, b), expected.at(s, a, b));
+      }
+    }
+  }
+
+  // The home-cell bond and the two crossing bonds, each listed once.
+  Graph graph = cache.cell_graph();
+  EXPECT_EQ(graph.bonds(), 1);
+  EXPECT_TRUE(graph.has_bond(0, 1));
+  auto bonds = cell_bonds<2>(cache);
+  ASSERT_EQ(bonds.size(), 2);
+  Supercell<2> supercell(graph, bonds, {4, 4}, {true, true});
+  Graph lattice = supercell.build();
+  for (std::size_t v = 0; v < lattice.size(); v++) {
+    EXPECT_EQ(lattice.degree(v), 3);
+  }
+}
+
+TEST(test_model_cache, rebuilt_when_source_changes) {
+  std::string source = ::testing::TempDir() + "tightb_cache_model.txt";
+  std::string compiled = source + ".tbc";
+  std::remove(compiled.c_str());
+  write_file(source, kGraphene);
+
+  ModelCache first = load_cached_model(source, compiled);
+  std::ifstream written(compiled, std::ios::binary);
+  ASSERT_TRUE(written.good());
+  EXPECT_EQ(first.translations(), 5);
+
+  // A second load maps the existing file.
+  ModelCache second = load_cached_model(source, compiled);
+  EXPECT_EQ(second.source_hash(), first.source_hash());
+
+  std::string changed = kGraphene;
+  changed += " 2  0  0 0  0.1\n";
+  write_file(source, changed);
+  ModelCache third = load_cached_model(source, compiled);
+  EXPECT_NE(third.source_hash(), first.source_hash());
+  EXPECT_EQ(third.translations(), 6);
+
+  MappedFile file(compiled);
+  EXPECT_TRUE(ModelCache::matches(file.view(), third.source_hash(),
+                                  changed.size()));
+  EXPECT_FALSE(ModelCache::matches(file.view(), first.source_hash(),
+                                   changed.size()));
+  std::remove(source.c_str());
+  std::remove(compiled.c_str());
+}
+
+TEST(test_model_cache, rebuilt_when_cache_is_damaged) {
+  std::string source = ::testing::TempDir() + "tightb_damaged_model.txt";
+  std::string compiled = source + ".tbc";
+  std::remove(compiled.c_str());
+  write_file(source, kGraphene);
+  ModelCache first = load_cached_model(source, compiled);
+  std::string text(kGraphene);
+  std::string bytes;
+  {
+    std::ifstream in(compiled, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  ASSERT_TRUE(ModelCache::matches(bytes, first.source_hash(), text.size()));
+
+  // Truncated body.
+  std::string truncated = bytes.substr(0, bytes.size() - 8);
+  EXPECT_FALSE(
+      ModelCache::matches(truncated, first.source_hash(), text.size()));
+  write_file(compiled, truncated);
+  ModelCache rebuilt = load_cached_model(source, compiled);
+  EXPECT_EQ(rebuilt.translations(), first.translations());
+  {
+    MappedFile file(compiled);
+    EXPECT_TRUE(
+        ModelCache::matches(file.view(), first.source_hash(), text.size()));
+  }
+
+  // Header counts that overflow, or that disagree with the body.
+  std::string corrupt = bytes;
+  std::uint64_t huge = std::uint64_t{1} << 62;
+  std::memcpy(corrupt.data() + 7 * 8, &huge, 8);
+  EXPECT_FALSE(ModelCache::matches(corrupt, first.source_hash(), text.size()));
+  corrupt = bytes;
+  std::uint64_t adjacency;
+  std::memcpy(&adjacency, corrupt.data() + 8 * 8, 8);
+  adjacency += 1;
+  std::memcpy(corrupt.data() + 8 * 8, &adjacency, 8);
+  EXPECT_FALSE(ModelCache::matches(corrupt, first.source_hash(), text.size()));
+
+  // Corrupt bonds inside a body of the right length.
+  corrupt = bytes;
+  std::uint64_t wrong = 1000;
+  std::memcpy(corrupt.data() + corrupt.size() - 4 * 8, &wrong, 8);
+  EXPECT_FALSE(ModelCache::matches(corrupt, first.source_hash(), text.size()));
+  write_file(compiled, corrupt);
+  ModelCache repaired = load_cached_model(source, compiled);
+  EXPECT_EQ(repaired.translations(), first.translations());
+  std::remove(source.c_str());
+  std::remove(compiled.c_str());
+}
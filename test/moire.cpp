@@ -0,0 +1,162 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/eigen.h>
+#include <tightb/moire.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+using complex = std::complex<double>;
+
+UnitCell<2> graphene_cell() {
+  UnitCell<2> cell(Lattice<2>({{1.0, 0.0}, {0.5, std::sqrt(3.0) / 2}}));
+  cell.add_site(Vec<double, 2>{1.0 / 3, 1.0 / 3});
+  cell.add_site(Vec<double, 2>{2.0 / 3, 2.0 / 3});
+  return cell;
+}
+
+HoppingTable<2> graphene_table() {
+  HoppingTable<2> table(2);
+  table.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  return table;
+}
+
+std::vector<double> spectrum(SparseMatrix<complex> const& h) {
+  std::size_t n = h.size();
+  std::vector<complex> a(n * n);
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t k = h.offsets()[i]; k < h.offsets()[i + 1]; k++) {
+      a[i * n + h.columns()[k]] = h.values()[k];
+    }
+  }
+  std::vector<double> w(n);
+  EigenWorkspace<complex> ws;
+  hermitian_eigenvalues(n, a.data(), w.data(), ws);
+  return w;
+}
+
+}  // namespace
+
+TEST(test_moire, commensurate_angles) {
+  CommensurateAngle a = commensurate_angle(1, 2);
+  EXPECT_NEAR(a.angle, std::acos(13.0 / 14.0), 1e-14);
+  EXPECT_EQ(a.cells, 7);
+
+  std::vector<CommensurateAngle> angles = commensurate_angles(40);
+  EXPECT_TRUE(std::is_sorted(
+      angles.begin(), angles.end(),
+      [](auto const& x, auto const& y) { return x.angle > y.angle; }));
+  for (auto const& x : angles) EXPECT_NE((x.n - x.m) % 3, 0);
+
+  CommensurateAngle magic = closest_commensurate(1.05, 40);
+  EXPECT_EQ(magic.m, 31);
+  EXPECT_EQ(magic.n, 32);
+  EXPECT_NEAR(magic.angle * 180.0 / M_PI, 1.05, 1e-3);
+  EXPECT_EQ(magic.cells, 2977);
+}
+
+TEST(test_moire, decoupled_layers) {
+  UnitCell<2> cell = graphene_cell();
+  HoppingTable<2> table = graphene_table();
+  MoireBilayer bilayer(cell, table, commensurate_angle(1, 2), 1.0,
+                       [](Vec<double, 2> const&, std::size_t, std::size_t) {
+                         return 0.0;
+                       });
+  EXPECT_EQ(bilayer.size(), 28);
+  EXPECT_NEAR(bilayer.lattice().volume(), 7.0 * cell.lattice().volume(),
+              1e-12);
+  Graph g = bilayer.graph();
+  EXPECT_EQ(g.bonds(), 2 * 3 * 7);
+
+  // Both layers fold the same monolayer states to Gamma, including the band
+  // edges at +-3, so every level is doubly degenerate.
+  std::vector<double> w = spectrum(bilayer.hamiltonian(Vec<double, 2>{0, 0}));
+  EXPECT_NEAR(w.front(), -3.0, 1e-12);
+  EXPECT_NEAR(w.back(), 3.0, 1e-12);
+  for (std::size_t i = 0; i < w.size(); i += 2) {
+    EXPECT_NEAR(w[i], w[i + 1], 1e-10);
+  }
+}
+
+TEST(test_moire, interlayer_matches_brute_force) {
+  UnitCell<2> cell = graphene_cell();
+  HoppingTable<2> table = graphene_table();
+  double cutoff = 1.3;
+  auto interlayer = [](Vec<double, 2> const& d, std::size_t, std::size_t) {
+    return 0.3 * std::exp(-d.dot(d));
+  };
+  MoireBilayer bilayer(cell, table, commensurate_angle(2, 3), cutoff,
+                       interlayer);
+
+  std::size_t half = bilayer.size() / 2;
+  std::set<std::tuple<std::size_t, std::size_t, int, int>> fast;
+  for (auto const& hop : bilayer.hops()) {
+    if (hop.from >= half || hop.to < half) continue;
+    Vec<int, 2> const& c = bilayer.cells()[hop.cell];
+    fast.emplace(hop.from, hop.to, c[0], c[1]);
+  }
+
+  std::set<std::tuple<std::size_t, std::size_t, int, int>> slow;
+  for (std::size_t i = 0; i < half; i++) {
+    for (std::size_t j = half; j < bilayer.size(); j++) {
+      for (int c0 = -3; c0 <= 3; c0++) {
+        for (int c1 = -3; c1 <= 3; c1++) {
+          Vec<double, 2> shift = bilayer.lattice().to_cartesian(
+              Vec<double, 2>{double(c0), double(c1)});
+          Vec<double, 2> d =
+              bilayer.position(j) + shift - bilayer.position(i);
+          if (d.dot(d) <= cutoff * cutoff) slow.emplace(i, j, c0, c1);
+        }
+      }
+    }
+  }
+  EXPECT_FALSE(slow.empty());
+  EXPECT_EQ(fast, slow);
+
+  auto h = bilayer.hamiltonian(Vec<double, 2>{0.2, -0.1});
+  std::size_t n = h.size();
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t k = h.offsets()[i]; k < h.offsets()[i + 1]; k++) {
+      std::size_t j = h.columns()[k];
+      EXPECT_NEAR(std::abs(h.values()[k] - std::conj(h.at(j, i))), 0.0, 1e-14);
+    }
+  }
+}
+
+TEST(test_moire, magic_angle_size) {
+  UnitCell<2> cell = graphene_cell();
+  HoppingTable<2> table = graphene_table();
+  MoireBilayer bilayer(
+      cell, table, closest_commensurate(1.05, 40), 1.0,
+      [](Vec<double, 2> const& d, std::size_t, std::size_t) {
+        return 0.3 * std::exp(-4.0 * d.dot(d));
+      });
+  EXPECT_EQ(bilayer.size(), 4 * 2977);
+  auto h = bilayer.hamiltonian(Vec<double, 2>{0.0, 0.0});
+  EXPECT_EQ(h.size(), bilayer.size());
+  EXPECT_GT(h.nonzeros(), 4 * bilayer.size());
+}
@@ -0,0 +1,174 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/mutation.h>
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+namespace {
+
+Graph chain(std::size_t n) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t v = 0; v + 1 < n; v++) bonds.emplace_back(v, v + 1);
+  return {n, bonds};
+}
+
+double hopping(std::size_t i, std::size_t j) { return i == j ? 0.5 : -1.0; }
+
+}  // namespace
+
+TEST(test_mutation, remove_and_insert_bonds) {
+  MutableGraph g(chain(4));
+  GraphEdits edits;
+  edits.removed_bonds = {{1, 2}};
+  edits.inserted_bonds = {{0, 3}};
+  g.apply(edits);
+  EXPECT_FALSE(g.has_bond(1, 2));
+  EXPECT_FALSE(g.has_bond(2, 1));
+  EXPECT_TRUE(g.has_bond(3, 0));
+  EXPECT_THAT(g.neighbors(0), UnorderedElementsAre(1, 3));
+}
+
+TEST(test_mutation, removed_bond_out_of_range_aborts) {
+  MutableGraph g(chain(4));
+  GraphEdits edits;
+  edits.removed_bonds = {{1, 9}};
+  EXPECT_DEATH(g.apply(edits), "");
+}
+
+TEST(test_mutation, vacancy_keeps_ids) {
+  MutableGraph g(chain(5));
+  GraphEdits edits;
+  edits.removed_sites = {2};
+  g.apply(edits);
+  EXPECT_EQ(g.size(), 5);
+  EXPECT_EQ(g.dead_sites(), 1);
+  EXPECT_FALSE(g.alive(2));
+  EXPECT_THAT(g.neighbors(1), ElementsAre(0));
+  EXPECT_GT(g.garbage(), 0.0);
+
+  Graph snapshot = g.graph();
+  EXPECT_EQ(snapshot.size(), 5);
+  EXPECT_EQ(snapshot.degree(2), 0);
+  EXPECT_EQ(snapshot.bonds(), 2);
+}
+
+TEST(test_mutation, adatom_grows_row) {
+  MutableGraph g(chain(3), 0);
+  GraphEdits edits;
+  edits.inserted_sites = {3};
+  edits.inserted_bonds = {{1, 3}, {0, 3}, {2, 3}};
+  g.apply(edits);
+  EXPECT_EQ(g.size(), 4);
+  EXPECT_THAT(g.neighbors(3), UnorderedElementsAre(0, 1, 2));
+  EXPECT_THAT(g.neighbors(1), UnorderedElementsAre(0, 2, 3));
+}
+
+TEST(test_mutation, compact_renumbers) {
+  MutableGraph g(chain(5));
+  GraphEdits edits;
+  edits.removed_sites = {0, 3};
+  g.apply(edits);
+  std::vector<std::size_t> renumber = g.compact();
+  EXPECT_THAT(renumber, ElementsAre(MutableGraph::npos, 0, 1,
+                                    MutableGraph::npos, 2));
+  EXPECT_EQ(g.size(), 3);
+  EXPECT_EQ(g.dead_sites(), 0);
+  EXPECT_EQ(g.garbage(), 0.0);
+  EXPECT_THAT(g.neighbors(0), ElementsAre(1));
+  EXPECT_EQ(g.degree(2), 0);
+}
+
+TEST(test_mutation, propagate_to_hamiltonian) {
+  Graph base = chain(4);
+  SparseMatrix<double> h(base);
+  for (std::size_t i = 0; i < 4; i++) {
+    h.at(i, i) = hopping(i, i);
+    for (std::size_t j : base.neighbors(i)) h.at(i, j) = hopping(i, j);
+  }
+
+  GraphEdits vacancy;
+  vacancy.removed_sites = {1};
+  EXPECT_TRUE(apply_edits(h, vacancy, hopping));
+  EXPECT_EQ(h.at(0, 1), 0.0);
+  EXPECT_EQ(h.at(2, 1), 0.0);
+  EXPECT_EQ(h.at(1, 1), 0.0);
+  EXPECT_EQ(h.at(2, 3), -1.0);
+
+  GraphEdits restore;
+  restore.inserted_sites = {1};
+  restore.inserted_bonds = {{0, 1}, {1, 2}};
+  EXPECT_TRUE(apply_edits(h, restore, hopping));
+  EXPECT_EQ(h.at(1, 1), 0.5);
+  EXPECT_EQ(h.at(1, 0), -1.0);
+  EXPECT_EQ(h.at(2, 1), -1.0);
+
+  GraphEdits outside;
+  outside.inserted_bonds = {{0, 3}};
+  EXPECT_FALSE(apply_edits(h, outside, hopping));
+}
+
+TEST(test_mutation, edits_outside_the_pattern) {
+  Graph base = chain(3);
+  SparseMatrix<double> h(base);
+  for (std::size_t i = 0; i < 3; i++) {
+    h.at(i, i) = hopping(i, i);
+    for (std::size_t j : base.neighbors(i)) h.at(i, j) = hopping(i, j);
+  }
+  std::vector<double> before = h.values();
+
+  // A bond and a site added to the graph after assembly have no slots:
+  // removing them again leaves h as it was.
+  GraphEdits remove;
+  remove.removed_bonds = {{0, 2}, {2, 3}};
+  remove.removed_sites = {3};
+  EXPECT_TRUE(apply_edits(h, remove, hopping));
+  EXPECT_EQ(h.values(), before);
+
+  // h never grows, so inserting the site asks for a rebuild.
+  GraphEdits adatom;
+  adatom.inserted_sites = {3};
+  adatom.inserted_bonds = {{2, 3}};
+  EXPECT_FALSE(apply_edits(h, adatom, hopping));
+  EXPECT_EQ(h.values(), before);
+}
+
+TEST(test_mutation, adatoms_on_a_preassembled_pattern) {
+  // Candidate adatom site 3 above site 1, present in the pattern from the
+  // start and removed until it is occupied.
+  Graph base(4, {{0, 1}, {1, 2}, {1, 3}});
+  SparseMatrix<double> h(base);
+  for (std::size_t i = 0; i < 4; i++) {
+    h.at(i, i) = hopping(i, i);
+    for (std::size_t j : base.neighbors(i)) h.at(i, j) = hopping(i, j);
+  }
+  GraphEdits empty;
+  empty.removed_sites = {3};
+  EXPECT_TRUE(apply_edits(h, empty, hopping));
+  EXPECT_EQ(h.at(1, 3), 0.0);
+  EXPECT_EQ(h.at(3, 3), 0.0);
+
+  GraphEdits occupy;
+  occupy.inserted_sites = {3};
+  occupy.inserted_bonds = {{1, 3}};
+  EXPECT_TRUE(apply_edits(h, occupy, hopping));
+  EXPECT_EQ(h.at(3, 3), 0.5);
+  EXPECT_EQ(h.at(3, 1), -1.0);
+  EXPECT_EQ(h.at(1, 3), -1.0);
+}
@@ -0,0 +1,91 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/partition.h>
+
+#include <algorithm>
+
+namespace {
+
+Graph square_grid(std::size_t nx, std::size_t ny) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t x = 0; x < nx; x++) {
+    for (std::size_t y = 0; y < ny; y++) {
+      std::size_t v = x * ny + y;
+      if (x + 1 < nx) bonds.emplace_back(v, v + ny);
+      if (y + 1 < ny) bonds.emplace_back(v, v + 1);
+    }
+  }
+  return {nx * ny, bonds};
+}
+
+}  // namespace
+
+TEST(test_partition, bisection_of_grid) {
+  Graph g = square_grid(32, 32);
+  Partition p = partition(g, 2);
+  EXPECT_EQ(p.parts(), 2);
+  std::size_t left = std::count(p.part.begin(), p.part.end(), 0);
+  EXPECT_NEAR(left, 512, 16);
+  EXPECT_LE(p.edge_cut, 40);
+}
+
+TEST(test_partition, edge_cut_matches_assignment) {
+  Graph g = square_grid(20, 30);
+  Partition p = partition(g, 5);
+  std::size_t cut = 0;
+  for (std::size_t v = 0; v < g.size(); v++) {
+    for (std::size_t u : g.neighbors(v)) {
+      if (u > v && p.part[u] != p.part[v]) cut++;
+    }
+  }
+  EXPECT_EQ(p.edge_cut, cut);
+  for (std::size_t q = 0; q < 5; q++) {
+    std::size_t size = std::count(p.part.begin(), p.part.end(), q);
+    EXPECT_NEAR(size, 120, 8);
+  }
+}
+
+TEST(test_partition, ghosts_and_boundary) {
+  Graph g = square_grid(16, 16);
+  Partition p = partition(g, 4);
+  for (std::size_t q = 0; q < p.parts(); q++) {
+    for (std::size_t ghost : p.ghosts[q]) {
+      EXPECT_NE(p.part[ghost], q);
+      auto row = g.neighbors(ghost);
+      EXPECT_TRUE(std::any_of(row.begin(), row.end(),
+                              [&](std::size_t u) { return p.part[u] == q; }));
+    }
+    for (std::size_t owned : p.boundary[q]) EXPECT_EQ(p.part[owned], q);
+  }
+}
+
+TEST(test_partition, disconnected_graph) {
+  Graph g(6, {{0, 1}, {1, 2}, {3, 4}, {4, 5}});
+  Partition p = partition(g, 2);
+  EXPECT_EQ(p.edge_cut, 0);
+  EXPECT_EQ(std::count(p.part.begin(), p.part.end(), 0), 3);
+}
+
+TEST(test_partition, single_part) {
+  Graph g = square_grid(4, 4);
+  Partition p = partition(g, 1);
+  EXPECT_EQ(p.edge_cut, 0);
+  EXPECT_TRUE(p.ghosts[0].empty());
+}
@@ -0,0 +1,216 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/bloch.h>
+#include <tightb/eigen.h>
+#include <tightb/peierls.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace {
+
+using complex = std::complex<double>;
+
+UnitCell<2> square_cell() {
+  UnitCell<2> cell(Lattice<2>({{1.0, 0.0}, {0.0, 1.0}}));
+  cell.add_site(Vec<double, 2>{0.0, 0.0});
+  return cell;
+}
+
+HoppingTable<2> square_table() {
+  HoppingTable<2> table(1);
+  table.add_hermitian(Vec<int, 2>{1, 0}, 0, 0, -1.0);
+  table.add_hermitian(Vec<int, 2>{0, 1}, 0, 0, -1.0);
+  return table;
+}
+
+UnitCell<2> graphene_cell() {
+  UnitCell<2> cell(Lattice<2>({{1.0, 0.0}, {0.5, std::sqrt(3.0) / 2}}));
+  cell.add_site(Vec<double, 2>{1.0 / 3, 1.0 / 3});
+  cell.add_site(Vec<double, 2>{2.0 / 3, 2.0 / 3});
+  return cell;
+}
+
+HoppingTable<2> graphene_table() {
+  HoppingTable<2> table(2);
+  table.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  return table;
+}
+
+std::vector<complex> power(std::vector<complex> const& a, std::size_t n,
+                           int k) {
+  std::vector<complex> result(n * n);
+  for (std::size_t i = 0; i < n; i++) result[i * n + i] = 1.0;
+  for (int step = 0; step < k; step++) {
+    std::vector<complex> next(n * n);
+    for (std::size_t i = 0; i < n; i++) {
+      for (std::size_t l = 0; l < n; l++) {
+        for (std::size_t j = 0; j < n; j++) {
+          next[i * n + j] += result[i * n + l] * a[l * n + j];
+        }
+      }
+    }
+    result = next;
+  }
+  return result;
+}
+
+// tr H^k per orbital, averaged over a mesh fine enough to be exact: the
+// weighted count of closed walks of k steps, which only sees the fluxes.
+double moment(MagneticCell<2> const& m, int k) {
+  BlochHamiltonian<2> bloch(m.table());
+  std::size_t n = m.table().orbitals();
+  std::vector<complex> h(n * n);
+  BlochWorkspace w;
+  double sum = 0.0;
+  std::size_t mesh = 8;
+  for (std::size_t i = 0; i < mesh; i++) {
+    for (std::size_t j = 0; j < mesh; j++) {
+      bloch.build(Vec<double, 2>{double(i) / mesh, double(j) / mesh}, h.data(),
+                  w);
+      std::vector<complex> hk = power(h, n, k);
+      for (std::size_t a = 0; a < n; a++) sum += hk[a * n + a].real();
+    }
+  }
+  return sum / static_cast<double>(mesh * mesh * n);
+}
+
+std::vector<double> spectrum(std::vector<complex> a, std::size_t n) {
+  std::vector<double> w(n);
+  EigenWorkspace<complex> ws;
+  hermitian_eigenvalues(n, a.data(), w.data(), ws);
+  return w;
+}
+
+}  // namespace
+
+TEST(test_peierls, half_flux_square_lattice) {
+  MagneticCell<2> m(square_cell(), square_table(), 2, 4);
+  EXPECT_EQ(m.p(), 1);
+  EXPECT_EQ(m.q(), 2);
+  EXPECT_EQ(m.table().orbitals(), 2);
+
+  BlochHamiltonian<2> bloch(m.table());
+  for (auto k : {Vec<double, 2>{0.1, 0.3}, Vec<double, 2>{0.45, -0.2}}) {
+    auto h = bloch.build<2>(k);
+    std::vector<complex> a = {h.at(0, 0), h.at(0, 1), h.at(1, 0), h.at(1, 1)};
+    std::vector<double> w = spectrum(a, 2);
+    double kx = M_PI * k[0];
+    double ky = 2.0 * M_PI * k[1];
+    double e = 2.0 * std::sqrt(std::pow(std::cos(kx), 2) +
+                               std::pow(std::cos(ky), 2));
+    EXPECT_NEAR(w[0], -e, 1e-12);
+    EXPECT_NEAR(w[1], e, 1e-12);
+  }
+}
+
+TEST(test_peierls, zero_denominator_aborts) {
+  EXPECT_DEATH(MagneticCell<2>(square_cell(), square_table(), 0, 0),
+               "zero denominator");
+  EXPECT_DEATH(MagneticCell<2>(square_cell(), square_table(), 1, 0),
+               "zero denominator");
+}
+
+TEST(test_peierls, plaquette_fluxes) {
+  // Closed walks of four steps on the square lattice: 28 retracing ones and
+  // 8 around a plaquette, which pick up e^{+-2 pi i phi}.
+  for (long q : {3, 5}) {
+    MagneticCell<2> m(square_cell(), square_table(), 1, q);
+    EXPECT_NEAR(moment(m, 4), 28.0 + 8.0 * std::cos(2.0 * M_PI / q), 1e-10);
+  }
+
+  // On graphene the first loops enclosing flux are the six-step walks around
+  // the three hexagons at each site, in either direction. The basis sits off
+  // the lattice points, so this also checks the magnetic translation.
+  MagneticCell<2> zero(graphene_cell(), graphene_table(), 0, 1);
+  double base = moment(zero, 6);
+  for (long q : {3, 4}) {
+    MagneticCell<2> m(graphene_cell(), graphene_table(), 1, q);
+    EXPECT_NEAR(moment(m, 2), 3.0, 1e-10);
+    EXPECT_NEAR(moment(m, 6) - base, 6.0 * (std::cos(2.0 * M_PI / q) - 1.0),
+                1e-10);
+  }
+}
+
+TEST(test_peierls, graphene_zero_landau_level) {
+  // At weak flux 1/q each magnetic cell holds one zero-energy Landau level
+  // state per valley.
+  long q = 40;
+  MagneticCell<2> m(graphene_cell(), graphene_table(), 1, q);
+  std::size_t n = m.table().orbitals();
+  BlochHamiltonian<2> bloch(m.table());
+  std::vector<complex> h(n * n);
+  BlochWorkspace w;
+  bloch.build(Vec<double, 2>{0.3, 0.1}, h.data(), w);
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t j = 0; j < n; j++) {
+      EXPECT_NEAR(std::abs(h[i * n + j] - std::conj(h[j * n + i])), 0.0,
+                  1e-12);
+    }
+  }
+  std::vector<double> e = spectrum(h, n);
+  auto zero = [](double x) { return std::abs(x) < 1e-6; };
+  EXPECT_EQ(std::count_if(e.begin(), e.end(), zero), 2);
+}
+
+TEST(test_peierls, gauges_agree_on_a_flake) {
+  std::size_t side = 6;
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  std::vector<Vec<double, 2>> positions;
+  for (std::size_t x = 0; x < side; x++) {
+    for (std::size_t y = 0; y < side; y++) {
+      positions.push_back(Vec<double, 2>{double(x), double(y)});
+      if (x + 1 < side) bonds.emplace_back(x * side + y, (x + 1) * side + y);
+      if (y + 1 < side) bonds.emplace_back(x * side + y, x * side + y + 1);
+    }
+  }
+  Graph g(side * side, bonds);
+  SparseMatrix<complex> h(g);
+  for (auto [i, j] : bonds) {
+    h.at(i, j) = -1.0;
+    h.at(j, i) = -1.0;
+  }
+  SparseMatrix<complex> landau = h;
+  SparseMatrix<complex> symmetric = h;
+  apply_peierls(landau, positions, 0.13, Gauge::Landau);
+  apply_peierls(symmetric, positions, 0.13, Gauge::Symmetric);
+
+  // Phase around the first plaquette, counterclockwise.
+  complex loop = landau.at(0, side) * landau.at(side, side + 1) *
+                 landau.at(side + 1, 1) * landau.at(1, 0);
+  EXPECT_NEAR(std::arg(loop), 2.0 * M_PI * 0.13, 1e-12);
+
+  auto dense = [&](SparseMatrix<complex> const& s) {
+    std::size_t n = s.size();
+    std::vector<complex> a(n * n);
+    for (std::size_t i = 0; i < n; i++) {
+      for (std::size_t k = s.offsets()[i]; k < s.offsets()[i + 1]; k++) {
+        a[i * n + s.columns()[k]] = s.values()[k];
+      }
+    }
+    return a;
+  };
+  std::vector<double> a = spectrum(dense(landau), h.size());
+  std::vector<double> b = spectrum(dense(symmetric), h.size());
+  for (std::size_t i = 0; i < a.size(); i++) EXPECT_NEAR(a[i], b[i], 1e-10);
+}
@@ -0,0 +1,181 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/eigen.h>
+#include <tightb/slab.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace {
+
+using complex = std::complex<double>;
+
+std::vector<complex> dense(SparseMatrix<complex> const& h) {
+  std::size_t n = h.size();
+  std::vector<complex> a(n * n);
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t k = h.offsets()[i]; k < h.offsets()[i + 1]; k++) {
+      a[i * n + h.columns()[k]] = h.values()[k];
+    }
+  }
+  return a;
+}
+
+std::vector<double> spectrum(SparseMatrix<complex> const& h) {
+  std::vector<complex> a = dense(h);
+  std::vector<double> w(h.size());
+  EigenWorkspace<complex> ws;
+  hermitian_eigenvalues(h.size(), a.data(), w.data(), ws);
+  return w;
+}
+
+struct Model2D {
+  UnitCell<2> cell;
+  HoppingTable<2> table;
+};
+
+Model2D square() {
+  Model2D m{UnitCell<2>(Lattice<2>({{1.0, 0.0}, {0.0, 1.0}})),
+            HoppingTable<2>(1)};
+  m.cell.add_site(Vec<double, 2>{0.0, 0.0});
+  m.table.add_hermitian(Vec<int, 2>{1, 0}, 0, 0, -1.0);
+  m.table.add_hermitian(Vec<int, 2>{0, 1}, 0, 0, -1.0);
+  return m;
+}
+
+Model2D graphene() {
+  Model2D m{UnitCell<2>(Lattice<2>({{1.0, 0.0}, {0.5, std::sqrt(3.0) / 2}})),
+            HoppingTable<2>(2)};
+  m.cell.add_site(Vec<double, 2>{1.0 / 3, 1.0 / 3});
+  m.cell.add_site(Vec<double, 2>{2.0 / 3, 2.0 / 3});
+  m.table.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  m.table.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  m.table.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  return m;
+}
+
+}  // namespace
+
+TEST(test_slab, plane_basis) {
+  for (auto miller : {Vec<int, 3>{0, 0, 1}, Vec<int, 3>{1, 1, 1},
+                      Vec<int, 3>{2, -3, 5}, Vec<int, 3>{0, 4, -3}}) {
+    Matrix<int, 3, 3> u = plane_basis(miller);
+    for (std::size_t c = 0; c < 3; c++) {
+      int dot = 0;
+      for (std::size_t r = 0; r < 3; r++) dot += miller[r] * u.at(r, c);
+      EXPECT_EQ(dot, c == 2 ? 1 : 0);
+    }
+    Matrix<double, 3, 3> real{};
+    for (std::size_t r = 0; r < 3; r++) {
+      for (std::size_t c = 0; c < 3; c++) real.at(r, c) = u.at(r, c);
+    }
+    double det = 0.0;
+    inverse(real, &det);
+    EXPECT_NEAR(std::abs(det), 1.0, 1e-12);
+  }
+}
+
+TEST(test_slab, square_ribbon) {
+  Model2D m = square();
+  std::size_t width = 12;
+  Slab<2> slab(m.cell, m.table, Vec<int, 2>{0, 1}, width);
+  EXPECT_EQ(slab.size(), width);
+  EXPECT_EQ(slab.principal_layer(), 1);
+  EXPECT_NEAR(slab.lattice().volume(), 1.0, 1e-12);
+
+  double k = 0.17;
+  std::vector<double> w = spectrum(slab.hamiltonian(Vec<double, 1>{k}));
+  std::vector<double> expected;
+  for (std::size_t j = 1; j <= width; j++) {
+    expected.push_back(-2.0 * std::cos(2.0 * M_PI * k) -
+                       2.0 * std::cos(M_PI * j / (width + 1.0)));
+  }
+  std::sort(expected.begin(), expected.end());
+  for (std::size_t i = 0; i < width; i++) EXPECT_NEAR(w[i], expected[i], 1e-10);
+}
+
+TEST(test_slab, block_tridiagonal) {
+  Model2D m = square();
+  Slab<2> slab(m.cell, m.table, Vec<int, 2>{1, 1}, 10);
+  EXPECT_EQ(slab.principal_layer(), 1);
+  Graph g = slab.graph();
+  std::size_t block = slab.principal_layer() * slab.orbitals();
+  for (std::size_t v = 0; v < g.size(); v++) {
+    for (std::size_t u : g.neighbors(v)) {
+      long distance =
+          static_cast<long>(u / block) - static_cast<long>(v / block);
+      EXPECT_LE(std::abs(distance), 1);
+    }
+  }
+
+  auto h = slab.hamiltonian(Vec<double, 1>{0.3});
+  std::vector<complex> a = dense(h);
+  std::size_t n = h.size();
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t j = 0; j < n; j++) {
+      EXPECT_NEAR(std::abs(a[i * n + j] - std::conj(a[j * n + i])), 0.0, 1e-14);
+    }
+  }
+}
+
+TEST(test_slab, zigzag_edge_states) {
+  Model2D m = graphene();
+  Slab<2> slab(m.cell, m.table, Vec<int, 2>{0, 1}, 20);
+  EXPECT_EQ(slab.size(), 40);
+
+  // The flat edge band of a zigzag ribbon sits at zero energy at the zone
+  // boundary, one state per edge.
+  std::vector<double> w = spectrum(slab.hamiltonian(Vec<double, 1>{0.5}));
+  auto zero = [](double e) { return std::abs(e) < 1e-8; };
+  EXPECT_EQ(std::count_if(w.begin(), w.end(), zero), 2);
+
+  // Passivation lifts the edge sites, which lost one bond each, out of the
+  // gap.
+  slab.passivate(5.0);
+  std::vector<double> shifted = spectrum(slab.hamiltonian(Vec<double, 1>{0.5}));
+  EXPECT_EQ(std::count_if(shifted.begin(), shifted.end(), zero), 0);
+  EXPECT_GT(shifted.back(), 4.0);
+}
+
+TEST(test_slab, edge_positions) {
+  Model2D m = graphene();
+  Slab<2> slab(m.cell, m.table, Vec<int, 2>{0, 1}, 3);
+  for (std::size_t i = 0; i < slab.size(); i++) {
+    std::size_t layer = i / 2;
+    Vec<int, 2> cell{0, static_cast<int>(layer)};
+    Vec<double, 2> expected = m.cell.cartesian(i % 2, cell);
+    EXPECT_NEAR(slab.position(i)[0], expected[0], 1e-12);
+    EXPECT_NEAR(slab.position(i)[1], expected[1], 1e-12);
+  }
+}
+
+TEST(test_slab, wide_ribbon) {
+  Model2D m = graphene();
+  std::size_t width = 10000;
+  Slab<2> slab(m.cell, m.table, Vec<int, 2>{1, 0}, width);
+  EXPECT_EQ(slab.size(), 2 * width);
+  Graph g = slab.graph();
+  // Two of the three bonds of a site join the same pair of orbitals once the
+  // parallel cells are folded, which leaves a chain A0 B0 A1 B1 ...
+  EXPECT_EQ(g.bonds(), 2 * width - 1);
+  auto h = slab.hamiltonian(Vec<double, 1>{0.25});
+  EXPECT_EQ(h.nonzeros(), 2 * g.bonds() + h.size());
+}
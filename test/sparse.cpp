@@ -0,0 +1,176 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/sparse.h>
+
+#include <algorithm>
+#include <complex>
+
+using ::testing::ElementsAre;
+
+namespace {
+
+using complex = std::complex<double>;
+
+Graph ring(std::size_t n) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t v = 0; v < n; v++) bonds.emplace_back(v, (v + 1) % n);
+  return {n, bonds};
+}
+
+// Open triangular grid: the square grid plus one diagonal per plaquette.
+Graph triangular_grid(std::size_t nx, std::size_t ny) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t x = 0; x < nx; x++) {
+    for (std::size_t y = 0; y < ny; y++) {
+      std::size_t v = x * ny + y;
+      if (x + 1 < nx) bonds.emplace_back(v, v + ny);
+      if (y + 1 < ny) bonds.emplace_back(v, v + 1);
+      if (x + 1 < nx && y + 1 < ny) bonds.emplace_back(v, v + ny + 1);
+    }
+  }
+  return {nx * ny, bonds};
+}
+
+complex hopping(std::size_t i, std::size_t j) {
+  return {1.0 + 0.1 * static_cast<double>(i), 0.01 * static_cast<double>(j)};
+}
+
+}  // namespace
+
+TEST(test_sparse, pattern_includes_diagonal) {
+  Graph g(3, {{0, 1}, {1, 2}});
+  SparseMatrix<double> full(g);
+  EXPECT_EQ(full.nonzeros(), 7);
+  EXPECT_THAT(full.columns(), ElementsAre(0, 1, 0, 1, 2, 1, 2));
+
+  SparseMatrix<double> upper(g, Triangle::Upper);
+  EXPECT_EQ(upper.nonzeros(), 5);
+  EXPECT_THAT(upper.columns(), ElementsAre(0, 1, 1, 2, 2));
+}
+
+TEST(test_sparse, accessor) {
+  Graph g(3, {{0, 1}, {1, 2}});
+  SparseMatrix<double> m(g);
+  m.at(0, 1) = 2.0;
+  EXPECT_EQ(m.at(0, 1), 2.0);
+  EXPECT_EQ(m.find(0, 2), SparseMatrix<double>::npos);
+}
+
+TEST(test_sparse, multiply) {
+  Graph g = ring(4);
+  SparseMatrix<double> m(g);
+  for (std::size_t i = 0; i < 4; i++) {
+    m.at(i, i) = 1.0;
+    for (std::size_t j : g.neighbors(i)) m.at(i, j) = -1.0;
+  }
+  std::vector<double> x{1.0, 2.0, 3.0, 4.0};
+  std::vector<double> y(4);
+  m.multiply(x.data(), y.data());
+  EXPECT_THAT(y, ElementsAre(-5.0, -2.0, -3.0, 0.0));
+}
+
+TEST(test_sparse, hermitian_scatter_matches_full_multiply) {
+  Graph g = ring(50);
+  Coloring coloring = color_graph(g, 2);
+  SparseMatrix<complex> full(g);
+  SparseMatrix<complex> upper(g, Triangle::Upper);
+  assemble_bonds(g, coloring, full, hopping);
+  assemble_bonds(g, coloring, upper, hopping);
+  for (std::size_t i = 0; i < g.size(); i++) {
+    full.at(i, i) = upper.at(i, i) = static_cast<double>(i);
+    EXPECT_EQ(full.at(i, g.neighbors(i).begin()[0]),
+              std::conj(full.at(g.neighbors(i).begin()[0], i)));
+  }
+
+  std::vector<complex> x(g.size());
+  for (std::size_t i = 0; i < x.size(); i++) {
+    x[i] = {std::cos(static_cast<double>(i)), std::sin(2.0 * i)};
+  }
+  std::vector<complex> y_full(g.size());
+  std::vector<complex> y_upper(g.size());
+  full.multiply(x.data(), y_full.data());
+  hermitian_multiply(upper, coloring, x.data(), y_upper.data());
+  for (std::size_t i = 0; i < x.size(); i++) {
+    EXPECT_NEAR(std::abs(y_full[i] - y_upper[i]), 0.0, 1e-12);
+  }
+}
+
+TEST(test_sparse, colored_kernels_run_in_parallel) {
+  // Color classes of a few thousand rows, so assembly and the scatter are
+  // split between threads.
+  Graph g = triangular_grid(250, 250);
+  std::size_t threads = max_threads();
+  set_max_threads(4);
+  Coloring coloring = color_graph(g, 2);
+  std::size_t largest = 0;
+  for (std::size_t c = 0; c < coloring.colors(); c++) {
+    largest =
+        std::max(largest, coloring.offsets[c + 1] - coloring.offsets[c]);
+  }
+  EXPECT_GE(largest, 4096u);
+  auto bounded = [](std::size_t i, std::size_t j) {
+    return hopping(i % 11, j % 13);
+  };
+  SparseMatrix<complex> full(g);
+  SparseMatrix<complex> upper(g, Triangle::Upper);
+  assemble_bonds(g, coloring, full, bounded);
+  assemble_bonds(g, coloring, upper, bounded);
+  std::vector<complex> x(g.size());
+  for (std::size_t i = 0; i < g.size(); i++) {
+    full.at(i, i) = upper.at(i, i) = 0.5 * static_cast<double>(i % 7);
+    for (std::size_t j : g.neighbors(i)) {
+      if (j > i) {
+        EXPECT_EQ(full.at(i, j), bounded(i, j));
+        EXPECT_EQ(full.at(j, i), std::conj(bounded(i, j)));
+      }
+    }
+    x[i] = {std::cos(static_cast<double>(i)), std::sin(2.0 * i)};
+  }
+  std::vector<complex> y_full(g.size());
+  std::vector<complex> y_upper(g.size());
+  full.multiply(x.data(), y_full.data());
+  hermitian_multiply(upper, coloring, x.data(), y_upper.data());
+  set_max_threads(threads);
+  for (std::size_t i = 0; i < x.size(); i++) {
+    EXPECT_NEAR(std::abs(y_full[i] - y_upper[i]), 0.0, 1e-12);
+  }
+}
+
+TEST(test_sparse, real_part) {
+  Graph g = ring(6);
+  SparseMatrix<complex> h(g);
+  for (std::size_t i = 0; i < 6; i++) {
+    h.at(i, (i + 1) % 6) = -1.0;
+    h.at((i + 1) % 6, i) = -1.0;
+  }
+  EXPECT_TRUE(is_real(h));
+  h.at(0, 1) = complex(-1.0, 1e-3);
+  EXPECT_FALSE(is_real(h));
+  EXPECT_TRUE(is_real(h, 1e-2));
+  h.at(0, 1) = -1.0;
+
+  SparseMatrix<double> r = real_part(h);
+  EXPECT_EQ(r.columns(), h.columns());
+  EXPECT_EQ(r.at(2, 3), -1.0);
+
+  std::vector<double> x{1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+  std::vector<double> y(6);
+  r.multiply(x.data(), y.data());
+  EXPECT_THAT(y, ElementsAre(-8.0, -4.0, -6.0, -8.0, -10.0, -6.0));
+}
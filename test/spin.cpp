@@ -0,0 +1,130 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/eigen.h>
+#include <tightb/spin.h>
+
+#include <cmath>
+#include <complex>
+
+namespace {
+
+using complex = std::complex<double>;
+
+Graph ring(std::size_t n) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t v = 0; v < n; v++) bonds.emplace_back(v, (v + 1) % n);
+  return {n, bonds};
+}
+
+}  // namespace
+
+TEST(test_spin, pauli_block) {
+  auto b = spin_block(1.0, 0.0, 0.0, 0.5);
+  EXPECT_EQ(b.at(0, 0), complex(1.5));
+  EXPECT_EQ(b.at(1, 1), complex(0.5));
+  auto y = spin_block(0.0, 0.0, 1.0, 0.0);
+  EXPECT_EQ(y.at(0, 1), complex(0.0, -1.0));
+  EXPECT_EQ(y.at(1, 0), complex(0.0, 1.0));
+}
+
+TEST(test_spin, multiply_matches_expanded_matrix) {
+  std::size_t n = 7;
+  SpinMatrix h(ring(n));
+  EXPECT_FALSE(h.has(Pauli::X));
+  for (std::size_t i = 0; i < n; i++) {
+    std::size_t j = (i + 1) % n;
+    h.h0().at(i, j) = -1.0;
+    h.h0().at(j, i) = -1.0;
+    // Rashba-like spin-dependent hopping i lambda sigma_y on every bond.
+    h.at(Pauli::Y, i, j) = complex(0.0, 0.2);
+    h.at(Pauli::Y, j, i) = complex(0.0, -0.2);
+    // Zeeman field along z and x.
+    h.at(Pauli::Z, i, i) = 0.3;
+    h.at(Pauli::X, i, i) = 0.1 * static_cast<double>(i);
+  }
+  EXPECT_TRUE(h.has(Pauli::X));
+  EXPECT_TRUE(h.has(Pauli::Y));
+
+  SparseMatrix<complex> full = h.expand();
+  EXPECT_EQ(full.size(), 2 * n);
+  std::vector<complex> x(2 * n);
+  for (std::size_t i = 0; i < 2 * n; i++) {
+    x[i] = {std::sin(1.0 + i), std::cos(2.0 * i)};
+  }
+  std::vector<complex> y(2 * n);
+  std::vector<complex> expected(2 * n);
+  h.multiply(x.data(), y.data());
+  full.multiply(x.data(), expected.data());
+  for (std::size_t i = 0; i < 2 * n; i++) {
+    EXPECT_NEAR(std::abs(y[i] - expected[i]), 0.0, 1e-12);
+  }
+
+  // The expanded matrix is Hermitian.
+  for (std::size_t i = 0; i < 2 * n; i++) {
+    for (std::size_t k = full.offsets()[i]; k < full.offsets()[i + 1]; k++) {
+      std::size_t j = full.columns()[k];
+      EXPECT_NEAR(std::abs(full.values()[k] - std::conj(full.at(j, i))), 0.0,
+                  1e-14);
+    }
+  }
+}
+
+TEST(test_spin, zeeman_split_chain) {
+  HoppingTable<1> h0(1);
+  h0.add_hermitian(Vec<int, 1>{1}, 0, 0, -1.0);
+  HoppingTable<1> hz(1);
+  hz.add_hermitian(Vec<int, 1>{0}, 0, 0, 0.25);
+  SpinBlochHamiltonian<1> h(h0, nullptr, nullptr, &hz);
+  EXPECT_EQ(h.size(), 2);
+
+  BlochWorkspace w;
+  EigenWorkspace<complex> ws;
+  std::vector<complex> hk(4);
+  std::vector<double> e(2);
+  for (double k : {0.0, 0.2, 0.5}) {
+    h.build(Vec<double, 1>{k}, hk.data(), w);
+    hermitian_eigenvalues(2, hk.data(), e.data(), ws);
+    double band = -2.0 * std::cos(2.0 * M_PI * k);
+    EXPECT_NEAR(e[0], band - 0.25, 1e-12);
+    EXPECT_NEAR(e[1], band + 0.25, 1e-12);
+  }
+}
+
+TEST(test_spin, rashba_chain) {
+  // H(k) = -2 cos(2 pi k) + 2 lambda sin(2 pi k) sigma_y.
+  double lambda = 0.3;
+  HoppingTable<1> h0(1);
+  h0.add_hermitian(Vec<int, 1>{1}, 0, 0, -1.0);
+  HoppingTable<1> hy(1);
+  hy.add_hermitian(Vec<int, 1>{1}, 0, 0, complex(0.0, -lambda));
+  SpinBlochHamiltonian<1> h(h0, nullptr, &hy, nullptr);
+
+  BlochWorkspace w;
+  EigenWorkspace<complex> ws;
+  std::vector<complex> hk(4);
+  std::vector<double> e(2);
+  for (double k : {0.1, 0.3}) {
+    h.build(Vec<double, 1>{k}, hk.data(), w);
+    hermitian_eigenvalues(2, hk.data(), e.data(), ws);
+    double band = -2.0 * std::cos(2.0 * M_PI * k);
+    double split = std::abs(2.0 * lambda * std::sin(2.0 * M_PI * k));
+    EXPECT_NEAR(e[0], band - split, 1e-12);
+    EXPECT_NEAR(e[1], band + split, 1e-12);
+  }
+}
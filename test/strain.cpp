@@ -0,0 +1,142 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/strain.h>
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace {
+
+using complex = std::complex<double>;
+
+struct Flake {
+  SparseMatrix<complex> h;
+  std::vector<Vec<double, 2>> positions;
+};
+
+// Square grid with unit spacing and complex hoppings.
+Flake square(std::size_t side) {
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  Flake f;
+  for (std::size_t x = 0; x < side; x++) {
+    for (std::size_t y = 0; y < side; y++) {
+      f.positions.push_back(Vec<double, 2>{double(x), double(y)});
+      if (x + 1 < side) bonds.emplace_back(x * side + y, (x + 1) * side + y);
+      if (y + 1 < side) bonds.emplace_back(x * side + y, x * side + y + 1);
+    }
+  }
+  f.h = SparseMatrix<complex>(Graph(side * side, bonds));
+  for (auto [i, j] : bonds) {
+    complex t = std::polar(-1.0, 0.1 * i);
+    f.h.at(i, j) = t;
+    f.h.at(j, i) = std::conj(t);
+  }
+  for (std::size_t i = 0; i < side * side; i++) f.h.at(i, i) = 0.5;
+  return f;
+}
+
+}  // namespace
+
+TEST(test_strain, zero_displacement_keeps_hoppings) {
+  Flake f = square(6);
+  SparseMatrix<complex> original = f.h;
+  BondStrain<complex, 2> strain(f.h, f.positions, 3.37);
+  EXPECT_EQ(strain.bonds(), 2 * 6 * 5);
+  strain.apply(std::vector<Vec<double, 2>>(36, Vec<double, 2>{0.0, 0.0}),
+               f.h);
+  EXPECT_EQ(f.h.values(), original.values());
+}
+
+TEST(test_strain, uniaxial_strain) {
+  Flake f = square(6);
+  SparseMatrix<complex> original = f.h;
+  double beta = 3.37;
+  BondStrain<complex, 2> strain(f.h, f.positions, beta);
+
+  // Stretch x by 2%, compress y by 1%.
+  strain.apply_field(
+      [](Vec<double, 2> const& r) {
+        return Vec<double, 2>{0.02 * r[0], -0.01 * r[1]};
+      },
+      f.h);
+  for (std::size_t i = 0; i < f.h.size(); i++) {
+    EXPECT_EQ(f.h.at(i, i), 0.5);
+    for (std::size_t k = f.h.offsets()[i]; k < f.h.offsets()[i + 1]; k++) {
+      std::size_t j = f.h.columns()[k];
+      if (j == i) continue;
+      bool along_x = f.positions[i][0] != f.positions[j][0];
+      double factor = std::exp(-beta * (along_x ? 0.02 : -0.01));
+      EXPECT_NEAR(std::abs(f.h.values()[k] - original.at(i, j) * factor), 0.0,
+                  1e-14);
+      EXPECT_EQ(f.h.values()[k], std::conj(f.h.at(j, i)));
+    }
+  }
+
+  // Updates always start from the reference state.
+  strain.apply_field(
+      [](Vec<double, 2> const&) { return Vec<double, 2>{0.3, -0.2}; }, f.h);
+  for (std::size_t k = 0; k < f.h.values().size(); k++) {
+    EXPECT_NEAR(std::abs(f.h.values()[k] - original.values()[k]), 0.0, 1e-14);
+  }
+}
+
+TEST(test_strain, periodic_bonds) {
+  // Ring of n sites on a line of length n, closed through the boundary.
+  std::size_t n = 10;
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  std::vector<Vec<double, 1>> positions;
+  for (std::size_t i = 0; i < n; i++) {
+    bonds.emplace_back(i, (i + 1) % n);
+    positions.push_back(Vec<double, 1>{double(i)});
+  }
+  SparseMatrix<double> h((Graph(n, bonds)));
+  for (auto [i, j] : bonds) {
+    h.at(i, j) = -1.0;
+    h.at(j, i) = -1.0;
+  }
+  auto minimum_image = [&](std::size_t i, std::size_t j) {
+    double d = positions[j][0] - positions[i][0];
+    d -= n * std::round(d / n);
+    return Vec<double, 1>{d};
+  };
+  BondStrain<double, 1> strain(h, positions, 2.0, minimum_image);
+
+  // u = 0.05 x stretches every bond but the wrapping one, which the
+  // displacement jump compresses by 0.05 n - 0.05.
+  std::vector<Vec<double, 1>> u;
+  for (auto const& r : positions) u.push_back(Vec<double, 1>{0.05 * r[0]});
+  strain.apply(u, h);
+  for (std::size_t i = 0; i + 1 < n; i++) {
+    EXPECT_NEAR(h.at(i, i + 1), -std::exp(-2.0 * 0.05), 1e-14);
+  }
+  EXPECT_NEAR(h.at(0, n - 1), -std::exp(-2.0 * (1.0 - 0.05 * (n - 1) - 1.0)),
+              1e-14);
+}
+
+TEST(test_strain, other_pattern_aborts) {
+  Flake f = square(6);
+  BondStrain<complex, 2> strain(f.h, f.positions, 3.37);
+  // Same number of sites, one bond fewer: the recorded slots are stale.
+  std::vector<std::pair<std::size_t, std::size_t>> bonds;
+  for (std::size_t i = 0; i + 2 < 36; i++) bonds.emplace_back(i, i + 1);
+  SparseMatrix<complex> other((Graph(36, bonds)));
+  std::vector<Vec<double, 2>> u(36, Vec<double, 2>{0.0, 0.0});
+  EXPECT_DEATH(strain.apply(u, other), "");
+}
@@ -0,0 +1,137 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/supercell.h>
+
+#include <sstream>
+
+using ::testing::ElementsAre;
+
+namespace {
+
+// Two-site chain cell: A-B inside the cell, B-A' to the next cell.
+Supercell<1> chain(std::size_t cells, bool periodic) {
+  Graph cell(2, {{0, 1}});
+  return {cell, {{1, 0, Vec<int, 1>{1}}}, {cells}, {periodic}};
+}
+
+// Square lattice with one site per cell.
+Supercell<2> square(std::size_t nx, std::size_t ny, bool periodic) {
+  Graph cell(1, {});
+  std::vector<Bond<2>> bonds{{0, 0, Vec<int, 2>{1, 0}},
+                             {0, 0, Vec<int, 2>{0, 1}}};
+  return {cell, bonds, {nx, ny}, {periodic, periodic}};
+}
+
+}  // namespace
+
+TEST(test_supercell, open_chain) {
+  Graph g = chain(3, false).build();
+  EXPECT_EQ(g.size(), 6);
+  EXPECT_EQ(g.bonds(), 5);
+  EXPECT_THAT(g.neighbors(0), ElementsAre(1));
+  EXPECT_THAT(g.neighbors(1), ElementsAre(0, 2));
+  EXPECT_THAT(g.neighbors(5), ElementsAre(4));
+}
+
+TEST(test_supercell, periodic_chain) {
+  Graph g = chain(3, true).build();
+  EXPECT_EQ(g.bonds(), 6);
+  EXPECT_THAT(g.neighbors(0), ElementsAre(1, 5));
+}
+
+TEST(test_supercell, square_lattice) {
+  Supercell<2> s = square(4, 5, true);
+  Graph g = s.build();
+  EXPECT_EQ(g.size(), 20);
+  EXPECT_EQ(g.bonds(), 40);
+  for (std::size_t v = 0; v < g.size(); v++) EXPECT_EQ(g.degree(v), 4);
+  EXPECT_TRUE(g.has_bond(s.site({0, 0}, 0), s.site({3, 0}, 0)));
+  EXPECT_TRUE(g.has_bond(s.site({2, 4}, 0), s.site({2, 0}, 0)));
+}
+
+TEST(test_supercell, stream_matches_build) {
+  Supercell<2> s = square(6, 7, false);
+  Graph whole = s.build();
+  std::vector<std::size_t> adjacency;
+  std::size_t rows = 0;
+  s.stream(5, [&](GraphChunk const& chunk) {
+    EXPECT_EQ(chunk.first_row, rows);
+    rows += chunk.offsets.size() - 1;
+    adjacency.insert(adjacency.end(), chunk.adjacency.begin(),
+                     chunk.adjacency.end());
+  });
+  EXPECT_EQ(rows, whole.size());
+  EXPECT_EQ(adjacency, whole.adjacency());
+}
+
+TEST(test_supercell, write_and_read) {
+  Supercell<2> s = square(5, 3, true);
+  std::stringstream file;
+  s.write(file, 4);
+  Graph g = read_graph(file);
+  Graph whole = s.build();
+  EXPECT_EQ(g.offsets(), whole.offsets());
+  EXPECT_EQ(g.adjacency(), whole.adjacency());
+}
+
+TEST(test_supercell, corrupt_file_aborts) {
+  // Two sites and one chunk with the given row count, degrees and neighbors.
+  auto file = [](std::size_t rows, std::vector<std::size_t> const& degrees,
+                 std::size_t bonds, std::vector<std::size_t> const& neighbors) {
+    std::stringstream out;
+    write_graph_header(out, 2);
+    std::vector<std::size_t> words{rows, bonds};
+    words.insert(words.end(), degrees.begin(), degrees.end());
+    words.insert(words.end(), neighbors.begin(), neighbors.end());
+    for (std::size_t word : words) {
+      out.write(reinterpret_cast<char const*>(&word), sizeof(word));
+    }
+    return out;
+  };
+  // A bond count far past the data fails as truncated rather than allocating
+  // it.
+  EXPECT_DEATH(
+      {
+        std::stringstream in = file(2, {1, std::size_t{1} << 40},
+                                    (std::size_t{1} << 40) + 1, {1, 0});
+        read_graph(in);
+      },
+      "truncated graph file");
+  EXPECT_DEATH(
+      {
+        std::stringstream in = file(3, {1, 1, 0}, 2, {1, 0});
+        read_graph(in);
+      },
+      "corrupt graph chunk");
+  EXPECT_DEATH(
+      {
+        std::stringstream in = file(2, {1, 1}, 3, {1, 0, 0});
+        read_graph(in);
+      },
+      "corrupt graph chunk");
+  EXPECT_DEATH(
+      {
+        std::stringstream in = file(2, {1, 1}, 2, {1, 2});
+        read_graph(in);
+      },
+      "graph neighbor out of range");
+  std::stringstream in = file(2, {1, 1}, 2, {1, 0});
+  Graph g = read_graph(in);
+  EXPECT_TRUE(g.has_bond(0, 1));
+}
@@ -0,0 +1,140 @@
+// tightb - calculate electronic properties of solids
+// Copyright (C) 2022  Matheus de Sousa (keyehzy)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <tightb/interpolation.h>
+#include <tightb/symmetry.h>
+
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+Lattice<2> square() {
+  Matrix<double, 2, 2> a{};
+  a.at(0, 0) = 1.0;
+  a.at(1, 1) = 1.0;
+  return Lattice<2>(a);
+}
+
+Lattice<2> hexagonal() {
+  Matrix<double, 2, 2> a{};
+  a.at(0, 0) = 1.0;
+  a.at(1, 0) = 0.5;
+  a.at(1, 1) = std::sqrt(3.0) / 2.0;
+  return Lattice<2>(a);
+}
+
+UnitCell<2> graphene_cell() {
+  UnitCell<2> cell(hexagonal());
+  cell.add_site(Vec<double, 2>{1.0 / 3.0, 1.0 / 3.0});
+  cell.add_site(Vec<double, 2>{2.0 / 3.0, 2.0 / 3.0});
+  return cell;
+}
+
+HoppingTable<2> graphene() {
+  HoppingTable<2> table(2);
+  table.add_hermitian(Vec<int, 2>{0, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{-1, 0}, 0, 1, -1.0);
+  table.add_hermitian(Vec<int, 2>{0, -1}, 0, 1, -1.0);
+  return table;
+}
+
+double total_weight(std::vector<double> const& weights) {
+  return std::accumulate(weights.begin(), weights.end(), 0.0);
+}
+
+}  // namespace
+
+TEST(test_symmetry, square_point_group) {
+  UnitCell<2> cell(square());
+  cell.add_site(Vec<double, 2>{0.0, 0.0});
+  auto ops = point_group(cell);
+  EXPECT_EQ(ops.size(), 8);
+  EXPECT_TRUE(detail::is_identity(ops[0].rotation));
+
+  // A second, off-center site lowers the symmetry.
+  cell.add_site(Vec<double, 2>{0.5, 0.0});
+  EXPECT_EQ(point_group(cell).size(), 4);
+}
+
+TEST(test_symmetry, graphene_point_group) {
+  auto ops = point_group(graphene_cell());
+  EXPECT_EQ(ops.size(), 12);
+
+  // Distinct sublattices (e.g. hBN) keep only C3v.
+  UnitCell<2> hbn(hexagonal());
+  hbn.add_site(Vec<double, 2>{1.0 / 3.0, 1.0 / 3.0}, 1);
+  hbn.add_site(Vec<double, 2>{2.0 / 3.0, 2.0 / 3.0}, 2);
+  EXPECT_EQ(point_group(hbn).size(), 6);
+}
+
+TEST(test_symmetry, square_mesh_wedge) {
+  UnitCell<2> cell(square());
+  cell.add_site(Vec<double, 2>{0.0, 0.0});
+  IrreducibleMesh<2> mesh =
+      reduce_mesh(point_group(cell), {4, 4}, Vec<double, 2>{0.0, 0.0});
+  EXPECT_EQ(mesh.full_size(), 16);
+  EXPECT_EQ(mesh.size(), 6);
+  EXPECT_NEAR(total_weight(mesh.weights), 1.0, 1e-14);
+  EXPECT_NEAR(mesh.weights[0], 1.0 / 16.0, 1e-14);
+}
+
+TEST(test_symmetry, unfolded_bands_match_full_mesh) {
+  UnitCell<2> cell = graphene_cell();
+  BandInterpolator<2> bands(cell.lattice(), graphene());
+  for (std::array<std::size_t, 2> size :
+       {std::array<std::size_t, 2>{12, 12}, std::array<std::size_t, 2>{6, 9}}) {
+    for (Vec<double, 2> shift :
+         {Vec<double, 2>{0.0, 0.0}, Vec<double, 2>{0.5, 0.5}}) {
+      IrreducibleMesh<2> mesh =
+          reduce_mesh(point_group(cell), size, shift, true);
+      EXPECT_NEAR(total_weight(mesh.weights), 1.0, 1e-14);
+      EXPECT_LE(mesh.size(), mesh.full_size());
+
+      std::vector<double> reduced(mesh.size() * 2);
+      bands.evaluate(mesh.size(), mesh.points.data(), reduced.data());
+      std::vector<double> unfolded = unfold(mesh, reduced, 2);
+
+      std::vector<double> full(mesh.full_size() * 2);
+      bands.evaluate_mesh(size, shift, full.data());
+      ASSERT_EQ(unfolded.size(), full.size());
+      for (std::size_t i = 0; i < full.size(); i++) {
+        EXPECT_NEAR(unfolded[i], full[i], 1e-10);
+      }
+    }
+  }
+
+  IrreducibleMesh<2> mesh =
+      reduce_mesh(point_group(cell), {12, 12}, Vec<double, 2>{0.0, 0.0});
+  EXPECT_EQ(mesh.rotations.size(), 12);
+  EXPECT_EQ(mesh.size(), 19);
+}
+
+TEST(test_symmetry, time_reversal_halves_mesh) {
+  IrreducibleMesh<2> mesh =
+      reduce_mesh({}, graphene(), {4, 4}, Vec<double, 2>{0.0, 0.0});
+  // Only the four time-reversal invariant momenta are their own partners.
+  EXPECT_EQ(mesh.size(), 10);
+  EXPECT_EQ(mesh.rotations.size(), 2);
+  EXPECT_NEAR(total_weight(mesh.weights), 1.0, 1e-14);
+
+  HoppingTable<2> haldane = graphene();
+  haldane.add_hermitian(Vec<int, 2>{1, 0}, 0, 0, std::complex(0.0, 0.1));
+  EXPECT_EQ(reduce_mesh({}, haldane, {4, 4}, Vec<double, 2>{0.0, 0.0}).size(),
+            16);
+}